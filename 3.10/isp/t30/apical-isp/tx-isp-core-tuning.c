@@ -1,5 +1,7 @@
 #include <linux/videodev2.h>
 #include <linux/delay.h>
+#include <linux/vmalloc.h>
+#include <linux/poll.h>
 #include "apical_command_api.h"
 #include <apical-isp/apical_isp_config.h>
 #include <apical-isp/apical_math.h>
@@ -2043,25 +2045,30 @@ static int apical_isp_ae_weight_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_
 	return 0;
 }
 
-static int apical_isp_ae_hist_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
+static void apical_isp_ae_hist_snapshot(struct isp_core_ae_sta_info *info)
 {
-	struct isp_core_ae_sta_info info;
+	info->ae_histhresh[0] = apical_isp_metering_hist_thresh_0_1_read();
+	info->ae_histhresh[1] = apical_isp_metering_hist_thresh_1_2_read();
+	info->ae_histhresh[2] = apical_isp_metering_hist_thresh_3_4_read();
+	info->ae_histhresh[3] = apical_isp_metering_hist_thresh_4_5_read();
 
-	info.ae_histhresh[0] = apical_isp_metering_hist_thresh_0_1_read();
-	info.ae_histhresh[1] = apical_isp_metering_hist_thresh_1_2_read();
-	info.ae_histhresh[2] = apical_isp_metering_hist_thresh_3_4_read();
-	info.ae_histhresh[3] = apical_isp_metering_hist_thresh_4_5_read();
+	info->ae_hist[0] = apical_isp_metering_hist_0_read();
+	info->ae_hist[1] = apical_isp_metering_hist_1_read();
+	info->ae_hist[3] = apical_isp_metering_hist_3_read();
+	info->ae_hist[4] = apical_isp_metering_hist_4_read();
+	info->ae_hist[2] = 0xffff - info->ae_hist[0] - info->ae_hist[1] - info->ae_hist[3] - info->ae_hist[4];
 
-	info.ae_hist[0] = apical_isp_metering_hist_0_read();
-	info.ae_hist[1] = apical_isp_metering_hist_1_read();
-	info.ae_hist[3] = apical_isp_metering_hist_3_read();
-	info.ae_hist[4] = apical_isp_metering_hist_4_read();
-	info.ae_hist[2] = 0xffff - info.ae_hist[0] - info.ae_hist[1] - info.ae_hist[3] - info.ae_hist[4];
+	info->ae_stat_nodeh = apical_isp_metering_aexp_nodes_used_horiz_read();
+	info->ae_stat_nodev = apical_isp_metering_aexp_nodes_used_vert_read();
+}
 
-	info.ae_stat_nodeh = apical_isp_metering_aexp_nodes_used_horiz_read();
-	info.ae_stat_nodev = apical_isp_metering_aexp_nodes_used_vert_read();
+static int apical_isp_ae_hist_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
+{
+	struct isp_core_ae_sta_info info;
 
-	copy_to_user((void __user*)control->value, &info, sizeof(info));
+	apical_isp_ae_hist_snapshot(&info);
+	if (copy_to_user((void __user*)control->value, &info, sizeof(info)))
+		return -EFAULT;
 	return 0;
 }
 
@@ -2069,7 +2076,8 @@ static int apical_isp_ae_hist_s_attr(image_tuning_vdrv_t *tuning, struct v4l2_co
 {
 	struct isp_core_ae_sta_info info;
 
-	copy_from_user(&info, (const void __user*)control->value, sizeof(info));
+	if (copy_from_user(&info, (const void __user*)control->value, sizeof(info)))
+		return -EFAULT;
 
 	apical_isp_metering_hist_thresh_0_1_write(info.ae_histhresh[0]);
 	apical_isp_metering_hist_thresh_1_2_write(info.ae_histhresh[1]);
@@ -2082,29 +2090,34 @@ static int apical_isp_ae_hist_s_attr(image_tuning_vdrv_t *tuning, struct v4l2_co
 	return 0;
 }
 
+static void apical_isp_awb_hist_snapshot(struct isp_core_awb_sta_info *info)
+{
+	info->awb_stat.r_gain = apical_isp_metering_awb_rg_read();
+	info->awb_stat.b_gain = apical_isp_metering_awb_bg_read();
+	info->awb_stat.awb_sum = apical_isp_metering_awb_sum_read();
+
+	info->awb_stats_mode = apical_isp_metering_awb_stats_mode_read()?ISPCORE_AWB_STATS_CURRENT_MODE:ISPCORE_AWB_STATS_LEGACY_MODE;
+	info->awb_whitelevel = apical_isp_metering_white_level_awb_read();
+	info->awb_blacklevel = apical_isp_metering_black_level_awb_read();
+	info->cr_ref_max = apical_isp_metering_cr_ref_max_awb_read();
+	info->cr_ref_min = apical_isp_metering_cr_ref_min_awb_read();
+	info->cb_ref_max = apical_isp_metering_cb_ref_max_awb_read();
+	info->cb_ref_min = apical_isp_metering_cb_ref_min_awb_read();
+	info->awb_stat_nodeh = apical_isp_metering_awb_nodes_used_horiz_read();
+	info->awb_stat_nodev = apical_isp_metering_awb_nodes_used_vert_read();
+	/* info->cr_ref_high = apical_isp_metering_cr_ref_high_awb_read(); */
+	/* info->cr_ref_low = apical_isp_metering_cr_ref_low_awb_read(); */
+	/* info->cb_ref_high = apical_isp_metering_cb_ref_high_awb_read(); */
+	/* info->cb_ref_low = apical_isp_metering_cb_ref_low_awb_read(); */
+}
+
 static int apical_isp_awb_hist_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
 {
 	struct isp_core_awb_sta_info info;
 
-	info.awb_stat.r_gain = apical_isp_metering_awb_rg_read();
-	info.awb_stat.b_gain = apical_isp_metering_awb_bg_read();
-	info.awb_stat.awb_sum = apical_isp_metering_awb_sum_read();
-
-	info.awb_stats_mode = apical_isp_metering_awb_stats_mode_read()?ISPCORE_AWB_STATS_CURRENT_MODE:ISPCORE_AWB_STATS_LEGACY_MODE;
-	info.awb_whitelevel = apical_isp_metering_white_level_awb_read();
-	info.awb_blacklevel = apical_isp_metering_black_level_awb_read();
-	info.cr_ref_max = apical_isp_metering_cr_ref_max_awb_read();
-	info.cr_ref_min = apical_isp_metering_cr_ref_min_awb_read();
-	info.cb_ref_max = apical_isp_metering_cb_ref_max_awb_read();
-	info.cb_ref_min = apical_isp_metering_cb_ref_min_awb_read();
-	info.awb_stat_nodeh = apical_isp_metering_awb_nodes_used_horiz_read();
-	info.awb_stat_nodev = apical_isp_metering_awb_nodes_used_vert_read();
-	/* info.cr_ref_high = apical_isp_metering_cr_ref_high_awb_read(); */
-	/* info.cr_ref_low = apical_isp_metering_cr_ref_low_awb_read(); */
-	/* info.cb_ref_high = apical_isp_metering_cb_ref_high_awb_read(); */
-	/* info.cb_ref_low = apical_isp_metering_cb_ref_low_awb_read(); */
-
-	copy_to_user((void __user*)control->value, &info, sizeof(info));
+	apical_isp_awb_hist_snapshot(&info);
+	if (copy_to_user((void __user*)control->value, &info, sizeof(info)))
+		return -EFAULT;
 
 	return 0;
 }
@@ -2112,7 +2125,8 @@ static int apical_isp_awb_hist_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_c
 static int apical_isp_awb_hist_s_attr(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
 {
 	struct isp_core_awb_sta_info info;
-	copy_from_user(&info, (const void __user*)control->value, sizeof(info));
+	if (copy_from_user(&info, (const void __user*)control->value, sizeof(info)))
+		return -EFAULT;
 
 	apical_isp_metering_awb_stats_mode_write(info.awb_stats_mode?1:0);
 	apical_isp_metering_white_level_awb_write(info.awb_whitelevel);
@@ -2131,33 +2145,38 @@ static int apical_isp_awb_hist_s_attr(image_tuning_vdrv_t *tuning, struct v4l2_c
 	return 0;
 }
 
+static void apical_isp_af_hist_snapshot(struct isp_core_af_sta_info *info)
+{
+	info->af_stat.af_metrics = apical_isp_metering_af_metrics_read();
+	info->af_stat.af_metrics_alt = apical_isp_metering_af_metrics_alt_read();
+	info->af_stat.af_thresh_read = apical_isp_metering_af_threshold_read_read();
+	info->af_stat.af_intensity_read = apical_isp_metering_af_intensity_read_read();
+	info->af_stat.af_intensity_zone = apical_isp_metering_af_intensity_zone_read_read();
+	info->af_stat.af_total_pixels = apical_isp_metering_total_pixels_read();
+	info->af_stat.af_counted_pixels = apical_isp_metering_counted_pixels_read();
+
+	info->af_metrics_shift = apical_isp_metering_af_metrics_shift_read();
+	info->af_thresh = apical_isp_metering_af_threshold_write_read();
+	info->af_thresh_alt = apical_isp_metering_af_threshold_alt_write_read();
+	info->af_stat_nodeh = apical_isp_metering_af_nodes_used_horiz_read();
+	info->af_stat_nodev = apical_isp_metering_af_nodes_used_vert_read();
+	info->af_np_offset = apical_isp_metering_af_np_offset_read();
+	info->af_intensity_mode = apical_isp_metering_af_intensity_norm_mode_read();
+	info->af_skipx = apical_isp_metering_skip_x_read();
+	info->af_offsetx = apical_isp_metering_offset_x_read();
+	info->af_skipy = apical_isp_metering_skip_y_read();
+	info->af_offsety = apical_isp_metering_offset_y_read();
+	info->af_scale_top = apical_isp_metering_scale_top_read();
+	info->af_scale_bottom = apical_isp_metering_scale_bottom_read();
+}
+
 static int apical_isp_af_hist_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
 {
 	struct isp_core_af_sta_info info;
 
-	info.af_stat.af_metrics = apical_isp_metering_af_metrics_read();
-	info.af_stat.af_metrics_alt = apical_isp_metering_af_metrics_alt_read();
-	info.af_stat.af_thresh_read = apical_isp_metering_af_threshold_read_read();
-	info.af_stat.af_intensity_read = apical_isp_metering_af_intensity_read_read();
-	info.af_stat.af_intensity_zone = apical_isp_metering_af_intensity_zone_read_read();
-	info.af_stat.af_total_pixels = apical_isp_metering_total_pixels_read();
-	info.af_stat.af_counted_pixels = apical_isp_metering_counted_pixels_read();
-
-	info.af_metrics_shift = apical_isp_metering_af_metrics_shift_read();
-	info.af_thresh = apical_isp_metering_af_threshold_write_read();
-	info.af_thresh_alt = apical_isp_metering_af_threshold_alt_write_read();
-	info.af_stat_nodeh = apical_isp_metering_af_nodes_used_horiz_read();
-	info.af_stat_nodev = apical_isp_metering_af_nodes_used_vert_read();
-	info.af_np_offset = apical_isp_metering_af_np_offset_read();
-	info.af_intensity_mode = apical_isp_metering_af_intensity_norm_mode_read();
-	info.af_skipx = apical_isp_metering_skip_x_read();
-	info.af_offsetx = apical_isp_metering_offset_x_read();
-	info.af_skipy = apical_isp_metering_skip_y_read();
-	info.af_offsety = apical_isp_metering_offset_y_read();
-	info.af_scale_top = apical_isp_metering_scale_top_read();
-	info.af_scale_bottom = apical_isp_metering_scale_bottom_read();
-
-	copy_to_user((void __user*)control->value, &info, sizeof(info));
+	apical_isp_af_hist_snapshot(&info);
+	if (copy_to_user((void __user*)control->value, &info, sizeof(info)))
+		return -EFAULT;
 
 	return 0;
 }
@@ -2165,7 +2184,8 @@ static int apical_isp_af_hist_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_co
 static int apical_isp_af_hist_s_attr(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
 {
 	struct isp_core_af_sta_info info;
-	copy_from_user(&info, (const void __user*)control->value, sizeof(info));
+	if (copy_from_user(&info, (const void __user*)control->value, sizeof(info)))
+		return -EFAULT;
 
 	apical_isp_metering_af_metrics_shift_write(info.af_metrics_shift);
 	apical_isp_metering_af_threshold_write_write(info.af_thresh);
@@ -3020,6 +3040,57 @@ static void isp_frame_done_wakeup(void)
 	wake_up(&frame_done_wq);
 }
 
+/*
+ * Called at frame done in interrupt context, copy the 3A statistics of
+ * the frame into the next slot of the ring and wake up the pollers.
+ * Nothing is done while the ring isn't mapped by anybody.
+ */
+static void isp_core_stats_ring_fill(image_tuning_vdrv_t *tuning)
+{
+	struct isp_core_stats_ring *ring = tuning->stats_ring;
+	struct isp_core_stats_frame *frame;
+	struct timespec ts;
+	unsigned int seq;
+
+	if (!ring || !atomic_read(&tuning->stats_mapped))
+		return;
+
+	seq = ++tuning->stats_sequence;
+	if (seq == 0)
+		seq = ++tuning->stats_sequence;
+	frame = &ring->frame[seq & (ISP_CORE_STATS_RING_SLOTS - 1)];
+
+	frame->sequence = 0;
+	smp_wmb();
+	getrawmonotonic(&ts);
+	frame->timestamp = timespec_to_ns(&ts);
+	apical_isp_ae_hist_snapshot(&frame->ae);
+	apical_isp_awb_hist_snapshot(&frame->awb);
+	apical_isp_af_hist_snapshot(&frame->af);
+	smp_wmb();
+	frame->sequence = seq;
+	ring->sequence = seq;
+
+	wake_up_interruptible(&tuning->stats_wq);
+}
+
+static int apical_isp_stats_ring_g_attr(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
+{
+	struct isp_core_stats_ring_attr attr;
+
+	if (!tuning->stats_ring)
+		return -ENOMEM;
+
+	attr.slots = ISP_CORE_STATS_RING_SLOTS;
+	attr.slot_size = sizeof(struct isp_core_stats_frame);
+	attr.map_size = tuning->stats_ring_size;
+	attr.sequence = tuning->stats_ring->sequence;
+	if (copy_to_user((void __user*)control->value, &attr, sizeof(attr)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static int apical_isp_wait_frame_done(image_tuning_vdrv_t *tuning, struct v4l2_control *control)
 {
 	int ret = ISP_SUCCESS;
@@ -3215,6 +3286,9 @@ static int apical_isp_core_ops_g_ctrl(image_tuning_vdrv_t *tuning, struct v4l2_c
 	case IMAGE_TUNING_CID_ISP_WAIT_FRAME_ATTR:
 		ret = apical_isp_wait_frame_done(tuning, control);
 		break;
+	case IMAGE_TUNING_CID_STATS_RING_ATTR:
+		ret = apical_isp_stats_ring_g_attr(tuning, control);
+		break;
 	case IMAGE_TUNING_CID_ISP_EV_ATTR:
 		ret = apical_isp_ev_g_attr(tuning, control);
 		break;
@@ -3466,9 +3540,19 @@ done:
 	return ret;
 }
 
+/*
+ * The state of an open of the tuning device, the sequence of the last
+ * statistics frame consumed by a read() on this file.
+ */
+struct isp_core_tunning_file {
+	struct miscdevice *dev;
+	unsigned int stats_sequence;
+};
+
 static long isp_core_tunning_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
-	struct miscdevice *dev = file->private_data;
+	struct isp_core_tunning_file *tf = file->private_data;
+	struct miscdevice *dev = tf->dev;
 	struct tx_isp_module *module = miscdev_to_module(dev);
 	struct tx_isp_subdev *sd = module_to_subdev(module);
 	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
@@ -3513,6 +3597,7 @@ done:
 static int isp_core_tunning_open(struct inode *inode, struct file *file)
 {
 	struct miscdevice *dev = file->private_data;
+	struct isp_core_tunning_file *tf;
 	struct tx_isp_module *module = miscdev_to_module(dev);
 	struct tx_isp_subdev *sd = module_to_subdev(module);
 	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
@@ -3527,6 +3612,12 @@ static int isp_core_tunning_open(struct inode *inode, struct file *file)
 		return -EPERM;
 	}
 
+	tf = kzalloc(sizeof(*tf), GFP_KERNEL);
+	if(!tf)
+		return -ENOMEM;
+	tf->dev = dev;
+	file->private_data = tf;
+
 	core->isp_daynight_switch = 1;
 	tuning->temper_paddr = 0;
 	table = param->isp_param[TX_ISP_PRIV_PARAM_DAY_MODE].calibrations;
@@ -3558,13 +3649,14 @@ static int isp_core_tunning_open(struct inode *inode, struct file *file)
 
 static int isp_core_tunning_release(struct inode *inode, struct file *file)
 {
-	struct miscdevice *dev = file->private_data;
-	struct tx_isp_module *module = miscdev_to_module(dev);
+	struct isp_core_tunning_file *tf = file->private_data;
+	struct tx_isp_module *module = miscdev_to_module(tf->dev);
 	struct tx_isp_subdev *sd = module_to_subdev(module);
 	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
 	image_tuning_vdrv_t *tuning = core->tuning;
 
 	printk("##### %s %d #####\n", __func__,__LINE__);
+	kfree(tf);
 	if(tuning->state == TX_ISP_MODULE_DEINIT)
 		return 0;
 
@@ -3575,10 +3667,115 @@ static int isp_core_tunning_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static void isp_core_stats_vma_open(struct vm_area_struct *vma)
+{
+	image_tuning_vdrv_t *tuning = vma->vm_private_data;
+
+	atomic_inc(&tuning->stats_mapped);
+}
+
+static void isp_core_stats_vma_close(struct vm_area_struct *vma)
+{
+	image_tuning_vdrv_t *tuning = vma->vm_private_data;
+
+	atomic_dec(&tuning->stats_mapped);
+}
+
+static const struct vm_operations_struct isp_core_stats_vm_ops = {
+	.open = isp_core_stats_vma_open,
+	.close = isp_core_stats_vma_close,
+};
+
+static int isp_core_tunning_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct isp_core_tunning_file *tf = file->private_data;
+	struct miscdevice *dev = tf->dev;
+	struct tx_isp_module *module = miscdev_to_module(dev);
+	struct tx_isp_subdev *sd = module_to_subdev(module);
+	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
+	image_tuning_vdrv_t *tuning = core->tuning;
+	int ret = 0;
+
+	if (!tuning->stats_ring)
+		return -ENOMEM;
+	/* the ring is read-only for userspace. */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start > tuning->stats_ring_size)
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	ret = remap_vmalloc_range(vma, tuning->stats_ring, 0);
+	if (ret)
+		return ret;
+
+	vma->vm_private_data = tuning;
+	vma->vm_ops = &isp_core_stats_vm_ops;
+	isp_core_stats_vma_open(vma);
+	return 0;
+}
+
+/*
+ * read() consumes the statistics, it waits for a frame newer than the last
+ * one consumed on this file and returns its sequence. The frame itself is
+ * taken from the mapped ring.
+ */
+static ssize_t isp_core_tunning_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+	struct isp_core_tunning_file *tf = file->private_data;
+	struct tx_isp_module *module = miscdev_to_module(tf->dev);
+	struct tx_isp_subdev *sd = module_to_subdev(module);
+	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
+	image_tuning_vdrv_t *tuning = core->tuning;
+	unsigned int seq;
+	int ret = 0;
+
+	if (!tuning->stats_ring)
+		return -ENOMEM;
+	if (count < sizeof(seq))
+		return -EINVAL;
+
+	seq = ACCESS_ONCE(tuning->stats_ring->sequence);
+	if (seq == tf->stats_sequence) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(tuning->stats_wq,
+				(seq = ACCESS_ONCE(tuning->stats_ring->sequence)) != tf->stats_sequence);
+		if (ret)
+			return ret;
+	}
+	if (copy_to_user(buf, &seq, sizeof(seq)))
+		return -EFAULT;
+	tf->stats_sequence = seq;
+
+	return sizeof(seq);
+}
+
+/* POLLIN while a frame newer than the last one consumed by read() is there */
+static unsigned int isp_core_tunning_poll(struct file *file, poll_table *wait)
+{
+	struct isp_core_tunning_file *tf = file->private_data;
+	struct tx_isp_module *module = miscdev_to_module(tf->dev);
+	struct tx_isp_subdev *sd = module_to_subdev(module);
+	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
+	image_tuning_vdrv_t *tuning = core->tuning;
+
+	if (!tuning->stats_ring)
+		return POLLERR;
+
+	poll_wait(file, &tuning->stats_wq, wait);
+	if (ACCESS_ONCE(tuning->stats_ring->sequence) != tf->stats_sequence)
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
 static struct file_operations isp_core_tunning_fops = {
 	.open = isp_core_tunning_open,
 	.release = isp_core_tunning_release,
 	.unlocked_ioctl = isp_core_tunning_unlocked_ioctl,
+	.read = isp_core_tunning_read,
+	.mmap = isp_core_tunning_mmap,
+	.poll = isp_core_tunning_poll,
 };
 
 static int isp_core_tuning_activate(struct isp_core_tuning_driver *tuning)
@@ -3610,6 +3807,7 @@ static int isp_core_tuning_event(struct isp_core_tuning_driver *tuning, unsigned
 		ret = isp_core_tuning_slake(tuning);
 		break;
 	case TX_ISP_EVENT_CORE_FRAME_DONE:
+		isp_core_stats_ring_fill(tuning);
 		isp_frame_done_wakeup();
 		break;
 	case TX_ISP_EVENT_CORE_DAY_NIGHT:
@@ -3636,6 +3834,18 @@ struct isp_core_tuning_driver *isp_core_tuning_init(struct tx_isp_subdev *parent
 	spin_lock_init(&tuning->slock);
 	mutex_init(&tuning->mlock);
 
+	init_waitqueue_head(&tuning->stats_wq);
+	atomic_set(&tuning->stats_mapped, 0);
+	tuning->stats_ring_size = PAGE_ALIGN(sizeof(struct isp_core_stats_ring));
+	tuning->stats_ring = vmalloc_user(tuning->stats_ring_size);
+	if(!tuning->stats_ring){
+		ISP_PRINT(ISP_WARNING_LEVEL, "Failed to allocate 3A statistics ring\n");
+	}else{
+		tuning->stats_ring->magic = ISP_CORE_STATS_RING_MAGIC;
+		tuning->stats_ring->slots = ISP_CORE_STATS_RING_SLOTS;
+		tuning->stats_ring->slot_size = sizeof(struct isp_core_stats_frame);
+	}
+
 	tuning->state = TX_ISP_MODULE_SLAKE;
 	tuning->fops = &isp_core_tunning_fops;
 	tuning->event = isp_core_tuning_event;
@@ -3644,6 +3854,9 @@ struct isp_core_tuning_driver *isp_core_tuning_init(struct tx_isp_subdev *parent
 
 void isp_core_tuning_deinit(image_tuning_vdrv_t *tuning)
 {
-	if(tuning)
+	if(tuning){
+		if(tuning->stats_ring)
+			vfree(tuning->stats_ring);
 		kfree(tuning);
+	}
 }
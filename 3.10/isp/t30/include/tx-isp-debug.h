@@ -17,6 +17,7 @@
 	isp_printf(level, format, ##__VA_ARGS__)
 #define ISP_INFO(...) ISP_PRINT(ISP_INFO_LEVEL, __VA_ARGS__)
 #define ISP_WRANING(...) ISP_PRINT(ISP_WARNING_LEVEL, __VA_ARGS__)
+#define ISP_WARNING(...) ISP_PRINT(ISP_WARNING_LEVEL, __VA_ARGS__)
 #define ISP_ERROR(...) ISP_PRINT(ISP_ERROR_LEVEL, __VA_ARGS__)
 
 //extern unsigned int isp_print_level;
@@ -23,6 +23,10 @@
 #include <linux/delay.h>
 #include <linux/syscalls.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/dma-buf.h>
+#include <linux/scatterlist.h>
+#include <asm/addrspace.h>
 
 #include <tx-isp-list.h>
 #include "tx-isp-frame-channel.h"
@@ -34,6 +38,199 @@
 				 V4L2_BUF_FLAG_PREPARED | \
 				 V4L2_BUF_FLAG_TIMESTAMP_MASK)
 
+extern void tx_isp_core_get_frame_meta(struct frame_channel_meta *meta);
+extern int tx_isp_vic_get_line_progress(unsigned int *lines, unsigned int *height);
+
+/*
+ * The lines written in slice mode are checked when the lines waited for are
+ * expected to land, from the measured time of a line, but at least every
+ * FRAME_CHAN_SLICE_PERIOD_NS.
+ */
+#define FRAME_CHAN_SLICE_PERIOD_NS	(500 * 1000)
+#define FRAME_CHAN_SLICE_MIN_NS		(20 * 1000)
+/*
+ * Before a buffer is given to dma in slice mode, the end of every
+ * FRAME_CHAN_SLICE_STEP lines is marked. The lines are written when dma
+ * has overwritten their marks.
+ */
+#define FRAME_CHAN_SLICE_STEP		16
+#define FRAME_CHAN_SLICE_MARK		0x51ce0a5e
+
+/*
+ * The MMAP buffers are allocated by the driver, they are shared with the
+ * dmabufs exported from them, so the memory lives until the last user puts it.
+ * The dma address is the physical address on this SoC.
+ */
+static struct frame_channel_mem *frame_channel_mem_alloc(size_t size)
+{
+	struct frame_channel_mem *mem = NULL;
+
+	mem = kzalloc(sizeof(*mem), GFP_KERNEL);
+	if (!mem)
+		return NULL;
+
+	mem->size = PAGE_ALIGN(size);
+	mem->vaddr = dma_alloc_coherent(NULL, mem->size, &mem->dma, GFP_KERNEL);
+	if (!mem->vaddr) {
+		kfree(mem);
+		return NULL;
+	}
+	kref_init(&mem->ref);
+
+	return mem;
+}
+
+static void frame_channel_mem_release(struct kref *ref)
+{
+	struct frame_channel_mem *mem = container_of(ref, struct frame_channel_mem, ref);
+
+	dma_free_coherent(NULL, mem->size, mem->vaddr, mem->dma);
+	kfree(mem);
+}
+
+static struct sg_table *frame_channel_dmabuf_map(struct dma_buf_attachment *attach,
+		enum dma_data_direction dir)
+{
+	struct frame_channel_mem *mem = attach->dmabuf->priv;
+	struct sg_table *sgt = NULL;
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+	if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+	sg_set_page(sgt->sgl, pfn_to_page(PFN_DOWN(mem->dma)), mem->size, 0);
+	sg_dma_address(sgt->sgl) = mem->dma;
+
+	return sgt;
+}
+
+static void frame_channel_dmabuf_unmap(struct dma_buf_attachment *attach,
+		struct sg_table *sgt, enum dma_data_direction dir)
+{
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void frame_channel_dmabuf_release(struct dma_buf *dbuf)
+{
+	struct frame_channel_mem *mem = dbuf->priv;
+
+	kref_put(&mem->ref, frame_channel_mem_release);
+}
+
+static void *frame_channel_dmabuf_kmap(struct dma_buf *dbuf, unsigned long page_num)
+{
+	struct frame_channel_mem *mem = dbuf->priv;
+
+	return mem->vaddr + page_num * PAGE_SIZE;
+}
+
+static int frame_channel_dmabuf_mmap(struct dma_buf *dbuf, struct vm_area_struct *vma)
+{
+	struct frame_channel_mem *mem = dbuf->priv;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (size > mem->size)
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	return remap_pfn_range(vma, vma->vm_start, PFN_DOWN(mem->dma), size, vma->vm_page_prot);
+}
+
+static struct dma_buf_ops frame_channel_dmabuf_ops = {
+	.map_dma_buf = frame_channel_dmabuf_map,
+	.unmap_dma_buf = frame_channel_dmabuf_unmap,
+	.release = frame_channel_dmabuf_release,
+	.kmap = frame_channel_dmabuf_kmap,
+	.kmap_atomic = frame_channel_dmabuf_kmap,
+	.mmap = frame_channel_dmabuf_mmap,
+};
+
+static int frame_channel_mem_export(struct frame_channel_mem *mem)
+{
+	struct dma_buf *dbuf = NULL;
+	int fd = 0;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 1, 0)
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+
+	exp_info.ops = &frame_channel_dmabuf_ops;
+	exp_info.size = mem->size;
+	exp_info.flags = O_RDWR;
+	exp_info.priv = mem;
+	dbuf = dma_buf_export(&exp_info);
+#else
+	dbuf = dma_buf_export(mem, &frame_channel_dmabuf_ops, mem->size, O_RDWR);
+#endif
+	if (IS_ERR(dbuf))
+		return PTR_ERR(dbuf);
+	/* the reference is put when the dmabuf is released */
+	kref_get(&mem->ref);
+
+	fd = dma_buf_fd(dbuf, O_CLOEXEC);
+	if (fd < 0)
+		dma_buf_put(dbuf);
+
+	return fd;
+}
+
+static void frame_channel_vb_done(struct tx_isp_frame_channel *chan, struct fs_vb2_buffer *vb, unsigned int sequence)
+{
+	unsigned long flags = 0;
+	struct fs_vb2_queue *q = &chan->vbq;
+	struct frame_channel_meta *meta = NULL;
+	struct timespec ts;
+
+	getrawmonotonic(&ts);
+	vb->v4l2_buf.timestamp.tv_sec = ts.tv_sec;
+	vb->v4l2_buf.timestamp.tv_usec = ts.tv_nsec / 1000;
+
+	vb->v4l2_buf.sequence = sequence;
+	meta = &(vb_to_video_buffer(vb)->meta);
+	tx_isp_core_get_frame_meta(meta);
+	meta->width = chan->fmt.pix.width;
+	meta->height = chan->fmt.pix.height;
+	meta->bytesperline = chan->fmt.pix.bytesperline;
+	meta->fmt_sequence = chan->fmt_sequence;
+	/* Add the buffer to the done buffers list */
+	private_spin_lock_irqsave(&q->done_lock, flags);
+	vb->state = FS_VB2_BUF_STATE_DONE;
+	tx_list_add_tail(&vb->done_entry, &q->done_list);
+	q->done_count++;
+	/* Remove from videobuf queue */
+	tx_list_del(&vb->queued_entry);
+	q->queued_count--;
+	private_spin_unlock_irqrestore(&q->done_lock, flags);
+
+	/* Inform any processes that may be waiting for buffers */
+	wake_up(&q->done_wq);
+	private_complete(&chan->comp);
+}
+
+/*
+ * The lead time is how long the buffer was given to user before the whole
+ * frame was written, it is called with chan->slock held.
+ */
+static void frame_channel_slice_lead(struct tx_isp_frame_channel *chan, struct frame_channel_video_buffer *buffer)
+{
+	s64 lead = 0;
+
+	if(buffer->deliver_ns == 0)
+		return;
+
+	lead = ktime_to_ns(ktime_get()) - buffer->deliver_ns;
+	buffer->lead_time = div_s64(lead, NSEC_PER_USEC);
+	buffer->deliver_ns = 0;
+	if(chan->slice_lead_count == 0 || buffer->lead_time < chan->slice_lead_min)
+		chan->slice_lead_min = buffer->lead_time;
+	if(buffer->lead_time > chan->slice_lead_max)
+		chan->slice_lead_max = buffer->lead_time;
+	chan->slice_lead_sum += buffer->lead_time;
+	chan->slice_lead_count++;
+}
+
 static int frame_channel_buffer_done(struct tx_isp_frame_channel *chan, void *arg)
 {
 	unsigned long flags = 0;
@@ -41,11 +238,18 @@ static int frame_channel_buffer_done(struct tx_isp_frame_channel *chan, void *ar
 	struct fs_vb2_queue *q = &chan->vbq;
 	struct fs_vb2_buffer *vb = NULL;
 	struct fs_vb2_buffer *pos = NULL;
+	struct fs_vb2_buffer *slice = NULL;
 
 	if(buf == NULL)
 		return 0;
 
 	private_spin_lock_irqsave(&chan->slock, flags);
+	if(chan->slice_vb && chan->slice_vb->v4l2_buf.m.userptr == buf->addr){
+		slice = chan->slice_vb;
+		chan->slice_vb = NULL;
+		frame_channel_slice_lead(chan, vb_to_video_buffer(slice));
+		vb_to_video_buffer(slice)->valid_lines = chan->fmt.pix.height;
+	}
 	tx_list_for_each_entry(pos, &q->queued_list, queued_entry){
 		if(pos->v4l2_buf.m.userptr == buf->addr){
 			vb = pos;
@@ -54,32 +258,21 @@ static int frame_channel_buffer_done(struct tx_isp_frame_channel *chan, void *ar
 	}
 	private_spin_unlock_irqrestore(&chan->slock, flags);
 
-	if(vb && vb->state == FS_VB2_BUF_STATE_ACTIVE){
-		struct timespec ts;
-		getrawmonotonic(&ts);
-
-		vb->v4l2_buf.timestamp.tv_sec = ts.tv_sec;
-		vb->v4l2_buf.timestamp.tv_usec = ts.tv_nsec / 1000;
+	if(slice){
+		hrtimer_try_to_cancel(&chan->slice_timer);
+		wake_up_interruptible(&chan->slice_wq);
+	}
 
-		vb->v4l2_buf.sequence = buf->priv;
-		/* Add the buffer to the done buffers list */
-		private_spin_lock_irqsave(&q->done_lock, flags);
-		vb->state = FS_VB2_BUF_STATE_DONE;
-		tx_list_add_tail(&vb->done_entry, &q->done_list);
-		q->done_count++;
-		/* Remove from videobuf queue */
-		tx_list_del(&vb->queued_entry);
-		q->queued_count--;
-		private_spin_unlock_irqrestore(&q->done_lock, flags);
-
-		/* Inform any processes that may be waiting for buffers */
-		wake_up(&q->done_wq);
-		private_complete(&chan->comp);
+	if(vb && vb->state == FS_VB2_BUF_STATE_ACTIVE){
+		frame_channel_vb_done(chan, vb, buf->priv);
 		if(chan->out_frames && (chan->out_frames + 1 != buf->priv)){
 			ISP_INFO("chan%d: source frames %d, output frames %d\n", chan->index, buf->priv, chan->out_frames + 1);
 		}
 		chan->out_frames = buf->priv;
 	//	printk("bufdone chan%d buf.index = %d\n", chan->index, buf->vb.v4l2_buf.index);
+	}else if(slice){
+		/* The buffer has been given to user in slice mode */
+		chan->out_frames = buf->priv;
 	}else{
 		chan->losed_frames++;
 	}
@@ -87,6 +280,263 @@ static int frame_channel_buffer_done(struct tx_isp_frame_channel *chan, void *ar
 	return 0;
 }
 
+/*
+ * The stride of the output lines and the offset of the uv plane, the
+ * layout is the one of the mscaler dma. 0 when the format is not known.
+ */
+static unsigned int frame_channel_slice_layout(struct frame_image_format *fmt, unsigned int *uv_offset)
+{
+	*uv_offset = 0;
+	switch(fmt->pix.pixelformat){
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			*uv_offset = fmt->pix.width * ((fmt->pix.height + 0xf) & ~0xf);
+			return fmt->pix.width;
+		case V4L2_PIX_FMT_RGB565:
+			return fmt->pix.width * 2;
+		case V4L2_PIX_FMT_BGR32:
+			return fmt->pix.width * 4;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * The two words at the end of the last line of the first lines of the
+ * buffer, and of the uv line they need. The marks are accessed uncached,
+ * the buffers are in the low memory.
+ */
+static inline u32 *frame_channel_slice_mark(dma_addr_t addr, unsigned int stride,
+		unsigned int uv_offset, unsigned int lines, bool uv)
+{
+	if(uv)
+		return (u32 *)CKSEG1ADDR(addr + uv_offset + (lines >> 1) * stride - 8);
+	return (u32 *)CKSEG1ADDR(addr + lines * stride - 8);
+}
+
+static void frame_channel_slice_write_marks(struct tx_isp_frame_channel *chan,
+		struct frame_channel_video_buffer *buffer, dma_addr_t addr)
+{
+	struct frame_image_format *fmt = &chan->fmt;
+	unsigned int stride = 0, uv_offset = 0, lines = 0;
+	u32 *mark = NULL;
+
+	stride = frame_channel_slice_layout(fmt, &uv_offset);
+	/* kseg1 maps the low 512MB only */
+	if(stride == 0 || addr + buffer->vb.v4l2_buf.length > CKSEG1 - CKSEG0)
+		return;
+
+	for(lines = FRAME_CHAN_SLICE_STEP; lines < fmt->pix.height; lines += FRAME_CHAN_SLICE_STEP){
+		mark = frame_channel_slice_mark(addr, stride, uv_offset, lines, false);
+		mark[0] = FRAME_CHAN_SLICE_MARK;
+		mark[1] = ~FRAME_CHAN_SLICE_MARK;
+		if(uv_offset){
+			mark = frame_channel_slice_mark(addr, stride, uv_offset, lines, true);
+			mark[0] = FRAME_CHAN_SLICE_MARK;
+			mark[1] = ~FRAME_CHAN_SLICE_MARK;
+		}
+	}
+	buffer->slice_marks = chan->fmt_sequence + 1;
+}
+
+static inline bool frame_channel_slice_marked(u32 *mark)
+{
+	return mark[0] == FRAME_CHAN_SLICE_MARK && mark[1] == ~FRAME_CHAN_SLICE_MARK;
+}
+
+/*
+ * The line of the output frame vic is receiving: the input line is
+ * scaled to the output and the crop, which is done after the scaler,
+ * is taken off. It is called with chan->slock held.
+ */
+static unsigned int frame_channel_slice_vic_line(struct tx_isp_frame_channel *chan)
+{
+	struct frame_image_format *fmt = &chan->fmt;
+	unsigned int lines = 0, height = 0;
+
+	if(tx_isp_vic_get_line_progress(&lines, &height) || height == 0)
+		return 0;
+
+	/* vic may be still receiving the last frame when dma starts a new one */
+	if(chan->slice_stale){
+		if(lines >= chan->slice_stale_line){
+			chan->slice_stale_line = lines;
+			return 0;
+		}
+		chan->slice_stale = false;
+	}
+
+	if(fmt->scaler_enable && fmt->scaler_out_height)
+		lines = lines * fmt->scaler_out_height / height;
+	if(fmt->crop_enable)
+		lines = lines > fmt->crop_top ? lines - fmt->crop_top : 0;
+	return lines;
+}
+
+/*
+ * The lines of the output frame which have been written. The vic line
+ * tells when to look, the marks dma has overwritten tell what is written.
+ * It is called with chan->slock held.
+ */
+static unsigned int frame_channel_slice_progress(struct tx_isp_frame_channel *chan,
+		struct frame_channel_video_buffer *buffer)
+{
+	struct frame_image_format *fmt = &chan->fmt;
+	dma_addr_t addr = buffer->buf.addr;
+	unsigned int stride = 0, uv_offset = 0, vic_line = 0;
+	unsigned int lines = buffer->valid_lines;
+	unsigned int next = 0;
+
+	/* the marks of an older format say nothing, the done interrupt will */
+	if(buffer->slice_marks != chan->fmt_sequence + 1)
+		return lines;
+
+	vic_line = frame_channel_slice_vic_line(chan);
+	stride = frame_channel_slice_layout(fmt, &uv_offset);
+	for(next = lines - lines % FRAME_CHAN_SLICE_STEP + FRAME_CHAN_SLICE_STEP;
+			next < fmt->pix.height && next <= vic_line; next += FRAME_CHAN_SLICE_STEP){
+		if(frame_channel_slice_marked(frame_channel_slice_mark(addr, stride, uv_offset, next, false)))
+			break;
+		if(uv_offset && frame_channel_slice_marked(frame_channel_slice_mark(addr, stride, uv_offset, next, true)))
+			break;
+		lines = next;
+	}
+	/* Only the done interrupt of dma tells that the whole frame is written */
+	return lines;
+}
+
+/*
+ * The time until the next lines waited for land, they are the lines to
+ * deliver the buffer or the fewest lines of the waiters.
+ * It is called with chan->slock held.
+ */
+static u64 frame_channel_slice_next(struct tx_isp_frame_channel *chan, struct fs_vb2_buffer *vb)
+{
+	struct frame_channel_video_buffer *buffer = vb_to_video_buffer(vb);
+	unsigned int target = 0;
+	u64 delay = 0;
+
+	if(vb->state == FS_VB2_BUF_STATE_ACTIVE)
+		target = chan->slice_lines;
+	if(chan->slice_wait_lines > buffer->valid_lines && (target == 0 || chan->slice_wait_lines < target))
+		target = chan->slice_wait_lines;
+	if(target <= buffer->valid_lines || chan->slice_line_ns == 0)
+		return FRAME_CHAN_SLICE_PERIOD_NS;
+
+	delay = (u64)(target - buffer->valid_lines) * chan->slice_line_ns;
+	return clamp_t(u64, delay, FRAME_CHAN_SLICE_MIN_NS, FRAME_CHAN_SLICE_PERIOD_NS);
+}
+
+static enum hrtimer_restart frame_channel_slice_timer(struct hrtimer *timer)
+{
+	struct tx_isp_frame_channel *chan = container_of(timer, struct tx_isp_frame_channel, slice_timer);
+	struct frame_channel_video_buffer *buffer = NULL;
+	struct fs_vb2_buffer *vb = NULL;
+	unsigned long flags = 0;
+	unsigned int lines = 0;
+	bool deliver = false;
+	s64 now = ktime_to_ns(ktime_get());
+	u64 next = 0;
+
+	private_spin_lock_irqsave(&chan->slock, flags);
+	vb = chan->slice_vb;
+	if(vb == NULL){
+		private_spin_unlock_irqrestore(&chan->slock, flags);
+		return HRTIMER_NORESTART;
+	}
+	buffer = vb_to_video_buffer(vb);
+	lines = frame_channel_slice_progress(chan, buffer);
+	if(lines > buffer->valid_lines){
+		/* the time of a line, averaged over the last checks */
+		if(chan->slice_last_ns && buffer->valid_lines){
+			next = div_u64(now - chan->slice_last_ns, lines - buffer->valid_lines);
+			chan->slice_line_ns = chan->slice_line_ns ? (chan->slice_line_ns * 3 + next) >> 2 : next;
+		}
+		chan->slice_last_ns = now;
+		buffer->valid_lines = lines;
+	}
+	if(vb->state == FS_VB2_BUF_STATE_ACTIVE && buffer->valid_lines >= chan->slice_lines){
+		vb->state = FS_VB2_BUF_STATE_DONE;
+		buffer->deliver_ns = now;
+		deliver = true;
+	}
+	if(chan->slice_wait_lines && buffer->valid_lines >= chan->slice_wait_lines)
+		chan->slice_wait_lines = 0;
+	next = frame_channel_slice_next(chan, vb);
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+
+	if(deliver){
+		frame_channel_vb_done(chan, vb, chan->out_frames + 1);
+		chan->slice_frames++;
+	}
+	wake_up_interruptible(&chan->slice_wq);
+
+	hrtimer_forward_now(timer, ns_to_ktime(next));
+	return HRTIMER_RESTART;
+}
+
+static int frame_channel_slice_start(struct tx_isp_frame_channel *chan, void *arg)
+{
+	unsigned long flags = 0;
+	struct frame_channel_buffer *buf = arg;
+	struct fs_vb2_buffer *vb = NULL;
+	struct fs_vb2_buffer *pos = NULL;
+	unsigned int lines = 0, height = 0;
+
+	if(chan->slice_lines == 0 || buf == NULL)
+		return 0;
+
+	private_spin_lock_irqsave(&chan->slock, flags);
+	tx_list_for_each_entry(pos, &chan->vbq.queued_list, queued_entry){
+		if(pos->v4l2_buf.m.userptr == buf->addr && pos->state == FS_VB2_BUF_STATE_ACTIVE){
+			vb = pos;
+			break;
+		}
+	}
+	if(vb){
+		tx_isp_vic_get_line_progress(&lines, &height);
+		chan->slice_vb = vb;
+		chan->slice_stale = lines > (height >> 1);
+		chan->slice_stale_line = lines;
+		chan->slice_last_ns = 0;
+		chan->slice_wait_lines = 0;
+		vb_to_video_buffer(vb)->valid_lines = 0;
+		vb_to_video_buffer(vb)->deliver_ns = 0;
+	}
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+
+	if(vb)
+		hrtimer_start(&chan->slice_timer, ns_to_ktime(FRAME_CHAN_SLICE_PERIOD_NS), HRTIMER_MODE_REL);
+	return 0;
+}
+
+/*
+ * The hardware has switched to the format that was set while streaming,
+ * the buffers done from now on hold frames of it.
+ */
+static int frame_channel_fmt_changed(struct tx_isp_frame_channel *chan, void *arg)
+{
+	struct frame_image_format *fmt = arg;
+	unsigned long flags = 0;
+
+	if(fmt == NULL)
+		return 0;
+
+	private_spin_lock_irqsave(&chan->slock, flags);
+	chan->fmt.pix = fmt->pix;
+	chan->fmt.crop_enable = fmt->crop_enable;
+	chan->fmt.crop_top = fmt->crop_top;
+	chan->fmt.crop_left = fmt->crop_left;
+	chan->fmt.crop_width = fmt->crop_width;
+	chan->fmt.crop_height = fmt->crop_height;
+	chan->fmt.scaler_enable = fmt->scaler_enable;
+	chan->fmt.scaler_out_width = fmt->scaler_out_width;
+	chan->fmt.scaler_out_height = fmt->scaler_out_height;
+	chan->fmt_sequence++;
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+	return 0;
+}
+
 static int frame_chan_event(struct tx_isp_subdev_pad *pad, unsigned int event, void *arg)
 {
 	int ret = 0;
@@ -105,6 +555,12 @@ static int frame_chan_event(struct tx_isp_subdev_pad *pad, unsigned int event, v
 		case TX_ISP_EVENT_FRAME_CHAN_DQUEUE_BUFFER:
 			ret = frame_channel_buffer_done(chan, arg);
 				break;
+		case TX_ISP_EVENT_FRAME_CHAN_SLICE_START:
+			ret = frame_channel_slice_start(chan, arg);
+			break;
+		case TX_ISP_EVENT_FRAME_CHAN_FMT_CHANGED:
+			ret = frame_channel_fmt_changed(chan, arg);
+			break;
 		default:
 			break;
 	}
@@ -173,7 +629,12 @@ static long frame_channel_vidioc_set_fmt(struct tx_isp_frame_channel *chan, unsi
 		return -ENOMEM;
 	}
 
-	chan->fmt = fmt;
+	/*
+	 * a streaming channel takes the format when the hardware does, the
+	 * module which applies it sends FMT_CHANGED
+	 */
+	if(chan->state != TX_ISP_MODULE_RUNNING)
+		chan->fmt = fmt;
 
 	return 0;
 }
@@ -221,6 +682,10 @@ static void __fill_v4l2_buffer(struct fs_vb2_buffer *vb, struct v4l2_buffer *b)
 	memcpy(b, &vb->v4l2_buf, offsetof(struct v4l2_buffer, m));
 	b->reserved2 = vb->v4l2_buf.reserved2;
 	b->reserved = vb->v4l2_buf.reserved;
+	if (vb->v4l2_buf.memory == V4L2_MEMORY_MMAP) {
+		b->m.offset = vb->v4l2_buf.m.offset;
+		b->length = vb->v4l2_buf.length;
+	}
 
 	/*
 	 * Clear any buffer state related flags.
@@ -270,6 +735,8 @@ static inline void __fill_vb2_buffer(struct fs_vb2_buffer *vb, const struct v4l2
  */
 static int __vb2_queue_alloc(struct fs_vb2_queue *q, unsigned int num_buffers)
 {
+	struct tx_isp_frame_channel *chan = vbq_to_frame_chan(q);
+	struct frame_channel_video_buffer *buf;
 	unsigned int buffer;
 	struct fs_vb2_buffer *vb;
 
@@ -287,6 +754,18 @@ static int __vb2_queue_alloc(struct fs_vb2_queue *q, unsigned int num_buffers)
 		vb->v4l2_buf.type = q->type;
 		vb->v4l2_buf.memory = q->memory;
 
+		if (q->memory == V4L2_MEMORY_MMAP) {
+			buf = vb_to_video_buffer(vb);
+			buf->mem = frame_channel_mem_alloc(chan->fmt.pix.sizeimage);
+			if (!buf->mem) {
+				ISP_ERROR("Memory alloc for buffer%d failed\n", vb->v4l2_buf.index);
+				kfree(vb);
+				break;
+			}
+			vb->v4l2_buf.m.offset = buf->mem->dma;
+			vb->v4l2_buf.length = chan->fmt.pix.sizeimage;
+		}
+
 		q->bufs[q->num_buffers + buffer] = vb;
 	}
 
@@ -308,6 +787,8 @@ static void __vb2_queue_free(struct fs_vb2_queue *q, unsigned int buffers)
 	/* Free videobuf buffers */
 	for (buffer = q->num_buffers - buffers; buffer < q->num_buffers;
 	     ++buffer) {
+		if (q->bufs[buffer] && vb_to_video_buffer(q->bufs[buffer])->mem)
+			kref_put(&vb_to_video_buffer(q->bufs[buffer])->mem->ref, frame_channel_mem_release);
 		kfree(q->bufs[buffer]);
 		q->bufs[buffer] = NULL;
 	}
@@ -370,9 +851,15 @@ static int frame_channel_reqbufs(struct tx_isp_frame_channel *chan, unsigned lon
 		return -EBUSY;
 	}
 
+	if (req.memory != V4L2_MEMORY_USERPTR && req.memory != V4L2_MEMORY_MMAP) {
+		ISP_ERROR("reqbufs: the memory type isn't userptr or mmap!\n");
+		return -EINVAL;
+	}
+
 	if (req.count == 0 || q->num_buffers != 0 || q->memory != req.memory) {
 
 		__vb2_queue_free(q, q->num_buffers);
+		q->memory = req.memory;
 
 		/*
 		 * In case of REQBUFS(0) return immediately without calling
@@ -382,11 +869,6 @@ static int frame_channel_reqbufs(struct tx_isp_frame_channel *chan, unsigned lon
 			return 0;
 	}
 
-	if(q->memory != req.memory){
-		ISP_ERROR("reqbufs: the memory type isn't userptr!\n");
-		return -EINVAL;
-	}
-
 	/*
 	 * Make sure the requested values and current defaults are sane.
 	 */
@@ -433,17 +915,29 @@ static int frame_channel_reqbufs(struct tx_isp_frame_channel *chan, unsigned lon
 static int __buf_prepare(struct fs_vb2_buffer *vb, const struct v4l2_buffer *b)
 {
 	struct frame_channel_video_buffer *buf = vb_to_video_buffer(vb);
-	/*struct fs_vb2_queue *q = vb->vb2_queue;*/
+	struct tx_isp_frame_channel *chan = vbq_to_frame_chan(vb->vb2_queue);
 	dma_addr_t addr = 0;
 
-	__fill_vb2_buffer(vb, b);
+	if (vb->v4l2_buf.memory == V4L2_MEMORY_MMAP) {
+		/* the memory is coherent, the address and the length are kept */
+		vb->v4l2_buf.field = b->field;
+		vb->v4l2_buf.timestamp = b->timestamp;
+		vb->v4l2_buf.flags = b->flags & ~V4L2_BUFFER_MASK_FLAGS;
+		addr = buf->mem->dma;
+	} else {
+		__fill_vb2_buffer(vb, b);
 
-	addr = (dma_addr_t)vb->v4l2_buf.m.userptr;
+		addr = (dma_addr_t)vb->v4l2_buf.m.userptr;
 
-	dma_sync_single_for_device(NULL, addr, vb->v4l2_buf.length, DMA_FROM_DEVICE);
+		dma_sync_single_for_device(NULL, addr, vb->v4l2_buf.length, DMA_FROM_DEVICE);
+	}
 
 	buf->buf.addr = (unsigned int)addr;
 	INIT_LIST_HEAD(&buf->buf.entry);
+	buf->valid_lines = 0;
+	buf->slice_marks = 0;
+	if(chan->slice_lines)
+		frame_channel_slice_write_marks(chan, buf, addr);
 
 	vb->state = FS_VB2_BUF_STATE_PREPARED;
 
@@ -539,13 +1033,20 @@ static int frame_channel_vb2_qbuf(struct tx_isp_frame_channel *chan, unsigned lo
 		goto unlock;
 	}
 
-	if(buf.length != q->format.fmt.pix.sizeimage)
+	if(buf.memory == V4L2_MEMORY_USERPTR && buf.length != q->format.fmt.pix.sizeimage)
 	{
 		ISP_ERROR("qbuf: invalid memory size, length = %d sizeimage = %d\n", buf.length, q->format.fmt.pix.sizeimage);
 		ret = -EINVAL;
 		goto unlock;
 	}
 
+	if(vb == chan->slice_vb)
+	{
+		ISP_ERROR("qbuf: buffer is still being written\n");
+		ret = -EBUSY;
+		goto unlock;
+	}
+
 	if(vb->state != FS_VB2_BUF_STATE_DEQUEUED)
 	{
 		ISP_ERROR("qbuf: buffer already in use\n");
@@ -837,6 +1338,12 @@ static void __vb2_queue_cancel(struct fs_vb2_queue *q)
 
 	q->streaming = 0;
 
+	hrtimer_cancel(&chan->slice_timer);
+	private_spin_lock_irqsave(&chan->slock, flags);
+	chan->slice_vb = NULL;
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+	wake_up_all(&chan->slice_wq);
+
 	/*
 	 * Remove all buffers from videobuf's list...
 	 */
@@ -1091,6 +1598,248 @@ done:
 	return ret;
 }
 
+/*
+ * Get the capture parameters of a buffer, they are valid from the buffer
+ * is dequeued until it is queued again.
+ */
+static int frame_channel_get_frame_meta(struct tx_isp_frame_channel *chan, unsigned long arg)
+{
+	struct fs_vb2_queue *q = NULL;
+	struct frame_channel_video_buffer *buffer = NULL;
+	struct frame_channel_meta meta;
+	unsigned long flags = 0;
+	int ret = 0;
+
+	if(IS_ERR_OR_NULL(chan)){
+		return -EINVAL;
+	}
+
+	ret = copy_from_user(&meta, (void __user *)arg, sizeof(meta));
+	if(ret){
+		ISP_ERROR("Failed to copy from user\n");
+		return -ENOMEM;
+	}
+
+	q = &chan->vbq;
+	if (meta.index >= q->num_buffers || q->bufs[meta.index] == NULL) {
+		ISP_ERROR("get frame meta: buffer index out of range\n");
+		return -EINVAL;
+	}
+
+	buffer = vb_to_video_buffer(q->bufs[meta.index]);
+	private_spin_lock_irqsave(&chan->slock, flags);
+	meta = buffer->meta;
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+
+	ret = copy_to_user((void __user *)arg, &meta, sizeof(meta));
+	if(ret){
+		ISP_ERROR("Failed to copy to user\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static int frame_channel_set_slice(struct tx_isp_frame_channel *chan, unsigned long arg)
+{
+	int lines = 0;
+	int ret = 0;
+
+	if(IS_ERR_OR_NULL(chan)){
+		return -EINVAL;
+	}
+
+	ret = copy_from_user(&lines, (void __user *)arg, sizeof(lines));
+	if(ret){
+		ISP_ERROR("Failed to copy from user\n");
+		return -ENOMEM;
+	}
+
+	if(chan->vbq.streaming){
+		ISP_ERROR("slice: it can't be changed when streaming\n");
+		return -EBUSY;
+	}
+
+	if(lines < 0){
+		ISP_ERROR("slice: the lines(%d) is invalid\n", lines);
+		return -EINVAL;
+	}
+
+	chan->slice_lines = lines;
+	return 0;
+}
+
+/*
+ * Wait until the lines of a buffer have been written, it is used after the
+ * buffer is dequeued in slice mode. The whole frame is written when the
+ * returned lines is equal to the height of the frame.
+ */
+static int frame_channel_wait_slice(struct tx_isp_frame_channel *chan, unsigned long arg)
+{
+	struct fs_vb2_queue *q = NULL;
+	struct frame_channel_video_buffer *buffer = NULL;
+	struct frame_channel_slice slice;
+	unsigned long flags = 0;
+	unsigned int lines = 0;
+	long timeout = 0;
+	bool wait = false;
+	u64 next = 0;
+	long ret = 0;
+	int err = 0;
+
+	if(IS_ERR_OR_NULL(chan)){
+		return -EINVAL;
+	}
+
+	err = copy_from_user(&slice, (void __user *)arg, sizeof(slice));
+	if(err){
+		ISP_ERROR("Failed to copy from user\n");
+		return -ENOMEM;
+	}
+
+	q = &chan->vbq;
+	if (slice.index >= q->num_buffers || q->bufs[slice.index] == NULL) {
+		ISP_ERROR("wait slice: buffer index out of range\n");
+		return -EINVAL;
+	}
+
+	buffer = vb_to_video_buffer(q->bufs[slice.index]);
+	lines = slice.lines;
+	if(lines == 0 || lines > chan->fmt.pix.height)
+		lines = chan->fmt.pix.height;
+
+	/*
+	 * The timer is brought forward to the time the lines land, the waiter
+	 * registers again when the fewer lines of another waiter are written.
+	 */
+	timeout = msecs_to_jiffies(slice.timeout);
+	do {
+		private_spin_lock_irqsave(&chan->slock, flags);
+		wait = chan->slice_vb == &buffer->vb && buffer->valid_lines < lines;
+		if(wait && (chan->slice_wait_lines == 0 || lines < chan->slice_wait_lines))
+			chan->slice_wait_lines = lines;
+		if(wait)
+			next = frame_channel_slice_next(chan, &buffer->vb);
+		private_spin_unlock_irqrestore(&chan->slock, flags);
+		if(wait)
+			hrtimer_start(&chan->slice_timer, ns_to_ktime(next), HRTIMER_MODE_REL);
+
+		ret = wait_event_interruptible_timeout(chan->slice_wq,
+				buffer->valid_lines >= lines || !q->streaming || (wait && chan->slice_wait_lines == 0),
+				timeout);
+		if(ret < 0)
+			return ret;
+		timeout = ret;
+	} while(ret && buffer->valid_lines < lines && q->streaming);
+
+	slice.lines = buffer->valid_lines;
+	slice.lead_time = slice.lines == chan->fmt.pix.height ? buffer->lead_time : 0;
+	err = copy_to_user((void __user *)arg, &slice, sizeof(slice));
+	if(err){
+		ISP_ERROR("Failed to copy to user\n");
+		return -ENOMEM;
+	}
+	return ret ? 0 : -ETIMEDOUT;
+}
+
+/*
+ * Export a MMAP buffer of a raw channel as a dmabuf, with the packing of the
+ * raw frames. The channel must be the raw output of the bypassed isp.
+ */
+static int frame_channel_export_raw(struct tx_isp_frame_channel *chan, unsigned long arg)
+{
+	struct fs_vb2_queue *q = NULL;
+	struct frame_channel_video_buffer *buffer = NULL;
+	struct frame_channel_raw_buffer raw;
+	int ret = 0;
+
+	if(IS_ERR_OR_NULL(chan)){
+		return -EINVAL;
+	}
+
+	ret = copy_from_user(&raw, (void __user *)arg, sizeof(raw));
+	if(ret){
+		ISP_ERROR("Failed to copy from user\n");
+		return -ENOMEM;
+	}
+
+	q = &chan->vbq;
+	if (q->memory != V4L2_MEMORY_MMAP || raw.index >= q->num_buffers || q->bufs[raw.index] == NULL) {
+		ISP_ERROR("export raw: buffer index out of range or not a MMAP buffer\n");
+		return -EINVAL;
+	}
+
+	ret = tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_GET_RAW_INFO, &raw);
+	if (ret) {
+		ISP_ERROR("export raw: chan%d doesn't output raw frames\n", chan->index);
+		return ret == -ENOIOCTLCMD ? -EPERM : ret;
+	}
+
+	buffer = vb_to_video_buffer(q->bufs[raw.index]);
+	raw.length = chan->fmt.pix.sizeimage;
+	raw.width = chan->fmt.pix.width;
+	raw.height = chan->fmt.pix.height;
+	raw.bytesperline = chan->fmt.pix.bytesperline;
+	raw.fd = frame_channel_mem_export(buffer->mem);
+	if (raw.fd < 0) {
+		ISP_ERROR("export raw: failed to export buffer%d\n", raw.index);
+		return raw.fd;
+	}
+
+	ret = copy_to_user((void __user *)arg, &raw, sizeof(raw));
+	if(ret){
+		ISP_ERROR("Failed to copy to user\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+/*
+ * The frames of the channel are decimated on the dma of the isp, a skipped
+ * frame doesn't take a buffer. The new pattern takes effect on a frame end.
+ */
+static int frame_channel_set_decimate(struct tx_isp_frame_channel *chan, unsigned long arg)
+{
+	struct frame_channel_decimate dec;
+	int ret = 0;
+
+	if(IS_ERR_OR_NULL(chan)){
+		return -EINVAL;
+	}
+
+	ret = copy_from_user(&dec, (void __user *)arg, sizeof(dec));
+	if(ret){
+		ISP_ERROR("Failed to copy from user\n");
+		return -ENOMEM;
+	}
+
+	ret = tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_SET_DECIMATE, &dec);
+	if(ret == -ENOIOCTLCMD)
+		ret = -EPERM;
+	return ret;
+}
+
+static int frame_channel_get_decimate(struct tx_isp_frame_channel *chan, unsigned long arg)
+{
+	struct frame_channel_decimate dec;
+	int ret = 0;
+
+	if(IS_ERR_OR_NULL(chan)){
+		return -EINVAL;
+	}
+
+	memset(&dec, 0, sizeof(dec));
+	ret = tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_GET_DECIMATE, &dec);
+	if(ret && ret != -ENOIOCTLCMD)
+		return ret;
+
+	ret = copy_to_user((void __user *)arg, &dec, sizeof(dec));
+	if(ret){
+		ISP_ERROR("Failed to copy to user\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
 static long frame_channel_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct miscdevice *mdev = file->private_data;
@@ -1128,6 +1877,24 @@ static long frame_channel_unlocked_ioctl(struct file *file, unsigned int cmd, un
 		case VIDIOC_DEFAULT_CMD_LISTEN_BUF:
 			ret = frame_channel_listen_buffer(chan, arg);
 			break;
+		case VIDIOC_DEFAULT_CMD_GET_FRAME_META:
+			ret = frame_channel_get_frame_meta(chan, arg);
+			break;
+		case VIDIOC_DEFAULT_CMD_SET_SLICE:
+			ret = frame_channel_set_slice(chan, arg);
+			break;
+		case VIDIOC_DEFAULT_CMD_WAIT_SLICE:
+			ret = frame_channel_wait_slice(chan, arg);
+			break;
+		case VIDIOC_DEFAULT_CMD_EXPORT_RAW:
+			ret = frame_channel_export_raw(chan, arg);
+			break;
+		case VIDIOC_DEFAULT_CMD_SET_DECIMATE:
+			ret = frame_channel_set_decimate(chan, arg);
+			break;
+		case VIDIOC_DEFAULT_CMD_GET_DECIMATE:
+			ret = frame_channel_get_decimate(chan, arg);
+			break;
 		default:
 			ret = -ENOIOCTLCMD;
 			break;
@@ -1156,6 +1923,14 @@ static int frame_channel_open(struct inode *inode, struct file *file)
 	memset(&chan->fmt, 0, sizeof(chan->fmt));
 	chan->out_frames = 0;
 	chan->losed_frames = 0;
+	chan->slice_lines = 0;
+	chan->slice_frames = 0;
+	chan->slice_wait_lines = 0;
+	chan->slice_line_ns = 0;
+	chan->slice_lead_count = 0;
+	chan->slice_lead_min = 0;
+	chan->slice_lead_max = 0;
+	chan->slice_lead_sum = 0;
 	private_init_completion(&chan->comp);
 	__vb2_queue_free(&chan->vbq, chan->vbq.num_buffers);
 	chan->state = TX_ISP_MODULE_INIT;
@@ -1275,6 +2050,9 @@ static int tx_isp_frame_chan_init(struct tx_isp_frame_channel *chan, struct tx_i
 	private_spin_lock_init(&chan->slock);
 	private_mutex_init(&chan->mlock);
 	private_init_completion(&chan->comp);
+	hrtimer_init(&chan->slice_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	chan->slice_timer.function = frame_channel_slice_timer;
+	init_waitqueue_head(&chan->slice_wq);
 	pad->event = frame_chan_event;
 	chan->state = TX_ISP_MODULE_SLAKE;
 
@@ -1350,6 +2128,15 @@ static int isp_framesource_show(struct seq_file *m, void *v)
 		private_spin_unlock_irqrestore(&chan->slock, flags);
 		len += seq_printf(m ,"the output buffers is: %d\n", chan->out_frames);
 		len += seq_printf(m ,"the losted buffers is: %d\n", chan->losed_frames);
+		if(chan->slice_lines){
+			len += seq_printf(m ,"slice lines: %d\n", chan->slice_lines);
+			len += seq_printf(m ,"the slice buffers is: %d\n", chan->slice_frames);
+			len += seq_printf(m ,"slice line time: %u ns\n", chan->slice_line_ns);
+			if(chan->slice_lead_count)
+				len += seq_printf(m ,"slice lead time: min %u max %u avg %llu us\n",
+						chan->slice_lead_min, chan->slice_lead_max,
+						div_u64(chan->slice_lead_sum, chan->slice_lead_count));
+		}
 	}
 	return len;
 }
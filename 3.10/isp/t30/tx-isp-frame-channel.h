@@ -6,6 +6,8 @@
 #include <media/v4l2-ioctl.h>
 #include <media/videobuf2-core.h>
 #include <linux/proc_fs.h>
+#include <linux/hrtimer.h>
+#include <linux/kref.h>
 
 #include <tx-isp-common.h>
 
@@ -127,9 +129,23 @@ struct frame_channel_buffer {
 	unsigned int priv;
 };
 
+/* the memory of a MMAP buffer, it is shared with the dmabufs exported from it */
+struct frame_channel_mem {
+	struct kref ref;
+	void *vaddr;
+	dma_addr_t dma;
+	size_t size;
+};
+
 struct frame_channel_video_buffer{
 	struct fs_vb2_buffer vb;
 	struct frame_channel_buffer buf;
+	struct frame_channel_meta meta;
+	unsigned int valid_lines;
+	unsigned int slice_marks;	/* the fmt_sequence + 1 the marks were written with */
+	s64 deliver_ns;		/* when it was given to user in slice mode */
+	unsigned int lead_time;	/* us */
+	struct frame_channel_mem *mem;
 };
 
 struct tx_isp_frame_channel {
@@ -147,6 +163,24 @@ struct tx_isp_frame_channel {
 	struct completion comp;
 	unsigned int out_frames;
 	unsigned int losed_frames;
+	/* chan->fmt follows the hardware, the format changes while streaming */
+	unsigned int fmt_sequence;
+
+	/* slice mode, a buffer is dequeued after slice_lines have been written */
+	unsigned int slice_lines;
+	struct fs_vb2_buffer *slice_vb;
+	bool slice_stale;
+	unsigned int slice_stale_line;
+	unsigned int slice_frames;
+	struct hrtimer slice_timer;
+	wait_queue_head_t slice_wq;
+	unsigned int slice_wait_lines;	/* the fewest lines of the waiters */
+	unsigned int slice_line_ns;
+	s64 slice_last_ns;
+	unsigned int slice_lead_count;
+	unsigned int slice_lead_min;
+	unsigned int slice_lead_max;
+	u64 slice_lead_sum;
 	void *priv;
 };
 
@@ -64,6 +64,36 @@ static int csi_phy_release(struct tx_isp_csi_device *csd)
 	return 0;
 }
 
+/*
+ * It is called by vic when an error of input happens. The controller is
+ * reset if the errors of mipi have been latched; the phy and the lanes
+ * are kept, so the next frame is received without configuring again.
+ * Return 1 if the controller has been reset.
+ */
+int tx_isp_csi_recover(void)
+{
+	struct tx_isp_csi_device *csd = dump_csd;
+	unsigned int err1, err2;
+
+	if(csd == NULL || csd->state != TX_ISP_MODULE_RUNNING)
+		return 0;
+	if(csd->vin.attr->dbus_type != TX_SENSOR_DATA_INTERFACE_MIPI)
+		return 0;
+
+	err1 = csi_core_read(csd, ERR1);
+	err2 = csi_core_read(csd, ERR2);
+	if(err1 == 0 && err2 == 0)
+		return 0;
+
+	if(err1)
+		csd->err1_cnt++;
+	if(err2)
+		csd->err2_cnt++;
+	csi_phy_release(csd);
+	csd->recover_cnt++;
+	return 1;
+}
+
 static long csi_phy_start(struct tx_isp_csi_device *csd)
 {
 	csd->state = TX_ISP_MODULE_RUNNING;
@@ -316,6 +346,8 @@ static int isp_csi_show(struct seq_file *m, void *v)
 		len += seq_printf(m ,"0x0024 is  0x%x\n", err2);
 	if ((err1 != 0) || (err2 != 0))
 		len += seq_printf(m ,"0x0014 is  0x%x\n", csi_core_read(csd, PHY_STATE));
+	if (csd->recover_cnt)
+		len += seq_printf(m ,"err1 %d err2 %d recover %d\n", csd->err1_cnt, csd->err2_cnt, csd->recover_cnt);
 	return len;
 }
 
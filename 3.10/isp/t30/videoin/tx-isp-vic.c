@@ -42,6 +42,20 @@ void check_vic_error(void){
 	}
 }
 
+/*
+ * Get the lines that vic has received in current frame and the height
+ * of the frame. The frame channels use it to follow the progress of a frame.
+ */
+int tx_isp_vic_get_line_progress(unsigned int *lines, unsigned int *height)
+{
+	if(dump_vsd == NULL || dump_vsd->state != TX_ISP_MODULE_RUNNING)
+		return -EPERM;
+
+	*lines = tx_isp_vic_readl(dump_vsd, VIC_LINE) & 0xffff;
+	*height = tx_isp_vic_readl(dump_vsd, VIC_RESOLUTION) & 0xffff;
+	return 0;
+}
+
 #if (defined(CONFIG_SOC_T30) || defined(CONFIG_SOC_T21))
 void isp_lfb_ctrl_flb_enable(int on)
 {
@@ -164,7 +178,7 @@ void isp_lfb_ctrl_ncu_to_ddr(void){}
 void isp_lfb_restart(void){}
 void isp_lfb_config_default_dma(unsigned int base, unsigned int uv_offset, int lineoffset, int bank_id){}
 void isp_lfb_config_resolution(unsigned int width, unsigned int height){}
-volatile unsigned int isp_lfb_read_error_reg(void){return 0}
+volatile unsigned int isp_lfb_read_error_reg(void){return 0;}
 #endif
 
 /* interrupt operations */
@@ -426,6 +440,94 @@ static int vic_sensor_ops_sync_sensor_attr(struct tx_isp_subdev *sd, void *arg)
 
 
 
+extern int tx_isp_csi_recover(void);
+
+/* A recovery is tried again if no good frame comes in this time */
+#define VIC_RECOVERY_RETRY_TIME		(HZ / 2)
+
+/*
+ * Reset the blocks of the input path which have errors, and restart vic
+ * from the next start of frame. The buffer queues of the pipeline are
+ * kept, so nothing needs to be done by the user.
+ */
+static void tx_isp_vic_recover(struct tx_isp_vic_device *vd, bool timeout)
+{
+	unsigned int tmp = 0;
+
+	if(vd->state != TX_ISP_MODULE_RUNNING)
+		return;
+
+	if(vd->recovery_state == TX_ISP_VIC_RECOVERY_WAIT_FRAME){
+		if(!timeout && time_before(jiffies, vd->recovery_kick + VIC_RECOVERY_RETRY_TIME))
+			return;
+		vd->recovery_retry_c++;
+	}else{
+		vd->recovery_start = jiffies;
+	}
+
+	if(tx_isp_csi_recover())
+		vd->csi_err_c++;
+	if(isp_lfb_read_error_reg())
+		isp_lfb_restart();
+
+	tmp = tx_isp_vic_readl(vd, VIC_CONTROL);
+	tmp |= VIC_RESET;
+	tx_isp_vic_writel(vd, VIC_CONTROL, tmp);
+	tx_isp_vic_writel(vd, VIC_CONTROL, VIC_SRART);
+
+	vd->recovery_kick = jiffies;
+	vd->recovery_state = TX_ISP_VIC_RECOVERY_WAIT_FRAME;
+}
+
+static void tx_isp_vic_recover_done(struct tx_isp_vic_device *vd)
+{
+	unsigned int ms = jiffies_to_msecs(jiffies - vd->recovery_start);
+
+	vd->recovery_c++;
+	vd->recovery_last_ms = ms;
+	if(ms > vd->recovery_max_ms)
+		vd->recovery_max_ms = ms;
+	vd->recovery_state = TX_ISP_VIC_RECOVERY_IDLE;
+	ISP_INFO("## VIC recovered in %d ms ##\n", ms);
+}
+
+/* The watchdog waits this long for a frame, 3 frames at least */
+#define VIC_WATCHDOG_MIN_MS		500
+
+static u64 tx_isp_vic_watchdog_ns(struct tx_isp_vic_device *vd)
+{
+	unsigned int fps = vd->vin.fps;
+	unsigned int ms = VIC_WATCHDOG_MIN_MS;
+
+	if((fps >> 16) && (fps & 0xffff))
+		ms = max(ms, 3 * 1000 * (fps & 0xffff) / (fps >> 16));
+	return (u64)ms * NSEC_PER_MSEC;
+}
+
+/*
+ * No frame has come in since the last check, the link has gone silent
+ * without an error interrupt or a recovery got no frame: recover again.
+ */
+static enum hrtimer_restart tx_isp_vic_watchdog(struct hrtimer *timer)
+{
+	struct tx_isp_vic_device *vd = container_of(timer, struct tx_isp_vic_device, watchdog);
+	unsigned long flags;
+
+	if(vd->state != TX_ISP_MODULE_RUNNING)
+		return HRTIMER_NORESTART;
+
+	if(vd->vic_frd_c == vd->watchdog_frd_c){
+		/* keep the interrupt routine out of the recovery */
+		local_irq_save(flags);
+		vd->watchdog_c++;
+		tx_isp_vic_recover(vd, true);
+		local_irq_restore(flags);
+	}
+	vd->watchdog_frd_c = vd->vic_frd_c;
+	hrtimer_forward_now(timer, ns_to_ktime(tx_isp_vic_watchdog_ns(vd)));
+	return HRTIMER_RESTART;
+}
+
 static irqreturn_t isp_vic_interrupt_service_routine(struct tx_isp_subdev *sd, u32 status, bool *handled)
 {
 	struct tx_isp_vic_device *vd = IS_ERR_OR_NULL(sd) ? NULL : tx_isp_get_subdevdata(sd);
@@ -450,14 +552,15 @@ static irqreturn_t isp_vic_interrupt_service_routine(struct tx_isp_subdev *sd, u
 #else
 	/*printk("pending=0x%08x, mask = 0x%08x state = 0x%08x\n",pending,mask,state);*/
 	if((0x3 << 20) & pending){
-		tmp = tx_isp_vic_readl(vd, VIC_CONTROL);
-		tmp |= VIC_RESET;
-		tx_isp_vic_writel(vd, VIC_CONTROL, tmp);
+		vd->vic_err_c++;
 		printk("## VIC ERROR status = 0x%08x\n", pending);
 	}
+
 #endif
 
 	if ((0x1<<24) & pending){
+		vd->lfb_err_c++;
+#ifdef CONFIG_SOC_T10
 		ISP_INFO("## [0x%08x] = 0x%08x ##\n",0xb330024c,*(volatile unsigned int*)(0xb330024c));
 		ISP_INFO("## [0x%08x] = 0x%08x ##\n",0xb3300260,*(volatile unsigned int*)(0xb3300260));
 		ISP_INFO("## [0x%08x] = 0x%08x ##\n",0xb3300264,*(volatile unsigned int*)(0xb3300264));
@@ -467,8 +570,16 @@ static irqreturn_t isp_vic_interrupt_service_routine(struct tx_isp_subdev *sd, u
 		ISP_INFO("## [0x%08x] = 0x%08x ##\n",0xb3300274,*(volatile unsigned int*)(0xb3300274));
 		ISP_INFO("## [0x%08x] = 0x%08x ##\n",0xb3300278,*(volatile unsigned int*)(0xb3300278));
 		ISP_INFO("## [0x%08x] = 0x%08x ##\n",0xb330027c,*(volatile unsigned int*)(0xb330027c));
+#else
+		ISP_INFO("## LFB ERROR [0x%08x] = 0x%08x ##\n", LFB_ERR_REG, isp_lfb_read_error_reg());
+#endif
 	}
 
+#ifndef CONFIG_SOC_T10
+	if(((0x3 << 20) | (0x1 << 24)) & pending)
+		tx_isp_vic_recover(vd, false);
+#endif
+
 	if((0x1<<26) & pending){
 		tx_isp_vic_writel(vd, VIC_DMA_CONFIG, 0);
 		private_complete(&vd->snap_comp);
@@ -477,6 +588,10 @@ static irqreturn_t isp_vic_interrupt_service_routine(struct tx_isp_subdev *sd, u
 	if (0x10000 & pending) {
 		vd->vic_frd_c++;
 		/*printk("## vic %d ##\n", vd->vic_frd_c);*/
+		/* a whole frame has been received without error after recovery */
+		if(vd->recovery_state == TX_ISP_VIC_RECOVERY_WAIT_FRAME
+				&& !(((0x3 << 20) | (0x1 << 24)) & pending))
+			tx_isp_vic_recover_done(vd);
 	}
 
 	return IRQ_HANDLED;
@@ -577,12 +692,16 @@ static int vic_core_s_stream(struct tx_isp_subdev *sd, int enable)
 
 	if (enable) {
 		ret = tx_isp_vic_start(vd);
+		vd->recovery_state = TX_ISP_VIC_RECOVERY_IDLE;
 		vd->state = TX_ISP_MODULE_RUNNING;
+		vd->watchdog_frd_c = vd->vic_frd_c;
+		hrtimer_start(&vd->watchdog, ns_to_ktime(tx_isp_vic_watchdog_ns(vd)), HRTIMER_MODE_REL);
 		/*printk("vic------------start 0x%08x\n", tx_isp_sd_readl(sd, TX_ISP_TOP_IRQ_ENABLE));*/
 	}else {
 		/*tx_isp_vic_writel(vd, VIC_CONTROL, GLB_SAFE_RST);*/
 		/*tx_isp_vic_writel(vd, VIC_CONTROL, VIC_RESET);*/
 		vd->state = TX_ISP_MODULE_INIT;
+		hrtimer_cancel(&vd->watchdog);
 	//	dump_vic_reg(vsd);
 		/*printk("vic------------stop 0x%08x\n", tx_isp_sd_readl(sd, TX_ISP_TOP_IRQ_ENABLE));*/
 	}
@@ -764,6 +883,9 @@ static int isp_vic_frd_show(struct seq_file *m, void *v)
 		return 0;
 	}
 	len += seq_printf(m ," %d\n", vd->vic_frd_c);
+	len += seq_printf(m ,"vic errors: %d lfb errors: %d csi errors: %d\n", vd->vic_err_c, vd->lfb_err_c, vd->csi_err_c);
+	len += seq_printf(m ,"recoveries: %d retries: %d watchdog: %d last: %d ms max: %d ms\n",
+			vd->recovery_c, vd->recovery_retry_c, vd->watchdog_c, vd->recovery_last_ms, vd->recovery_max_ms);
 	return len;
 }
 static int dump_isp_vic_frd_open(struct inode *inode, struct file *file)
@@ -808,6 +930,8 @@ static int tx_isp_vic_probe(struct platform_device *pdev)
 
 	private_mutex_init(&vsd->snap_mlock);
 	private_init_completion(&vsd->snap_comp);
+	hrtimer_init(&vsd->watchdog, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	vsd->watchdog.function = tx_isp_vic_watchdog;
 	tx_isp_set_subdevdata(sd, vsd);
 	vsd->state = TX_ISP_MODULE_SLAKE;
 	dump_vsd = vsd;
@@ -825,6 +949,7 @@ static int __exit tx_isp_vic_remove(struct platform_device *pdev)
 	struct tx_isp_subdev *sd = IS_ERR_OR_NULL(module) ? NULL : module_to_subdev(module);
 	struct tx_isp_vic_device *vsd = IS_ERR_OR_NULL(sd) ? NULL : tx_isp_get_subdevdata(sd);
 	private_platform_set_drvdata(pdev, NULL);
+	hrtimer_cancel(&vsd->watchdog);
 	tx_isp_subdev_deinit(sd);
 	kfree(vsd);
 	return 0;
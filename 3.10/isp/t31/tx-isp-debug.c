@@ -2,6 +2,10 @@
 #include <linux/module.h>
 #include <tx-isp-debug.h>
 #include <linux/vmalloc.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
 
 /* -------------------debugfs interface------------------- */
 static int print_level = ISP_WARNING_LEVEL;
@@ -36,27 +40,239 @@ extern int isp_memopt;
 module_param(isp_memopt, int, S_IRUGO);
 MODULE_PARM_DESC(isp_memopt, "isp memory optimize");
 
+/*
+ * The messages are formatted into a ring and printed to the console by a
+ * worker, so a recurring error in an interrupt or a per-frame path doesn't
+ * stall the isp. Every call site may print ISP_LOG_SITE_BURST messages in
+ * ISP_LOG_SITE_INTERVAL, the others are counted and reported with the next
+ * message; the stack is dumped once for every call site of errors.
+ * The call sites are kept in a small table, the least recently used one
+ * gives its place up; the sites whose stack has been dumped are kept apart,
+ * so an evicted site doesn't dump it again. A message is cut at
+ * ISP_LOG_MSG_LEN bytes.
+ * The recent messages can be read from /proc/jz/isp-log.
+ */
+#define ISP_LOG_RING_SIZE	64
+#define ISP_LOG_MSG_LEN		256
+#define ISP_LOG_SITES		32
+#define ISP_LOG_DUMPED		64
+#define ISP_LOG_SITE_BURST	10
+#define ISP_LOG_SITE_INTERVAL	(5 * HZ)
+#define ISP_LOG_PROC_NAME	"jz/isp-log"
+
+struct isp_log_entry {
+	unsigned long long ts;
+	unsigned int level;
+	unsigned int suppressed;
+	char msg[ISP_LOG_MSG_LEN];
+};
+
+struct isp_log_site {
+	unsigned long caller;
+	unsigned long begin;
+	unsigned long last;
+	unsigned int printed;
+	unsigned int suppressed;
+};
+
+static struct isp_log_entry isp_log_ring[ISP_LOG_RING_SIZE];
+static unsigned int isp_log_head;	/* the count of messages */
+static unsigned int isp_log_tail;	/* the next message to the console */
+static unsigned int isp_log_lost;
+static struct isp_log_site isp_log_sites[ISP_LOG_SITES];
+static unsigned long isp_log_dumped[ISP_LOG_DUMPED];
+static unsigned int isp_log_ndumped;
+static DEFINE_SPINLOCK(isp_log_lock);
+
+static void isp_log_work_func(struct work_struct *work)
+{
+	struct isp_log_entry entry;
+	unsigned long flags = 0;
+	unsigned int lost = 0;
+
+	spin_lock_irqsave(&isp_log_lock, flags);
+	while(isp_log_tail != isp_log_head){
+		entry = isp_log_ring[isp_log_tail % ISP_LOG_RING_SIZE];
+		isp_log_tail++;
+		lost = isp_log_lost;
+		isp_log_lost = 0;
+		spin_unlock_irqrestore(&isp_log_lock, flags);
+
+		if(lost)
+			printk(KERN_WARNING "isp: %u messages are lost\n", lost);
+		if(entry.suppressed)
+			printk(KERN_WARNING "isp: %u messages are suppressed\n", entry.suppressed);
+		printk("%s", entry.msg);
+
+		spin_lock_irqsave(&isp_log_lock, flags);
+	}
+	spin_unlock_irqrestore(&isp_log_lock, flags);
+}
+static DECLARE_WORK(isp_log_work, isp_log_work_func);
+
+/*
+ * It is called with isp_log_lock held. Once ISP_LOG_DUMPED sites have
+ * dumped their stack no more stacks are dumped.
+ */
+static bool isp_log_dump_once(unsigned long caller)
+{
+	unsigned int i;
+
+	for(i = 0; i < isp_log_ndumped; i++){
+		if(isp_log_dumped[i] == caller)
+			return false;
+	}
+	if(isp_log_ndumped == ISP_LOG_DUMPED)
+		return false;
+	isp_log_dumped[isp_log_ndumped++] = caller;
+	return true;
+}
+
+/* It is called with isp_log_lock held */
+static bool isp_log_site_allow(unsigned long caller, unsigned int level, unsigned int *suppressed, bool *dump)
+{
+	struct isp_log_site *site = NULL;
+	struct isp_log_site *lru = &isp_log_sites[0];
+	unsigned int i;
+
+	for(i = 0; i < ISP_LOG_SITES; i++){
+		if(isp_log_sites[i].caller == caller){
+			site = &isp_log_sites[i];
+			break;
+		}
+		if(lru->caller && (!isp_log_sites[i].caller || time_before(isp_log_sites[i].last, lru->last)))
+			lru = &isp_log_sites[i];
+	}
+	if(!site){
+		site = lru;
+		memset(site, 0, sizeof(*site));
+		site->caller = caller;
+		site->begin = jiffies;
+	}
+	site->last = jiffies;
+
+	if(time_after(jiffies, site->begin + ISP_LOG_SITE_INTERVAL)){
+		site->begin = jiffies;
+		site->printed = 0;
+	}
+
+	if(site->printed >= ISP_LOG_SITE_BURST){
+		site->suppressed++;
+		return false;
+	}
+
+	site->printed++;
+	*suppressed = site->suppressed;
+	site->suppressed = 0;
+	if(level >= ISP_ERROR_LEVEL && isp_log_dump_once(caller))
+		*dump = true;
+	return true;
+}
+
 int isp_printf(unsigned int level, unsigned char *fmt, ...)
 {
-	struct va_format vaf;
+	unsigned long caller = (unsigned long)__builtin_return_address(0);
+	struct isp_log_entry *entry = NULL;
+	unsigned int suppressed = 0;
+	unsigned long flags = 0;
+	bool dump = false;
 	va_list args;
 	int r = 0;
 
-	if(level >= print_level){
-		va_start(args, fmt);
+	if(level < print_level)
+		return 0;
 
-		vaf.fmt = fmt;
-		vaf.va = &args;
+	spin_lock_irqsave(&isp_log_lock, flags);
+	if(!isp_log_site_allow(caller, level, &suppressed, &dump)){
+		spin_unlock_irqrestore(&isp_log_lock, flags);
+		return 0;
+	}
 
-		r = printk("%pV",&vaf);
-		va_end(args);
-		if(level >= ISP_ERROR_LEVEL)
-			dump_stack();
+	/* the oldest message is overwritten if the worker is late */
+	if(isp_log_head - isp_log_tail >= ISP_LOG_RING_SIZE){
+		isp_log_tail++;
+		isp_log_lost++;
 	}
+	entry = &isp_log_ring[isp_log_head % ISP_LOG_RING_SIZE];
+	entry->ts = local_clock();
+	entry->level = level;
+	entry->suppressed = suppressed;
+	va_start(args, fmt);
+	r = vscnprintf(entry->msg, sizeof(entry->msg), (const char *)fmt, args);
+	va_end(args);
+	isp_log_head++;
+	spin_unlock_irqrestore(&isp_log_lock, flags);
+
+	schedule_work(&isp_log_work);
+	if(dump)
+		dump_stack();
 	return r;
 }
 EXPORT_SYMBOL(isp_printf);
 
+static int isp_log_show(struct seq_file *m, void *v)
+{
+	struct isp_log_entry entry;
+	unsigned long long ts = 0;
+	unsigned long flags = 0;
+	unsigned int head, index;
+	unsigned long rem;
+	const char *msg;
+	size_t len;
+
+	spin_lock_irqsave(&isp_log_lock, flags);
+	head = isp_log_head;
+	spin_unlock_irqrestore(&isp_log_lock, flags);
+
+	index = head > ISP_LOG_RING_SIZE ? head - ISP_LOG_RING_SIZE : 0;
+	for(; index != head; index++){
+		spin_lock_irqsave(&isp_log_lock, flags);
+		if(isp_log_head - index > ISP_LOG_RING_SIZE){
+			/* it has been overwritten */
+			spin_unlock_irqrestore(&isp_log_lock, flags);
+			continue;
+		}
+		entry = isp_log_ring[index % ISP_LOG_RING_SIZE];
+		spin_unlock_irqrestore(&isp_log_lock, flags);
+
+		ts = entry.ts;
+		rem = do_div(ts, 1000000000);
+		if(entry.suppressed)
+			seq_printf(m, "[%5lu.%06lu] %u messages are suppressed\n",
+					(unsigned long)ts, rem / 1000, entry.suppressed);
+		msg = printk_skip_level(entry.msg);
+		len = strlen(msg);
+		seq_printf(m, "[%5lu.%06lu] <%u> %s%s", (unsigned long)ts, rem / 1000,
+				entry.level, msg, (len && msg[len - 1] == '\n') ? "" : "\n");
+	}
+	return 0;
+}
+
+static int isp_log_open(struct inode *inode, struct file *file)
+{
+	return single_open_size(file, isp_log_show, NULL, ISP_LOG_RING_SIZE * (ISP_LOG_MSG_LEN + 64));
+}
+
+static const struct file_operations isp_log_fops = {
+	.read = seq_read,
+	.open = isp_log_open,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int isp_log_init(void)
+{
+	if(proc_create(ISP_LOG_PROC_NAME, S_IRUGO, NULL, &isp_log_fops) == NULL)
+		printk(KERN_WARNING "isp: failed to create /proc/%s\n", ISP_LOG_PROC_NAME);
+	return 0;
+}
+
+void isp_log_exit(void)
+{
+	remove_proc_entry(ISP_LOG_PROC_NAME, NULL);
+	flush_work(&isp_log_work);
+}
+
 int get_isp_clk(void)
 {
 	return isp_clk;
@@ -13,15 +13,30 @@
 
 extern int tx_isp_init(void);
 extern void tx_isp_exit(void);
+extern int isp_log_init(void);
+extern void isp_log_exit(void);
+extern int isp_mem_init(void);
+extern void isp_mem_exit(void);
 
 static int __init tx_isp_module_init(void)
 {
-	return tx_isp_init();
+	int ret = 0;
+
+	isp_log_init();
+	isp_mem_init();
+	ret = tx_isp_init();
+	if(ret){
+		isp_mem_exit();
+		isp_log_exit();
+	}
+	return ret;
 }
 
 static void __exit tx_isp_module_exit(void)
 {
 	tx_isp_exit();
+	isp_mem_exit();
+	isp_log_exit();
 }
 
 module_init(tx_isp_module_init);
@@ -0,0 +1,175 @@
+#ifndef SENSOR_CORE_H
+#define SENSOR_CORE_H
+
+#include <linux/i2c.h>
+#include <linux/platform_device.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
+#include <tx-isp-common.h>
+#include <sensor-common.h>
+
+/*
+ * Shared register I/O, table playback, fps math, power sequencing and
+ * subdev glue of the sensor drivers. A converted driver describes its
+ * chip by a struct sensor_core_desc and keeps only the exposure, gain
+ * and mode code that is really specific to it.
+ */
+
+struct regval_list {
+	uint16_t reg_num;
+	unsigned char value;
+};
+
+/* One step of a power sequence, the sequence ends at level < 0 */
+struct sensor_gpio_step {
+	int level;
+	unsigned int delay_ms;
+};
+
+#define SENSOR_GPIO_SEQ_END {-1, 0}
+
+/* The registers that take a sensor from one init table to another */
+struct sensor_core_delta {
+	struct regval_list *from;
+	struct regval_list *to;
+	struct regval_list *delta;		/* generated by tools/gen-sensor-deltas.sh */
+};
+
+struct sensor_core_desc {
+	const char *name;
+	const char *version;
+	const char *mclk_name;			/* NULL for cgu_cim */
+	unsigned char reg_bytes;		/* 1 or 2 bytes register address */
+	unsigned char burst_len;		/* max registers of one auto-increment write, 0 for one */
+	uint16_t reg_end;
+	uint16_t reg_delay;
+	uint16_t id_reg[2];			/* chip id registers, high byte first */
+	unsigned char id_val[2];
+	const struct sensor_gpio_step *reset_seq;
+	const struct sensor_gpio_step *pwdn_seq;
+	struct regval_list *stream_on_dvp;
+	struct regval_list *stream_off_dvp;
+	struct regval_list *stream_on_mipi;
+	struct regval_list *stream_off_mipi;
+	struct regval_list *hold_on;		/* group hold around the per frame writes */
+	struct regval_list *hold_off;
+	uint16_t page_reg;			/* page select register, 0 for none */
+	const uint16_t *volatile_regs;		/* never served from the shadow */
+	unsigned int nr_volatile;
+	const struct sensor_core_delta *deltas;	/* mode switches without a full init */
+	unsigned int nr_deltas;
+};
+
+/* Bus cost of the init table playback */
+struct sensor_core_stats {
+	unsigned int tables;
+	unsigned int regs;			/* registers written */
+	unsigned int xfers;			/* i2c_transfer calls */
+	unsigned int msgs;			/* i2c messages, one per burst */
+	unsigned int us;			/* wall time, delays included */
+};
+
+/* Line timing of the active mode, the fps changes need no bus reads */
+struct sensor_core_timing {
+	unsigned int sclk;			/* pixel clock */
+	unsigned int hts;			/* line length in sclk cycles */
+	unsigned int min_fps;
+	unsigned int max_fps;
+	unsigned int margin;			/* lines the exposure must stay below vts */
+};
+
+#define SENSOR_CORE_CACHE_SIZE 64
+
+struct sensor_core_cache {
+	uint16_t key;
+	unsigned char value;
+	unsigned char valid;
+};
+
+/* Identical sensors one driver can serve, the size of its parameter arrays */
+#define SENSOR_CORE_MAX_INSTANCES 2
+
+/*
+ * The per device state, the tx_isp_sensor is handed to the isp as before.
+ * Everything a running sensor changes lives here and not in the driver,
+ * so the instances stream and run their AE independently.
+ */
+struct sensor_core {
+	struct tx_isp_sensor sensor;
+	const struct sensor_core_desc *desc;
+	int id;					/* instance, indexes the module parameters */
+	struct platform_device pdev;		/* copy of the driver's device */
+	struct tx_isp_sensor_attribute attr;	/* copy of the driver's attr */
+	struct tx_isp_sensor_win_setting *wsize;	/* the active mode */
+	unsigned int again;			/* the last analog gain written */
+	char proc_name[32];
+	int reset_gpio;
+	int pwdn_gpio;
+	int data_interface;
+	int streaming;
+	struct sensor_core_stats last;		/* the last table */
+	struct sensor_core_stats total;
+	struct sensor_core_timing timing;
+	struct sensor_core_cache cache[SENSOR_CORE_CACHE_SIZE];
+	int page;				/* current page, -1 when unknown */
+	unsigned int dropped_writes;
+	unsigned int cached_reads;
+	unsigned int skipped_syncs;		/* attr syncs with nothing changed */
+	int resync;				/* the mode changed, the next sync is not skipped */
+	/* the init table is played by init_work while the isp sets itself up */
+	struct workqueue_struct *init_wq;
+	struct work_struct init_work;
+	struct completion init_done;		/* complete while no table is pending */
+	struct regval_list *init_vals;
+	int init_ret;
+	ktime_t init_start;
+	unsigned int init_queue_us;		/* queued until played */
+	unsigned int init_play_us;
+	unsigned int init_wait_us;		/* the first access waited for it */
+};
+
+static inline struct sensor_core *sd_to_sensor_core(struct tx_isp_subdev *sd) {
+	return container_of(sd_to_sensor_device(sd), struct sensor_core, sensor);
+}
+
+/* register I/O */
+int sensor_core_read(struct tx_isp_subdev *sd, uint16_t reg, unsigned char *value);
+int sensor_core_write(struct tx_isp_subdev *sd, uint16_t reg, unsigned char value);
+int sensor_core_read_array(struct tx_isp_subdev *sd, struct regval_list *vals);
+int sensor_core_write_array(struct tx_isp_subdev *sd, struct regval_list *vals);
+void sensor_core_cache_invalidate(struct sensor_core *core);
+int sensor_core_write_group(struct tx_isp_subdev *sd, struct regval_list *vals, unsigned int count);
+int sensor_core_init_async(struct tx_isp_subdev *sd, struct regval_list *vals);
+
+/* fps, the fps is 16/16 fixed point, 25 << 16 | 2 means 25/2 fps */
+int sensor_core_fps_check(int fps, unsigned int min_fps, unsigned int max_fps);
+unsigned int sensor_core_fps_to_vts(unsigned int sclk, unsigned int hts, int fps);
+unsigned int sensor_core_fps_vts(struct tx_isp_subdev *sd, int fps);
+int sensor_core_sync_vts(struct tx_isp_subdev *sd, int fps, unsigned int vts);
+/* gain, lut is an array of structs with an unsigned int gain member */
+int sensor_core_gain_index(const void *lut, unsigned int n, size_t stride, size_t offset,
+			   unsigned int max_gain, unsigned int isp_gain);
+#define sensor_core_again_index(lut, max_gain, isp_gain)			\
+	sensor_core_gain_index(lut, ARRAY_SIZE(lut), sizeof((lut)[0]),		\
+			       offsetof(typeof((lut)[0]), gain), max_gain, isp_gain)
+
+void sensor_core_set_video(struct tx_isp_sensor *sensor, struct tx_isp_sensor_win_setting *wsize);
+
+/* subdev ops */
+int sensor_core_stream(struct tx_isp_subdev *sd, int enable);
+int sensor_core_s_stream(struct tx_isp_subdev *sd, int enable);
+int sensor_core_switch_mode(struct tx_isp_subdev *sd, struct tx_isp_sensor_win_setting *wsize);
+int sensor_core_detect(struct tx_isp_subdev *sd, unsigned int *ident);
+int sensor_core_g_chip_ident(struct tx_isp_subdev *sd, struct tx_isp_chip_ident *chip);
+int sensor_core_g_register(struct tx_isp_subdev *sd, struct tx_isp_dbg_register *reg);
+int sensor_core_s_register(struct tx_isp_subdev *sd, const struct tx_isp_dbg_register *reg);
+
+/* probe glue */
+struct sensor_core *sensor_core_alloc(const struct sensor_core_desc *desc, unsigned long mclk_rate);
+void sensor_core_register(struct sensor_core *core, struct platform_device *pdev,
+			  struct tx_isp_subdev_ops *ops, struct i2c_client *client);
+void sensor_core_free(struct sensor_core *core);
+int sensor_core_remove(struct i2c_client *client);
+
+#endif // SENSOR_CORE_H
@@ -15,6 +15,7 @@
 #include <tx-isp-common.h>
 #include <sensor-common.h>
 #include <sensor-info.h>
+#include <sensor-core.h>
 
 #define SENSOR_NAME "gc2053"
 #define SENSOR_BUS_TYPE TX_SENSOR_CONTROL_INTERFACE_I2C
@@ -36,34 +37,30 @@
 #define SENSOR_OUTPUT_MIN_FPS 5
 #define SENSOR_VERSION "H20230726a"
 
-static unsigned char vts0 = 0x05;
-static unsigned char vts1 = 0x8a;
-static unsigned char vtsn0 = 0x05;
-static unsigned char vtsn1 = 0x8a;
 
-static int reset_gpio = GPIO_PA(18);
-module_param(reset_gpio, int, S_IRUGO);
-MODULE_PARM_DESC(reset_gpio, "Reset GPIO NUM");
+static int reset_gpio[SENSOR_CORE_MAX_INSTANCES] = {GPIO_PA(18), -1};
+module_param_array(reset_gpio, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(reset_gpio, "Reset GPIO NUM, one per sensor");
 
-static int pwdn_gpio = -1;
-module_param(pwdn_gpio, int, S_IRUGO);
-MODULE_PARM_DESC(pwdn_gpio, "Power down GPIO NUM");
+static int pwdn_gpio[SENSOR_CORE_MAX_INSTANCES] = {-1, -1};
+module_param_array(pwdn_gpio, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(pwdn_gpio, "Power down GPIO NUM, one per sensor");
 
 static int sensor_gpio_func = DVP_PA_LOW_10BIT;
 module_param(sensor_gpio_func, int, S_IRUGO);
 MODULE_PARM_DESC(sensor_gpio_func, "Sensor GPIO function");
 
-static int data_interface = TX_SENSOR_DATA_INTERFACE_MIPI;
-module_param(data_interface, int, S_IRUGO);
-MODULE_PARM_DESC(data_interface, "Sensor Date interface");
+static int data_interface[SENSOR_CORE_MAX_INSTANCES] = {TX_SENSOR_DATA_INTERFACE_MIPI, TX_SENSOR_DATA_INTERFACE_MIPI};
+module_param_array(data_interface, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(data_interface, "Sensor Date interface, one per sensor");
 
-static int sensor_max_fps = TX_SENSOR_MAX_FPS_30;
-module_param(sensor_max_fps, int, S_IRUGO);
-MODULE_PARM_DESC(sensor_max_fps, "Sensor Max Fps set interface");
+static int sensor_max_fps[SENSOR_CORE_MAX_INSTANCES] = {TX_SENSOR_MAX_FPS_30, TX_SENSOR_MAX_FPS_30};
+module_param_array(sensor_max_fps, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(sensor_max_fps, "Sensor Max Fps set interface, one per sensor");
 
-static int shvflip = 0;
-module_param(shvflip, int, S_IRUGO);
-MODULE_PARM_DESC(shvflip, "Sensor HV Flip Enable interface");
+static int shvflip[SENSOR_CORE_MAX_INSTANCES] = {0, 0};
+module_param_array(shvflip, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(shvflip, "Sensor HV Flip Enable interface, one per sensor");
 
 static struct sensor_info sensor_info = {
 	.name = SENSOR_NAME,
@@ -76,11 +73,6 @@ static struct sensor_info sensor_info = {
 	.height = SENSOR_MAX_HEIGHT,
 };
 
-struct regval_list {
-    uint16_t reg_num;
-    unsigned char value;
-};
-
 struct again_lut {
     int index;
     unsigned int regb4;
@@ -126,23 +118,12 @@ struct again_lut sensor_again_lut[] = {
 struct tx_isp_sensor_attribute sensor_attr;
 
 unsigned int sensor_alloc_again(unsigned int isp_gain, unsigned char shift, unsigned int *sensor_again) {
-	struct again_lut *lut = sensor_again_lut;
-	while (lut->gain <= sensor_attr.max_again) {
-		if (isp_gain == 0) {
-			*sensor_again = lut[0].index;
-			return lut[0].gain;
-		} else if (isp_gain < lut->gain) {
-			*sensor_again = (lut - 1)->index;
-			return (lut - 1)->gain;
-		} else {
-			if ((lut->gain == sensor_attr.max_again) && (isp_gain >= lut->gain)) {
-				*sensor_again = lut->index;
-				return lut->gain;
-			}
-		}
-		lut++;
-	}
-	return isp_gain;
+	int i = sensor_core_again_index(sensor_again_lut, sensor_attr.max_again, isp_gain);
+
+	if (i < 0)
+		return isp_gain;
+	*sensor_again = sensor_again_lut[i].index;
+	return sensor_again_lut[i].gain;
 }
 
 unsigned int sensor_alloc_dgain(unsigned int isp_gain, unsigned char shift, unsigned int *sensor_dgain) {
@@ -1150,6 +1131,65 @@ static struct regval_list sensor_init_regs_1920_1080_40fps_mipi[] = {
 	{SENSOR_REG_END, 0x00},
 };
 
+/* BEGIN SENSOR_DELTAS, generated by tools/gen-sensor-deltas.sh
+ * page 0xfe
+ * 1920_1080_15fps_mipi 1920_1080_25fps_mipi
+ * 1920_1080_15fps_mipi 1920_1080_30fps_mipi
+ * 1920_1080_25fps_mipi 1920_1080_30fps_mipi
+ * 1920_1080_15fps_dvp 1920_1080_30fps_dvp
+ */
+static struct regval_list sensor_delta_1920_1080_15fps_mipi_to_1920_1080_25fps_mipi[] = {
+	{0xfe, 0x00},
+	{0xf6, 0x84},
+	{0xf7, 0x11},
+	{0xf8, 0x3c},
+	{0xf9, 0x82},
+	{0x41, 0x05},
+	{0x42, 0x1c},
+	{0xfe, 0x03},
+	{0x03, 0xb6},
+	{0x15, 0x10},
+	{SENSOR_REG_END, 0x00},
+};
+
+static struct regval_list sensor_delta_1920_1080_15fps_mipi_to_1920_1080_30fps_mipi[] = {
+	{0xfe, 0x00},
+	{0xf7, 0x01},
+	{SENSOR_REG_END, 0x00},
+};
+
+static struct regval_list sensor_delta_1920_1080_25fps_mipi_to_1920_1080_30fps_mipi[] = {
+	{0xfe, 0x00},
+	{0xf6, 0x44},
+	{0xf7, 0x01},
+	{0xf8, 0x68},
+	{0xf9, 0x40},
+	{0x41, 0x04},
+	{0x42, 0x9d},
+	{0xfe, 0x03},
+	{0x03, 0x8e},
+	{0x15, 0x12},
+	{SENSOR_REG_END, 0x00},
+};
+
+static struct regval_list sensor_delta_1920_1080_15fps_dvp_to_1920_1080_30fps_dvp[] = {
+	{0xfe, 0x00},
+	{0xf7, 0x01},
+	{0x07, 0x00},
+	{0x08, 0x11},
+	{0x41, 0x05},
+	{0x42, 0x46},
+	{SENSOR_REG_END, 0x00},
+};
+
+static const struct sensor_core_delta sensor_deltas[] = {
+	{sensor_init_regs_1920_1080_15fps_mipi, sensor_init_regs_1920_1080_25fps_mipi, sensor_delta_1920_1080_15fps_mipi_to_1920_1080_25fps_mipi},
+	{sensor_init_regs_1920_1080_15fps_mipi, sensor_init_regs_1920_1080_30fps_mipi, sensor_delta_1920_1080_15fps_mipi_to_1920_1080_30fps_mipi},
+	{sensor_init_regs_1920_1080_25fps_mipi, sensor_init_regs_1920_1080_30fps_mipi, sensor_delta_1920_1080_25fps_mipi_to_1920_1080_30fps_mipi},
+	{sensor_init_regs_1920_1080_15fps_dvp, sensor_init_regs_1920_1080_30fps_dvp, sensor_delta_1920_1080_15fps_dvp_to_1920_1080_30fps_dvp},
+};
+/* END SENSOR_DELTAS */
+
 static struct tx_isp_sensor_win_setting sensor_win_sizes[] = {
 	/* 1920*1080 @ max 25fps dvp*/
 	{
@@ -1207,153 +1247,115 @@ static struct tx_isp_sensor_win_setting sensor_win_sizes[] = {
 	},
 };
 
-struct tx_isp_sensor_win_setting *wsize = &sensor_win_sizes[5];
+/* The fps classes, sensor_max_fps picks one of its interface at probe */
+struct sensor_mode {
+	int data_interface;
+	int fps_class;				/* the sensor_max_fps value */
+	unsigned int max_fps;
+	unsigned int sclk;
+	unsigned int vts;
+	unsigned int one_line_expr_in_us;
+	struct tx_isp_sensor_win_setting *wsize;
+};
 
+static const struct sensor_mode sensor_modes[] = {
+	{TX_SENSOR_DATA_INTERFACE_DVP, TX_SENSOR_MAX_FPS_30, SENSOR_OUTPUT_MAX_FPS,
+	 SENSOR_SUPPORT_30FPS_DVP_SCLK, 0x546, 29, &sensor_win_sizes[0]},
+	{TX_SENSOR_DATA_INTERFACE_DVP, TX_SENSOR_MAX_FPS_15, TX_SENSOR_MAX_FPS_15,
+	 SENSOR_SUPPORT_15FPS_DVP_SCLK, 0x465, 59, &sensor_win_sizes[1]},
+	{TX_SENSOR_DATA_INTERFACE_MIPI, TX_SENSOR_MAX_FPS_30, SENSOR_OUTPUT_MAX_FPS,
+	 SENSOR_SUPPORT_30FPS_MIPI_SCLK, 0x58a, 28, &sensor_win_sizes[2]},
+	{TX_SENSOR_DATA_INTERFACE_MIPI, TX_SENSOR_MAX_FPS_25, TX_SENSOR_MAX_FPS_25,
+	 SENSOR_SUPPORT_25FPS_MIPI_SCLK, 0x51c, 31, &sensor_win_sizes[3]},
+	{TX_SENSOR_DATA_INTERFACE_MIPI, TX_SENSOR_MAX_FPS_15, TX_SENSOR_MAX_FPS_15,
+	 SENSOR_SUPPORT_15FPS_MIPI_SCLK, 0x49d, 57, &sensor_win_sizes[4]},
+	{TX_SENSOR_DATA_INTERFACE_MIPI, TX_SENSOR_MAX_FPS_40, TX_SENSOR_MAX_FPS_40,
+	 SENSOR_SUPPORT_40FPS_MIPI_SCLK, 0x465, 11, &sensor_win_sizes[5]},
+};
+
+
+/* the output enable of page 0, the init tables already end with it on */
 static struct regval_list sensor_stream_on_dvp[] = {
+	{0xfe, 0x00},
+	{0x3e, 0x40},
 	{SENSOR_REG_END, 0x00},
 };
 
 static struct regval_list sensor_stream_off_dvp[] = {
+	{0xfe, 0x00},
+	{0x3e, 0x00},
 	{SENSOR_REG_END, 0x00},
 };
 
 static struct regval_list sensor_stream_on_mipi[] = {
+	{0xfe, 0x00},
+	{0x3e, 0x91},
 	{SENSOR_REG_END, 0x00},
 };
 
 static struct regval_list sensor_stream_off_mipi[] = {
+	{0xfe, 0x00},
+	{0x3e, 0x00},
 	{SENSOR_REG_END, 0x00},
 };
 
-int sensor_read(struct tx_isp_subdev *sd, unsigned char reg, unsigned char *value) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	struct i2c_msg msg[2] = {
-		[0] = {
-			.addr = client->addr,
-			.flags = 0,
-			.len = 1,
-			.buf = &reg,
-		},
-		[1] = {
-			.addr = client->addr,
-			.flags = I2C_M_RD,
-			.len = 1,
-			.buf = value,
-		}
-	};
-	int ret;
-	ret = private_i2c_transfer(client->adapter, msg, 2);
-	if (ret > 0)
-		ret = 0;
-
-	return ret;
-}
-
-int sensor_write(struct tx_isp_subdev *sd, unsigned char reg, unsigned char value) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	unsigned char buf[2] = {reg, value};
-	struct i2c_msg msg = {
-		.addr = client->addr,
-		.flags = 0,
-		.len = 2,
-		.buf = buf,
-	};
-	int ret;
-	ret = private_i2c_transfer(client->adapter, &msg, 1);
-	if (ret > 0)
-		ret = 0;
-
-	return ret;
-}
+static const struct sensor_gpio_step sensor_reset_seq[] = {
+	{1, 20}, {0, 20}, {1, 10},
+	SENSOR_GPIO_SEQ_END,
+};
 
-#if 0
-static int sensor_read_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
-	int ret;
-	unsigned char val;
-	while (vals->reg_num != SENSOR_REG_END) {
-		if (vals->reg_num == SENSOR_REG_DELAY) {
-			private_msleep(vals->value);
-		} else {
-			ret = sensor_read(sd, vals->reg_num, &val);
-			if (ret < 0)
-				return ret;
-		}
-		vals++;
-	}
-	return 0;
-}
-#endif
+static const struct sensor_gpio_step sensor_pwdn_seq[] = {
+	{1, 10}, {0, 10}, {1, 10},
+	SENSOR_GPIO_SEQ_END,
+};
 
-static int sensor_write_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
-	int ret;
-	while (vals->reg_num != SENSOR_REG_END) {
-		if (vals->reg_num == SENSOR_REG_DELAY) {
-			private_msleep(vals->value);
-		} else {
-			ret = sensor_write(sd, vals->reg_num, vals->value);
-			if (ret < 0)
-				return ret;
-		}
-		vals++;
-	}
-	return 0;
-}
+static const struct sensor_core_desc sensor_desc = {
+	.name = SENSOR_NAME,
+	.version = SENSOR_VERSION,
+	.reg_bytes = 1,
+	.burst_len = 32,
+	.reg_end = SENSOR_REG_END,
+	.reg_delay = SENSOR_REG_DELAY,
+	.id_reg = {0xf0, 0xf1},
+	.id_val = {SENSOR_CHIP_ID_H, SENSOR_CHIP_ID_L},
+	.reset_seq = sensor_reset_seq,
+	.pwdn_seq = sensor_pwdn_seq,
+	.stream_on_dvp = sensor_stream_on_dvp,
+	.stream_off_dvp = sensor_stream_off_dvp,
+	.stream_on_mipi = sensor_stream_on_mipi,
+	.stream_off_mipi = sensor_stream_off_mipi,
+	.page_reg = 0xfe,
+	.deltas = sensor_deltas,
+	.nr_deltas = ARRAY_SIZE(sensor_deltas),
+};
 
 static int sensor_reset(struct tx_isp_subdev *sd, int val) {
 	return 0;
 }
 
-static int sensor_detect(struct tx_isp_subdev *sd, unsigned int *ident) {
-	unsigned char v;
-	int ret;
-	ret = sensor_read(sd, 0xf0, &v);
-	ISP_WARNING("-----%s: %d ret = %d, v = 0x%02x\n", __func__, __LINE__, ret, v);
-	if (ret < 0)
-		return ret;
-
-	if (v != SENSOR_CHIP_ID_H)
-		return -ENODEV;
-
-	ret = sensor_read(sd, 0xf1, &v);
-	ISP_WARNING("-----%s: %d ret = %d, v = 0x%02x\n", __func__, __LINE__, ret, v);
-	if (ret < 0)
-		return ret;
-
-	if (v != SENSOR_CHIP_ID_L)
-		return -ENODEV;
-
-	*ident = (*ident << 8) | v;
-	return 0;
-}
-
 static int sensor_set_expo(struct tx_isp_subdev *sd, int value) {
 	int ret = 0;
 	int it = (value & 0xffff);
 	int again = (value & 0xffff0000) >> 16;
 	struct again_lut *val_lut = sensor_again_lut;
+	struct regval_list regs[7];
+	int n = 0;
 
 	/* sensor reg page */
-	ret = sensor_write(sd, 0xfe, 0x00);
-
-	/* vts */
-	if (vtsn0 != vts0) {
-		vts0 = vtsn0;
-		ret += sensor_write(sd, 0x41, vtsn0);
-	}
-	if (vtsn1 != vts1) {
-		vts1 = vtsn1;
-		ret += sensor_write(sd, 0x42, vtsn1);
-	}
+	regs[n++] = (struct regval_list) {0xfe, 0x00};
 
 	/* integration time */
-	ret += sensor_write(sd, 0x04, it & 0xff);
-	ret += sensor_write(sd, 0x03, (it & 0x3f00) >> 8);
+	regs[n++] = (struct regval_list) {0x04, it & 0xff};
+	regs[n++] = (struct regval_list) {0x03, (it & 0x3f00) >> 8};
 
 	/* analog gain */
-	ret += sensor_write(sd, 0xb4, val_lut[again].regb4);
-	ret += sensor_write(sd, 0xb3, val_lut[again].regb3);
-	ret += sensor_write(sd, 0xb8, val_lut[again].dpc);
-	ret += sensor_write(sd, 0xb9, val_lut[again].blc);
+	regs[n++] = (struct regval_list) {0xb4, val_lut[again].regb4};
+	regs[n++] = (struct regval_list) {0xb3, val_lut[again].regb3};
+	regs[n++] = (struct regval_list) {0xb8, val_lut[again].dpc};
+	regs[n++] = (struct regval_list) {0xb9, val_lut[again].blc};
+
+	/* no group hold on this sensor, one transfer keeps the update inside a frame */
+	ret = sensor_core_write_group(sd, regs, n);
 	if (ret < 0) {
 		ISP_ERROR("sensor_write error  %d\n", __LINE__);
 		return ret;
@@ -1365,8 +1367,8 @@ static int sensor_set_expo(struct tx_isp_subdev *sd, int value) {
 #if 1
 static int sensor_set_integration_time(struct tx_isp_subdev *sd, int value) {
 	int ret = 0;
-	ret = sensor_write(sd, 0x04, value & 0xff);
-	ret += sensor_write(sd, 0x03, (value & 0x3f00) >> 8);
+	ret = sensor_core_write(sd, 0x04, value & 0xff);
+	ret += sensor_core_write(sd, 0x03, (value & 0x3f00) >> 8);
 	if (ret < 0) {
 		ISP_ERROR("sensor_write error  %d\n", __LINE__);
 		return ret;
@@ -1377,12 +1379,12 @@ static int sensor_set_integration_time(struct tx_isp_subdev *sd, int value) {
 static int sensor_set_analog_gain(struct tx_isp_subdev *sd, int value) {
 	int ret = 0;
 	struct again_lut *val_lut = sensor_again_lut;
-	ret = sensor_write(sd, 0xfe, 0x00);
-	ret += sensor_write(sd, 0xb4, val_lut[value].regb4);
-	ret += sensor_write(sd, 0xb3, val_lut[value].regb3);
-//	ret += sensor_write(sd, 0xb2, val_lut[value].regb2);
-	ret += sensor_write(sd, 0xb8, val_lut[value].dpc);
-	ret += sensor_write(sd, 0xb9, val_lut[value].blc);
+	ret = sensor_core_write(sd, 0xfe, 0x00);
+	ret += sensor_core_write(sd, 0xb4, val_lut[value].regb4);
+	ret += sensor_core_write(sd, 0xb3, val_lut[value].regb3);
+//	ret += sensor_core_write(sd, 0xb2, val_lut[value].regb2);
+	ret += sensor_core_write(sd, 0xb8, val_lut[value].dpc);
+	ret += sensor_core_write(sd, 0xb9, val_lut[value].blc);
 	if (ret < 0) {
 		ISP_ERROR("sensor_write error  %d\n", __LINE__);
 		return ret;
@@ -1400,121 +1402,91 @@ static int sensor_get_black_pedestal(struct tx_isp_subdev *sd, int value) {
 }
 
 static int sensor_init(struct tx_isp_subdev *sd, int enable) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = 0;
 
 	if (!enable)
 		return ISP_SUCCESS;
 
-	sensor->video.mbus.width = wsize->width;
-	sensor->video.mbus.height = wsize->height;
-	sensor->video.mbus.code = wsize->mbus_code;
-	sensor->video.mbus.field = V4L2_FIELD_NONE;
-	sensor->video.mbus.colorspace = wsize->colorspace;
-	sensor->video.fps = wsize->fps;
-	ret = sensor_write_array(sd, wsize->regs);
+	sensor_core_set_video(sensor, core->wsize);
+	/* played while the isp sets up, the first register access waits for it */
+	ret = sensor_core_init_async(sd, core->wsize->regs);
 	if (ret)
 		return ret;
 
 	ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
-	sensor->priv = wsize;
+	sensor->priv = core->wsize;
 	return 0;
 }
 
-static int sensor_s_stream(struct tx_isp_subdev *sd, int enable) {
-	int ret = 0;
-	if (enable) {
-		if (data_interface == TX_SENSOR_DATA_INTERFACE_DVP) {
-			ret = sensor_write_array(sd, sensor_stream_on_dvp);
-		} else if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-			ret = sensor_write_array(sd, sensor_stream_on_mipi);
-		}
-		ISP_WARNING("%s stream on\n", SENSOR_NAME);
-	} else {
-		if (data_interface == TX_SENSOR_DATA_INTERFACE_DVP) {
-			ret = sensor_write_array(sd, sensor_stream_off_dvp);
-		} else if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-			ret = sensor_write_array(sd, sensor_stream_off_mipi);
-		}
-		ISP_WARNING("%s stream off\n", SENSOR_NAME);
+static void sensor_apply_mode(struct sensor_core *core, const struct sensor_mode *mode) {
+	core->wsize = mode->wsize;
+	core->attr.max_integration_time_native = mode->vts - 8;
+	core->attr.integration_time_limit = mode->vts - 8;
+	core->attr.total_width = 0x44c * 2;
+	core->attr.total_height = mode->vts;
+	core->attr.max_integration_time = mode->vts - 8;
+	core->attr.one_line_expr_in_us = mode->one_line_expr_in_us;
+	core->timing.sclk = mode->sclk;
+	core->timing.hts = core->attr.total_width;
+	core->timing.max_fps = mode->max_fps;
+}
+
+/* The lowest clocked mode of the interface that runs fps */
+static const struct sensor_mode *sensor_find_mode(int data_interface, int fps) {
+	const struct sensor_mode *mode = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sensor_modes); i++) {
+		if (sensor_modes[i].data_interface != data_interface ||
+		    (fps >> 16) > sensor_modes[i].max_fps * (fps & 0xffff))
+			continue;
+		if (!mode || sensor_modes[i].sclk < mode->sclk)
+			mode = &sensor_modes[i];
 	}
-	return ret;
+
+	return mode;
 }
 
 static int sensor_set_fps(struct tx_isp_subdev *sd, int fps) {
-	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
-	unsigned int clk = 0;
-	unsigned short vts = 0;
-	unsigned short hts = 0;
-	unsigned int max_fps = 0;
-	unsigned char val = 0;
-	unsigned int newformat = 0; //the format is 24.8
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	const struct sensor_mode *mode;
+	struct regval_list regs[3];
+	unsigned int vts = 0;
 	int ret = 0;
 
-	if ((data_interface == TX_SENSOR_DATA_INTERFACE_DVP) && (sensor_max_fps == TX_SENSOR_MAX_FPS_30)) {
-		max_fps = SENSOR_OUTPUT_MAX_FPS;
-		clk = SENSOR_SUPPORT_30FPS_DVP_SCLK;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_DVP) && (sensor_max_fps == TX_SENSOR_MAX_FPS_15)) {
-		max_fps = TX_SENSOR_MAX_FPS_15;
-		clk = SENSOR_SUPPORT_15FPS_DVP_SCLK;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_30)) {
-		max_fps = SENSOR_OUTPUT_MAX_FPS;
-		clk = SENSOR_SUPPORT_30FPS_MIPI_SCLK;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_25)) {
-		max_fps = TX_SENSOR_MAX_FPS_25;
-		clk = SENSOR_SUPPORT_25FPS_MIPI_SCLK;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_15)) {
-		max_fps = TX_SENSOR_MAX_FPS_15;
-		clk = SENSOR_SUPPORT_15FPS_MIPI_SCLK;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_40)) {
-		max_fps = TX_SENSOR_MAX_FPS_40;
-		clk = SENSOR_SUPPORT_40FPS_MIPI_SCLK;
-	} else {
-		ISP_ERROR("Cannot support this data interface and fps!!!\n");
-	}
-
-	/* the format of fps is 16/16. for example 25 << 16 | 2, the value is 25/2 fps. */
-	newformat = (((fps >> 16) / (fps & 0xffff)) << 8) + ((((fps >> 16) % (fps & 0xffff)) << 8) / (fps & 0xffff));
-	if (newformat > (max_fps << 8) || newformat < (SENSOR_OUTPUT_MIN_FPS << 8)) {
-		ISP_ERROR("warn: fps(%x) not in range\n", fps);
-		return -1;
+	/* above the fps class of the mode, move up with a delta table */
+	if ((fps & 0xffff) && (fps >> 16) > core->timing.max_fps * (fps & 0xffff)) {
+		mode = sensor_find_mode(core->data_interface, fps);
+		if (mode && mode->wsize != core->wsize) {
+			ret = sensor_core_switch_mode(sd, mode->wsize);
+			if (ret)
+				return ret;
+			sensor_apply_mode(core, mode);
+		}
 	}
 
-	ret = sensor_write(sd, 0xfe, 0x0);
-	ret += sensor_read(sd, 0x05, &val);
-	hts = val;
-	ret += sensor_read(sd, 0x06, &val);
-	if (ret < 0)
+	vts = sensor_core_fps_vts(sd, fps);
+	if (!vts)
 		return -1;
 
-	hts = ((hts << 8) + val) << 1;
-	vts = clk * (fps & 0xffff) / hts / ((fps & 0xffff0000) >> 16);
-//	vtsn0 = (unsigned char) ((vts & 0x3f00) >> 8);
-//	vtsn1 = (unsigned char) (vts & 0xff);
-	ret = sensor_write(sd, 0x41, (unsigned char) ((vts & 0x3f00) >> 8));
-	ret += sensor_write(sd, 0x42, (unsigned char) (vts & 0xff));
+	regs[0] = (struct regval_list) {0xfe, 0x00};
+	regs[1] = (struct regval_list) {0x41, (unsigned char) ((vts & 0x3f00) >> 8)};
+	regs[2] = (struct regval_list) {0x42, (unsigned char) (vts & 0xff)};
+	ret = sensor_core_write_group(sd, regs, ARRAY_SIZE(regs));
 	if (ret < 0)
 		return -1;
 
-	sensor->video.fps = fps;
-	sensor->video.attr->max_integration_time_native = vts - 8;
-	sensor->video.attr->integration_time_limit = vts - 8;
-	sensor->video.attr->total_height = vts;
-	sensor->video.attr->max_integration_time = vts - 8;
-	ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
-	return ret;
+	return sensor_core_sync_vts(sd, fps, vts);
 }
 
 static int sensor_set_mode(struct tx_isp_subdev *sd, int value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = ISP_SUCCESS;
-	if (wsize) {
-		sensor->video.mbus.width = wsize->width;
-		sensor->video.mbus.height = wsize->height;
-		sensor->video.mbus.code = wsize->mbus_code;
-		sensor->video.mbus.field = V4L2_FIELD_NONE;
-		sensor->video.mbus.colorspace = wsize->colorspace;
-		sensor->video.fps = wsize->fps;
+	if (core->wsize) {
+		sensor_core_set_video(sensor, core->wsize);
 		ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
 	}
 	return ret;
@@ -1524,68 +1496,19 @@ static int sensor_set_vflip(struct tx_isp_subdev *sd, int enable) {
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = -1;
 	unsigned char val = 0x0;
-	ret = sensor_write(sd, 0xfe, 0x0);
-	ret += sensor_read(sd, 0x17, &val);
+	ret = sensor_core_write(sd, 0xfe, 0x0);
+	ret += sensor_core_read(sd, 0x17, &val);
 	if (enable & 0x2)
 		val |= 0x02;
 	else
 		val &= 0xfd;
-	ret += sensor_write(sd, 0x17, val);
+	ret += sensor_core_write(sd, 0x17, val);
 	if (!ret)
 		ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
 
 	return ret;
 }
 
-static int sensor_g_chip_ident(struct tx_isp_subdev *sd, struct tx_isp_chip_ident *chip) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	unsigned int ident = 0;
-	int ret = ISP_SUCCESS;
-
-	if (reset_gpio != -1) {
-		ret = private_gpio_request(reset_gpio, "sensor_reset");
-		if (!ret) {
-			private_gpio_direction_output(reset_gpio, 1);
-			private_msleep(20);
-			private_gpio_direction_output(reset_gpio, 0);
-			private_msleep(20);
-			private_gpio_direction_output(reset_gpio, 1);
-			private_msleep(10);
-		} else {
-			ISP_ERROR("gpio request fail %d\n", reset_gpio);
-		}
-	}
-	if (pwdn_gpio != -1) {
-		ret = private_gpio_request(pwdn_gpio, "sensor_pwdn");
-		if (!ret) {
-			private_gpio_direction_output(pwdn_gpio, 1);
-			private_msleep(10);
-			private_gpio_direction_output(pwdn_gpio, 0);
-			private_msleep(10);
-			private_gpio_direction_output(pwdn_gpio, 1);
-			private_msleep(10);
-		} else {
-			ISP_ERROR("gpio request fail %d\n", pwdn_gpio);
-		}
-	}
-	ret = sensor_detect(sd, &ident);
-	if (ret) {
-		ISP_ERROR("chip found @ 0x%x (%s) is not an %s chip.\n",
-			  client->addr, client->adapter->name, SENSOR_NAME);
-		return ret;
-	}
-
-	ISP_WARNING("%s chip found @ 0x%02x (%s)\n",
-		    SENSOR_NAME, client->addr, client->adapter->name);
-	ISP_WARNING("sensor driver version %s\n", SENSOR_VERSION);
-	if (chip) {
-		memcpy(chip->name, SENSOR_NAME, sizeof(SENSOR_NAME));
-		chip->ident = ident;
-		chip->revision = SENSOR_VERSION;
-	}
-	return 0;
-}
-
 static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, void *arg) {
 	long ret = 0;
 	if (IS_ERR_OR_NULL(sd)) {
@@ -1618,23 +1541,10 @@ static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, v
 				ret = sensor_set_mode(sd, *(int *) arg);
 			break;
 		case TX_ISP_EVENT_SENSOR_PREPARE_CHANGE:
-			if (data_interface == TX_SENSOR_DATA_INTERFACE_DVP) {
-				ret = sensor_write_array(sd, sensor_stream_off_dvp);
-			} else if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-				ret = sensor_write_array(sd, sensor_stream_off_mipi);
-			} else {
-				ISP_ERROR("Don't support this Sensor Data interface\n");
-			}
+			ret = sensor_core_stream(sd, 0);
 			break;
 		case TX_ISP_EVENT_SENSOR_FINISH_CHANGE:
-			if (data_interface == TX_SENSOR_DATA_INTERFACE_DVP) {
-				ret = sensor_write_array(sd, sensor_stream_on_dvp);
-			} else if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-				ret = sensor_write_array(sd, sensor_stream_on_mipi);
-			} else {
-				ISP_ERROR("Don't support this Sensor Data interface\n");
-				ret = -1;
-			}
+			ret = sensor_core_stream(sd, 1);
 			break;
 		case TX_ISP_EVENT_SENSOR_FPS:
 			if (arg)
@@ -1650,49 +1560,17 @@ static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, v
 	return ret;
 }
 
-static int sensor_g_register(struct tx_isp_subdev *sd, struct tx_isp_dbg_register *reg) {
-	unsigned char val = 0;
-	int len = 0;
-	int ret = 0;
-	len = strlen(sd->chip.name);
-	if (len && strncmp(sd->chip.name, reg->name, len)) {
-		return -EINVAL;
-	}
-
-	if (!private_capable(CAP_SYS_ADMIN))
-		return -EPERM;
-
-	ret = sensor_read(sd, reg->reg & 0xffff, &val);
-	reg->val = val;
-	reg->size = 2;
-	return ret;
-}
-
-static int sensor_s_register(struct tx_isp_subdev *sd, const struct tx_isp_dbg_register *reg) {
-	int len = 0;
-	len = strlen(sd->chip.name);
-	if (len && strncmp(sd->chip.name, reg->name, len)) {
-		return -EINVAL;
-	}
-
-	if (!private_capable(CAP_SYS_ADMIN))
-		return -EPERM;
-
-	sensor_write(sd, reg->reg & 0xffff, reg->val & 0xff);
-	return 0;
-}
-
 static struct tx_isp_subdev_core_ops sensor_core_ops = {
-	.g_chip_ident = sensor_g_chip_ident,
+	.g_chip_ident = sensor_core_g_chip_ident,
 	.reset = sensor_reset,
 	.init = sensor_init,
 	/*.ioctl = sensor_ops_ioctl,*/
-	.g_register = sensor_g_register,
-	.s_register = sensor_s_register,
+	.g_register = sensor_core_g_register,
+	.s_register = sensor_core_s_register,
 };
 
 static struct tx_isp_subdev_video_ops sensor_video_ops = {
-	.s_stream = sensor_s_stream,
+	.s_stream = sensor_core_s_stream,
 };
 
 static struct tx_isp_subdev_sensor_ops sensor_sensor_ops = {
@@ -1719,169 +1597,64 @@ struct platform_device sensor_platform_device = {
 };
 
 static int sensor_probe(struct i2c_client *client, const struct i2c_device_id *id) {
-	struct tx_isp_subdev *sd;
-	struct tx_isp_video_in *video;
+	struct sensor_core *core;
 	struct tx_isp_sensor *sensor;
 	int ret;
-	sensor = (struct tx_isp_sensor *) kzalloc(sizeof(*sensor), GFP_KERNEL);
-	if (!sensor) {
-		ISP_ERROR("Failed to allocate sensor subdev.\n");
+	int i;
+
+	core = sensor_core_alloc(&sensor_desc, 24000000);
+	if (!core)
 		return -ENOMEM;
-	}
 
-	memset(sensor, 0, sizeof(*sensor));
-	sensor->mclk = clk_get(NULL, "cgu_cim");
-	if (IS_ERR(sensor->mclk)) {
-		ISP_ERROR("Cannot get sensor input clock cgu_cim\n");
-		goto err_get_mclk;
+	core->reset_gpio = reset_gpio[core->id];
+	core->pwdn_gpio = pwdn_gpio[core->id];
+	core->data_interface = data_interface[core->id];
+	core->attr = sensor_attr;
+	sensor = &core->sensor;
+	core->attr.dbus_type = core->data_interface;
+	for (i = 0; i < ARRAY_SIZE(sensor_modes); i++)
+		if (sensor_modes[i].data_interface == core->data_interface &&
+		    sensor_modes[i].fps_class == sensor_max_fps[core->id])
+			break;
+	if (i == ARRAY_SIZE(sensor_modes)) {
+		ISP_ERROR("Can not support this data interface and fps!!!\n");
+		goto err_set_sensor_data_interface;
 	}
 
-	private_clk_set_rate(sensor->mclk, 24000000);
-	private_clk_enable(sensor->mclk);
-	sensor_attr.dbus_type = data_interface;
-	if ((data_interface == TX_SENSOR_DATA_INTERFACE_DVP) && (sensor_max_fps == TX_SENSOR_MAX_FPS_30)) {
-		ret = set_sensor_gpio_function(sensor_gpio_func);
-		if (ret < 0)
-			goto err_set_sensor_gpio;
-
-		sensor_attr.dvp.gpio = sensor_gpio_func;
-		wsize = &sensor_win_sizes[0];
-		memcpy((void *) (&(sensor_attr.dvp)), (void *) (&sensor_dvp), sizeof(sensor_dvp));
-		sensor_attr.max_integration_time_native = 0x546 - 8;
-		sensor_attr.integration_time_limit = 0x546 - 8;
-		sensor_attr.total_width = 0x44c * 2;
-		sensor_attr.total_height = 0x546;
-		sensor_attr.max_integration_time = 0x546 - 8;
-		sensor_attr.one_line_expr_in_us = 29;
-		vts0 = 0x05;
-		vts1 = 0x46;
-		vtsn0 = 0x05;
-		vtsn1 = 0x46;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_DVP) && (sensor_max_fps == TX_SENSOR_MAX_FPS_15)) {
+	if (core->data_interface == TX_SENSOR_DATA_INTERFACE_DVP) {
 		ret = set_sensor_gpio_function(sensor_gpio_func);
 		if (ret < 0)
 			goto err_set_sensor_gpio;
 
-		sensor_attr.dvp.gpio = sensor_gpio_func;
-		wsize = &sensor_win_sizes[1];
-		memcpy((void *) (&(sensor_attr.dvp)), (void *) (&sensor_dvp), sizeof(sensor_dvp));
-		sensor_attr.max_integration_time_native = 0x465 - 8;
-		sensor_attr.integration_time_limit = 0x465 - 8;
-		sensor_attr.total_width = 0x44c * 2;
-		sensor_attr.total_height = 0x465;
-		sensor_attr.max_integration_time = 0x465 - 8;
-		sensor_attr.one_line_expr_in_us = 59;
-		vts0 = 0x04;
-		vts1 = 0x65;
-		vtsn0 = 0x04;
-		vtsn1 = 0x65;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_30)) {
-		wsize = &sensor_win_sizes[2];
-		memcpy((void *) (&(sensor_attr.mipi)), (void *) (&sensor_mipi), sizeof(sensor_mipi));
-		sensor_attr.max_integration_time_native = 0x58a - 8;
-		sensor_attr.integration_time_limit = 0x58a - 8;
-		sensor_attr.total_width = 0x44c * 2;
-		sensor_attr.total_height = 0x58a;
-		sensor_attr.max_integration_time = 0x58a - 8;
-		sensor_attr.one_line_expr_in_us = 28;
-		vts0 = 0x05;
-		vts1 = 0x8a;
-		vtsn0 = 0x05;
-		vtsn1 = 0x8a;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_25)) {
-		wsize = &sensor_win_sizes[3];
-		memcpy((void *) (&(sensor_attr.mipi)), (void *) (&sensor_mipi), sizeof(sensor_mipi));
-		sensor_attr.max_integration_time_native = 0x51c - 8;
-		sensor_attr.integration_time_limit = 0x51c - 8;
-		sensor_attr.total_width = 0x44c * 2;
-		sensor_attr.total_height = 0x51c;
-		sensor_attr.max_integration_time = 0x51c - 8;
-		sensor_attr.one_line_expr_in_us = 31;
-		vts0 = 0x05;
-		vts1 = 0x1c;
-		vtsn0 = 0x05;
-		vtsn1 = 0x1c;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_15)) {
-		wsize = &sensor_win_sizes[4];
-		memcpy((void *) (&(sensor_attr.mipi)), (void *) (&sensor_mipi), sizeof(sensor_mipi));
-		sensor_attr.max_integration_time_native = 0x49d - 8;
-		sensor_attr.integration_time_limit = 0x49d - 8;
-		sensor_attr.total_width = 0x44c * 2;
-		sensor_attr.total_height = 0x49d;
-		sensor_attr.max_integration_time = 0x49d - 8;
-		sensor_attr.one_line_expr_in_us = 57;
-		vts0 = 0x04;
-		vts1 = 0x9d;
-		vtsn0 = 0x04;
-		vtsn1 = 0x9d;
-	} else if ((data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) && (sensor_max_fps == TX_SENSOR_MAX_FPS_40)) {
-		wsize = &sensor_win_sizes[5];
-		memcpy((void *) (&(sensor_attr.mipi)), (void *) (&sensor_mipi), sizeof(sensor_mipi));
-		sensor_attr.max_integration_time_native = 0x465 - 8;
-		sensor_attr.integration_time_limit = 0x465 - 8;
-		sensor_attr.total_width = 0x44c * 2;
-		sensor_attr.total_height = 0x465;
-		sensor_attr.max_integration_time = 0x465 - 8;
-		sensor_attr.one_line_expr_in_us = 11;
-		vts0 = 0x04;
-		vts1 = 0x65;
-		vtsn0 = 0x04;
-		vtsn1 = 0x65;
+		core->attr.dvp.gpio = sensor_gpio_func;
+		memcpy((void *) (&(core->attr.dvp)), (void *) (&sensor_dvp), sizeof(sensor_dvp));
 	} else {
-		ISP_ERROR("Can not support this data interface and fps!!!\n");
-		goto err_set_sensor_data_interface;
+		memcpy((void *) (&(core->attr.mipi)), (void *) (&sensor_mipi), sizeof(sensor_mipi));
 	}
+	sensor_apply_mode(core, &sensor_modes[i]);
+	core->timing.min_fps = SENSOR_OUTPUT_MIN_FPS;
+	core->timing.margin = 8;
 
 	/*
 	  convert sensor-gain into isp-gain,
 	*/
-	sensor_attr.max_again = 444864;
-	sensor_attr.max_dgain = 0;
-	sensor_attr.expo_fs = 0;
-	sd = &sensor->sd;
-	video = &sensor->video;
-	sensor->video.shvflip = shvflip;
-	sensor->video.attr = &sensor_attr;
-	sensor->video.vi_max_width = wsize->width;
-	sensor->video.vi_max_height = wsize->height;
-	sensor->video.mbus.width = wsize->width;
-	sensor->video.mbus.height = wsize->height;
-	sensor->video.mbus.code = wsize->mbus_code;
-	sensor->video.mbus.field = V4L2_FIELD_NONE;
-	sensor->video.mbus.colorspace = wsize->colorspace;
-	sensor->video.fps = wsize->fps;
-	tx_isp_subdev_init(&sensor_platform_device, sd, &sensor_ops);
-	tx_isp_set_subdevdata(sd, client);
-	tx_isp_set_subdev_hostdata(sd, sensor);
-	private_i2c_set_clientdata(client, sd);
-	pr_debug("probe ok ------->%s\n", SENSOR_NAME);
+	core->attr.max_again = 444864;
+	core->attr.max_dgain = 0;
+	core->attr.expo_fs = 0;
+	sensor->video.shvflip = shvflip[core->id];
+	sensor->video.attr = &core->attr;
+	sensor->video.vi_max_width = core->wsize->width;
+	sensor->video.vi_max_height = core->wsize->height;
+	sensor_core_set_video(sensor, core->wsize);
+	sensor_core_register(core, &sensor_platform_device, &sensor_ops, client);
 	return 0;
 
 err_set_sensor_data_interface:
 err_set_sensor_gpio:
-	private_clk_disable(sensor->mclk);
-	private_clk_put(sensor->mclk);
-err_get_mclk:
-	kfree(sensor);
+	sensor_core_free(core);
 	return -1;
 }
 
-static int sensor_remove(struct i2c_client *client) {
-	struct tx_isp_subdev *sd = private_i2c_get_clientdata(client);
-	struct tx_isp_sensor *sensor = tx_isp_get_subdev_hostdata(sd);
-
-	if (reset_gpio != -1)
-		private_gpio_free(reset_gpio);
-	if (pwdn_gpio != -1)
-		private_gpio_free(pwdn_gpio);
-
-	private_clk_disable(sensor->mclk);
-	private_clk_put(sensor->mclk);
-	tx_isp_subdev_deinit(sd);
-	kfree(sensor);
-	return 0;
-}
-
 static const struct i2c_device_id sensor_id[] = {
 	{SENSOR_NAME, 0},
 	{}
@@ -1895,7 +1668,7 @@ static struct i2c_driver sensor_driver = {
 		.name = SENSOR_NAME,
 	},
 	.probe = sensor_probe,
-	.remove = sensor_remove,
+	.remove = sensor_core_remove,
 	.id_table = sensor_id,
 };
 
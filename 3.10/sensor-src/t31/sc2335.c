@@ -15,6 +15,7 @@
 #include <tx-isp-common.h>
 #include <sensor-common.h>
 #include <sensor-info.h>
+#include <sensor-core.h>
 
 #define SENSOR_NAME "sc2335"
 #define SENSOR_CHIP_ID 0xcb14
@@ -31,21 +32,21 @@
 #define SENSOR_OUTPUT_MIN_FPS 5
 #define SENSOR_VERSION "H20201205b"
 
-static int reset_gpio = GPIO_PA(18);
-module_param(reset_gpio, int, S_IRUGO);
-MODULE_PARM_DESC(reset_gpio, "Reset GPIO NUM");
+static int reset_gpio[SENSOR_CORE_MAX_INSTANCES] = {GPIO_PA(18), -1};
+module_param_array(reset_gpio, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(reset_gpio, "Reset GPIO NUM, one per sensor");
 
-static int pwdn_gpio = -1;
-module_param(pwdn_gpio, int, S_IRUGO);
-MODULE_PARM_DESC(pwdn_gpio, "Power down GPIO NUM");
+static int pwdn_gpio[SENSOR_CORE_MAX_INSTANCES] = {-1, -1};
+module_param_array(pwdn_gpio, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(pwdn_gpio, "Power down GPIO NUM, one per sensor");
 
-static int data_interface = TX_SENSOR_DATA_INTERFACE_MIPI;
-module_param(data_interface, int, S_IRUGO);
-MODULE_PARM_DESC(data_interface, "Sensor Date interface");
+static int data_interface[SENSOR_CORE_MAX_INSTANCES] = {TX_SENSOR_DATA_INTERFACE_MIPI, TX_SENSOR_DATA_INTERFACE_MIPI};
+module_param_array(data_interface, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(data_interface, "Sensor Date interface, one per sensor");
 
-static int shvflip = 0;
-module_param(shvflip, int, S_IRUGO);
-MODULE_PARM_DESC(shvflip, "Sensor HV Flip Enable interface");
+static int shvflip[SENSOR_CORE_MAX_INSTANCES] = {0, 0};
+module_param_array(shvflip, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(shvflip, "Sensor HV Flip Enable interface, one per sensor");
 
 static struct sensor_info sensor_info = {
 	.name = SENSOR_NAME,
@@ -58,13 +59,6 @@ static struct sensor_info sensor_info = {
 	.height = SENSOR_MAX_HEIGHT,
 };
 
-static unsigned int gain_val = 0x37e;
-
-struct regval_list {
-    uint16_t reg_num;
-    unsigned char value;
-};
-
 struct again_lut {
     unsigned int value;
     unsigned int gain;
@@ -332,24 +326,12 @@ struct again_lut sensor_again_lut[] = {
 struct tx_isp_sensor_attribute sensor_attr;
 
 unsigned int sensor_alloc_again(unsigned int isp_gain, unsigned char shift, unsigned int *sensor_again) {
-	struct again_lut *lut = sensor_again_lut;
-	while (lut->gain <= sensor_attr.max_again) {
-		if (isp_gain == 0) {
-			*sensor_again = lut[0].value;
-			return 0;
-		} else if (isp_gain < lut->gain) {
-			*sensor_again = (lut - 1)->value;
-			return (lut - 1)->gain;
-		} else {
-			if ((lut->gain == sensor_attr.max_again) && (isp_gain >= lut->gain)) {
-				*sensor_again = lut->value;
-				return lut->gain;
-			}
-		}
+	int i = sensor_core_again_index(sensor_again_lut, sensor_attr.max_again, isp_gain);
 
-		lut++;
-	}
-	return isp_gain;
+	if (i < 0)
+		return isp_gain;
+	*sensor_again = sensor_again_lut[i].value;
+	return sensor_again_lut[i].gain;
 }
 
 unsigned int sensor_alloc_dgain(unsigned int isp_gain, unsigned char shift, unsigned int *sensor_dgain) {
@@ -528,7 +510,6 @@ static struct tx_isp_sensor_win_setting sensor_win_sizes[] = {
 		.regs = sensor_init_regs_1920_1080_25fps_mipi,
 	},
 };
-struct tx_isp_sensor_win_setting *wsize = &sensor_win_sizes[0];
 
 static struct regval_list sensor_stream_on_mipi[] = {
 	{0x0100, 0x01},
@@ -540,123 +521,70 @@ static struct regval_list sensor_stream_off_mipi[] = {
 	{SENSOR_REG_END, 0x00},
 };
 
-int sensor_read(struct tx_isp_subdev *sd, uint16_t reg, unsigned char *value) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	unsigned char buf[2] = {reg >> 8, reg & 0xff};
-	struct i2c_msg msg[2] = {
-		[0] = {
-			.addr = client->addr,
-			.flags = 0,
-			.len = 2,
-			.buf = buf,
-		},
-		[1] = {
-			.addr = client->addr,
-			.flags = I2C_M_RD,
-			.len = 1,
-			.buf = value,
-		}
-	};
-	int ret;
-	ret = private_i2c_transfer(client->adapter, msg, 2);
-	if (ret > 0)
-		ret = 0;
-
-	return ret;
-}
-
-int sensor_write(struct tx_isp_subdev *sd, uint16_t reg, unsigned char value) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	uint8_t buf[3] = {(reg >> 8) & 0xff, reg & 0xff, value};
-	struct i2c_msg msg = {
-		.addr = client->addr,
-		.flags = 0,
-		.len = 3,
-		.buf = buf,
-	};
-	int ret;
-	ret = private_i2c_transfer(client->adapter, &msg, 1);
-	if (ret > 0)
-		ret = 0;
+static struct regval_list sensor_group_hold_on[] = {
+	{0x3812, 0x00},
+	{SENSOR_REG_END, 0x00},
+};
 
-	return ret;
-}
+static struct regval_list sensor_group_hold_off[] = {
+	{0x3812, 0x30},
+	{SENSOR_REG_END, 0x00},
+};
 
-static int sensor_read_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
-	int ret;
-	unsigned char val;
-	while (vals->reg_num != SENSOR_REG_END) {
-		if (vals->reg_num == SENSOR_REG_DELAY) {
-			private_msleep(vals->value);
-		} else {
-			ret = sensor_read(sd, vals->reg_num, &val);
-			if (ret < 0)
-				return ret;
-		}
-		vals++;
-	}
+static const struct sensor_gpio_step sensor_reset_seq[] = {
+	{1, 5}, {0, 10}, {1, 10},
+	SENSOR_GPIO_SEQ_END,
+};
 
-	return 0;
-}
+static const struct sensor_gpio_step sensor_pwdn_seq[] = {
+	{1, 10}, {0, 10},
+	SENSOR_GPIO_SEQ_END,
+};
 
-static int sensor_write_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
-	int ret;
-	while (vals->reg_num != SENSOR_REG_END) {
-		if (vals->reg_num == SENSOR_REG_DELAY) {
-			private_msleep(vals->value);
-		} else {
-			ret = sensor_write(sd, vals->reg_num, vals->value);
-			if (ret < 0)
-				return ret;
-		}
-		vals++;
-	}
+/* the group hold must reach the sensor on every commit */
+static const uint16_t sensor_volatile_regs[] = {0x3812};
 
-	return 0;
-}
+static const struct sensor_core_desc sensor_desc = {
+	.name = SENSOR_NAME,
+	.version = SENSOR_VERSION,
+	.reg_bytes = 2,
+	.burst_len = 32,
+	.reg_end = SENSOR_REG_END,
+	.reg_delay = SENSOR_REG_DELAY,
+	.id_reg = {0x3107, 0x3108},
+	.id_val = {SENSOR_CHIP_ID_H, SENSOR_CHIP_ID_L},
+	.reset_seq = sensor_reset_seq,
+	.pwdn_seq = sensor_pwdn_seq,
+	.stream_on_mipi = sensor_stream_on_mipi,
+	.stream_off_mipi = sensor_stream_off_mipi,
+	.hold_on = sensor_group_hold_on,
+	.hold_off = sensor_group_hold_off,
+	.volatile_regs = sensor_volatile_regs,
+	.nr_volatile = ARRAY_SIZE(sensor_volatile_regs),
+};
 
 static int sensor_reset(struct tx_isp_subdev *sd, int val) {
 	return 0;
 }
 
-static int sensor_detect(struct tx_isp_subdev *sd, unsigned int *ident) {
-	int ret;
-	unsigned char v;
-
-	ret = sensor_read(sd, 0x3107, &v);
-	ISP_WARNING("-----%s: %d ret = %d, v = 0x%02x\n", __func__, __LINE__, ret, v);
-	if (ret < 0)
-		return ret;
-	if (v != SENSOR_CHIP_ID_H)
-		return -ENODEV;
-	*ident = v;
-
-	ret = sensor_read(sd, 0x3108, &v);
-	ISP_WARNING("-----%s: %d ret = %d, v = 0x%02x\n", __func__, __LINE__, ret, v);
-	if (ret < 0)
-		return ret;
-	if (v != SENSOR_CHIP_ID_L)
-		return -ENODEV;
-	*ident = (*ident << 8) | v;
-
-	return 0;
-}
-
 static int sensor_set_expo(struct tx_isp_subdev *sd, int value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	int ret = 0;
 	int it = (value & 0xffff) * 2;
 	int again = (value & 0xffff0000) >> 16;
+	struct regval_list regs[] = {
+		{0x3e00, (unsigned char) ((it >> 12) & 0xf)},
+		{0x3e01, (unsigned char) ((it >> 4) & 0xff)},
+		{0x3e02, (unsigned char) ((it & 0x0f) << 4)},
+		{0x3e08, (unsigned char) ((again >> 8) & 0xff)},
+		{0x3e09, (unsigned char) (again & 0xff)},
+	};
 
-	ret += sensor_write(sd, 0x3e00, (unsigned char) ((it >> 12) & 0xf));
-	ret += sensor_write(sd, 0x3e01, (unsigned char) ((it >> 4) & 0xff));
-	ret += sensor_write(sd, 0x3e02, (unsigned char) ((it & 0x0f) << 4));
-
-	ret += sensor_write(sd, 0x3e09, (unsigned char) (again & 0xff));
-	ret += sensor_write(sd, 0x3e08, (unsigned char) (((again >> 8) & 0xff)));
+	ret = sensor_core_write_group(sd, regs, ARRAY_SIZE(regs));
 	if (ret < 0)
 		return ret;
 
-	gain_val = again;
+	core->again = again;
 	return 0;
 }
 
@@ -664,9 +592,9 @@ static int sensor_set_integration_time(struct tx_isp_subdev *sd, int value) {
 	int ret = 0;
 
 	value *= 2;
-	ret += sensor_write(sd, 0x3e00, (unsigned char) ((value >> 12) & 0xf));
-	ret += sensor_write(sd, 0x3e01, (unsigned char) ((value >> 4) & 0xff));
-	ret += sensor_write(sd, 0x3e02, (unsigned char) ((value & 0x0f) << 4));
+	ret += sensor_core_write(sd, 0x3e00, (unsigned char) ((value >> 12) & 0xf));
+	ret += sensor_core_write(sd, 0x3e01, (unsigned char) ((value >> 4) & 0xff));
+	ret += sensor_core_write(sd, 0x3e02, (unsigned char) ((value & 0x0f) << 4));
 
 	if (ret < 0)
 		return ret;
@@ -675,43 +603,45 @@ static int sensor_set_integration_time(struct tx_isp_subdev *sd, int value) {
 }
 
 static int sensor_set_analog_gain(struct tx_isp_subdev *sd, int value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	int ret = 0;
 
-	ret += sensor_write(sd, 0x3e09, (unsigned char) (value & 0xff));
-	ret += sensor_write(sd, 0x3e08, (unsigned char) (((value >> 8) & 0xff)));
+	ret += sensor_core_write(sd, 0x3e09, (unsigned char) (value & 0xff));
+	ret += sensor_core_write(sd, 0x3e08, (unsigned char) (((value >> 8) & 0xff)));
 	if (ret < 0)
 		return ret;
-	gain_val = value;
+	core->again = value;
 
 	return 0;
 }
 
 static int sensor_set_logic(struct tx_isp_subdev *sd, int value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	unsigned char reg0;
 	unsigned int ret = 0;
 
 	/* analog gain setting logic */
-	ret = sensor_read(sd, 0x3040, &reg0);
+	ret = sensor_core_read(sd, 0x3040, &reg0);
 	if (0x40 == reg0) {
-		if (gain_val < 0x740) {
-			ret += sensor_write(sd, 0x363c, 0x0e);
-		} else if (gain_val >= 0x740) {
-			ret += sensor_write(sd, 0x363c, 0x07);
+		if (core->again < 0x740) {
+			ret += sensor_core_write(sd, 0x363c, 0x0e);
+		} else if (core->again >= 0x740) {
+			ret += sensor_core_write(sd, 0x363c, 0x07);
 		}
 	} else if (0x41 == reg0) {
-		if (gain_val < 0x740) {
-			ret += sensor_write(sd, 0x363c, 0x0f);
-		} else if (gain_val >= 0x740) {
-			ret += sensor_write(sd, 0x363c, 0x07);
+		if (core->again < 0x740) {
+			ret += sensor_core_write(sd, 0x363c, 0x0f);
+		} else if (core->again >= 0x740) {
+			ret += sensor_core_write(sd, 0x363c, 0x07);
 		}
 	} else {
-		ret += sensor_write(sd, 0x363c, 0x07);
+		ret += sensor_core_write(sd, 0x363c, 0x07);
 	}
 	/* DPC Setting */
-	if (gain_val >= 0xf60) { //6x
-		ret += sensor_write(sd, 0x5799, 0x7);
-	} else if (gain_val <= 0xf40) {//4x
-		ret += sensor_write(sd, 0x5799, 0x00);
+	if (core->again >= 0xf60) { //6x
+		ret += sensor_core_write(sd, 0x5799, 0x7);
+	} else if (core->again <= 0xf40) {//4x
+		ret += sensor_core_write(sd, 0x5799, 0x00);
 	}
 	if (ret < 0)
 		return ret;
@@ -728,171 +658,70 @@ static int sensor_get_black_pedestal(struct tx_isp_subdev *sd, int value) {
 }
 
 static int sensor_init(struct tx_isp_subdev *sd, int enable) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = 0;
 
 	if (!enable)
 		return ISP_SUCCESS;
 
-	sensor->video.mbus.width = wsize->width;
-	sensor->video.mbus.height = wsize->height;
-	sensor->video.mbus.code = wsize->mbus_code;
-	sensor->video.mbus.field = V4L2_FIELD_NONE;
-	sensor->video.mbus.colorspace = wsize->colorspace;
-	sensor->video.fps = wsize->fps;
-
-	ret = sensor_write_array(sd, wsize->regs);
+	sensor_core_set_video(sensor, core->wsize);
+	/* played while the isp sets up, the first register access waits for it */
+	ret = sensor_core_init_async(sd, core->wsize->regs);
 	if (ret)
 		return ret;
 	ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
-	sensor->priv = wsize;
+	sensor->priv = core->wsize;
 
 	return 0;
 }
 
-static int sensor_s_stream(struct tx_isp_subdev *sd, int enable) {
-	int ret = 0;
-
-	if (enable) {
-		if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-			ret = sensor_write_array(sd, sensor_stream_on_mipi);
-		} else {
-			ISP_ERROR("Don't support this Sensor Data interface\n");
-		}
-		ISP_WARNING("%s stream on\n", SENSOR_NAME);
-
-	} else {
-		if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-			ret = sensor_write_array(sd, sensor_stream_off_mipi);
-		} else {
-			ISP_ERROR("Don't support this Sensor Data interface\n");
-		}
-		ISP_WARNING("%s stream off\n", SENSOR_NAME);
-	}
-
-	return ret;
-}
-
 static int sensor_set_fps(struct tx_isp_subdev *sd, int fps) {
-	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
-	unsigned int clk = 0;
-	unsigned int hts = 0;
+	struct regval_list regs[2];
 	unsigned int vts = 0;
-	unsigned char val = 0;
-	unsigned int newformat = 0; //the format is 24.8
 	int ret = 0;
 
-	newformat = (((fps >> 16) / (fps & 0xffff)) << 8) + ((((fps >> 16) % (fps & 0xffff)) << 8) / (fps & 0xffff));
-	if (newformat > (SENSOR_OUTPUT_MAX_FPS << 8) || newformat < (SENSOR_OUTPUT_MIN_FPS << 8)) {
-		ISP_ERROR("warn: fps(%d) not in range\n", fps);
+	vts = sensor_core_fps_vts(sd, fps);
+	if (!vts)
 		return -1;
-	}
-	clk = SENSOR_SUPPORT_30FPS_SCLK;
 
-	ret = sensor_read(sd, 0x320c, &val);
-	hts = val;
-	ret += sensor_read(sd, 0x320d, &val);
-	if (0 != ret) {
-		ISP_ERROR("err: %s read err\n", SENSOR_NAME);
-		return ret;
-	}
-	hts = ((hts << 8) + val) << 1;
-	vts = clk * (fps & 0xffff) / hts / ((fps & 0xffff0000) >> 16);
-
-	ret += sensor_write(sd, 0x320f, (unsigned char) (vts & 0xff));
-	ret += sensor_write(sd, 0x320e, (unsigned char) (vts >> 8));
-	if (0 != ret) {
+	regs[0] = (struct regval_list) {0x320e, (unsigned char) (vts >> 8)};
+	regs[1] = (struct regval_list) {0x320f, (unsigned char) (vts & 0xff)};
+	ret = sensor_core_write_group(sd, regs, ARRAY_SIZE(regs));
+	if (ret < 0) {
 		ISP_ERROR("Error: %s write error\n", SENSOR_NAME);
 		return ret;
 	}
 
-	sensor->video.fps = fps;
-	sensor->video.attr->max_integration_time_native = vts - 5;
-	sensor->video.attr->integration_time_limit = vts - 5;
-	sensor->video.attr->total_height = vts;
-	sensor->video.attr->max_integration_time = vts - 5;
-	ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
-
-	return ret;
+	return sensor_core_sync_vts(sd, fps, vts);
 }
 
 static int sensor_set_mode(struct tx_isp_subdev *sd, int value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = ISP_SUCCESS;
 
-	if (wsize) {
-		sensor->video.mbus.width = wsize->width;
-		sensor->video.mbus.height = wsize->height;
-		sensor->video.mbus.code = wsize->mbus_code;
-		sensor->video.mbus.field = V4L2_FIELD_NONE;
-		sensor->video.mbus.colorspace = wsize->colorspace;
-		sensor->video.fps = wsize->fps;
+	if (core->wsize) {
+		sensor_core_set_video(sensor, core->wsize);
 		ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
 	}
 
 	return ret;
 }
 
-static int sensor_g_chip_ident(struct tx_isp_subdev *sd,
-			       struct tx_isp_chip_ident *chip) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	unsigned int ident = 0;
-	int ret = ISP_SUCCESS;
-	if (reset_gpio != -1) {
-		ret = private_gpio_request(reset_gpio, "sensor_reset");
-		if (!ret) {
-			private_gpio_direction_output(reset_gpio, 1);
-			private_msleep(5);
-			private_gpio_direction_output(reset_gpio, 0);
-			private_msleep(10);
-			private_gpio_direction_output(reset_gpio, 1);
-			private_msleep(10);
-		} else {
-			ISP_ERROR("gpio request fail %d\n", reset_gpio);
-		}
-	}
-	if (pwdn_gpio != -1) {
-		ret = private_gpio_request(pwdn_gpio, "sensor_pwdn");
-		if (!ret) {
-			private_gpio_direction_output(pwdn_gpio, 1);
-			private_msleep(10);
-			private_gpio_direction_output(pwdn_gpio, 0);
-			private_msleep(10);
-		} else {
-			ISP_ERROR("gpio request fail %d\n", pwdn_gpio);
-		}
-	}
-	ret = sensor_detect(sd, &ident);
-	if (ret) {
-		ISP_ERROR("chip found @ 0x%x (%s) is not an %s chip.\n",
-			  client->addr, client->adapter->name, SENSOR_NAME);
-		return ret;
-	}
-	ISP_WARNING("%s chip found @ 0x%02x (%s)\n",
-		    SENSOR_NAME, client->addr, client->adapter->name);
-	ISP_WARNING("sensor driver version %s\n", SENSOR_VERSION);
-	if (chip) {
-		memcpy(chip->name, SENSOR_NAME, sizeof(SENSOR_NAME));
-		chip->ident = ident;
-		chip->revision = SENSOR_VERSION;
-	}
-
-	return 0;
-}
-
 static int sensor_set_vflip(struct tx_isp_subdev *sd, int enable) {
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = -1;
 	unsigned char val = 0x0;
 
-	ret += sensor_read(sd, 0x3221, &val);
+	ret += sensor_core_read(sd, 0x3221, &val);
 
 	if (enable & 0x2)
 		val |= 0x60;
 	else
 		val &= 0x9f;
 
-	ret += sensor_write(sd, 0x3221, val);
+	ret += sensor_core_write(sd, 0x3221, val);
 
 	if (!ret)
 		ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
@@ -932,21 +761,10 @@ static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, v
 				ret = sensor_set_mode(sd, *(int *) arg);
 			break;
 		case TX_ISP_EVENT_SENSOR_PREPARE_CHANGE:
-			if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-				ret = sensor_write_array(sd, sensor_stream_off_mipi);
-
-			} else {
-				ISP_ERROR("Don't support this Sensor Data interface\n");
-			}
+			ret = sensor_core_stream(sd, 0);
 			break;
 		case TX_ISP_EVENT_SENSOR_FINISH_CHANGE:
-			if (data_interface == TX_SENSOR_DATA_INTERFACE_MIPI) {
-				ret = sensor_write_array(sd, sensor_stream_on_mipi);
-
-			} else {
-				ISP_ERROR("Don't support this Sensor Data interface\n");
-				ret = -1;
-			}
+			ret = sensor_core_stream(sd, 1);
 			break;
 		case TX_ISP_EVENT_SENSOR_FPS:
 			if (arg)
@@ -966,50 +784,17 @@ static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, v
 	return ret;
 }
 
-static int sensor_g_register(struct tx_isp_subdev *sd, struct tx_isp_dbg_register *reg) {
-	unsigned char val = 0;
-	int len = 0;
-	int ret = 0;
-
-	len = strlen(sd->chip.name);
-	if (len && strncmp(sd->chip.name, reg->name, len)) {
-		return -EINVAL;
-	}
-	if (!private_capable(CAP_SYS_ADMIN))
-		return -EPERM;
-	ret = sensor_read(sd, reg->reg & 0xffff, &val);
-	reg->val = val;
-	reg->size = 2;
-
-	return ret;
-}
-
-static int sensor_s_register(struct tx_isp_subdev *sd, const struct tx_isp_dbg_register *reg) {
-	int len = 0;
-
-	len = strlen(sd->chip.name);
-	if (len && strncmp(sd->chip.name, reg->name, len)) {
-		return -EINVAL;
-	}
-	if (!private_capable(CAP_SYS_ADMIN))
-		return -EPERM;
-
-	sensor_write(sd, reg->reg & 0xffff, reg->val & 0xff);
-
-	return 0;
-}
-
 static struct tx_isp_subdev_core_ops sensor_core_ops = {
-	.g_chip_ident = sensor_g_chip_ident,
+	.g_chip_ident = sensor_core_g_chip_ident,
 	.reset = sensor_reset,
 	.init = sensor_init,
 	/*.ioctl = sensor_ops_ioctl,*/
-	.g_register = sensor_g_register,
-	.s_register = sensor_s_register,
+	.g_register = sensor_core_g_register,
+	.s_register = sensor_core_s_register,
 };
 
 static struct tx_isp_subdev_video_ops sensor_video_ops = {
-	.s_stream = sensor_s_stream,
+	.s_stream = sensor_core_s_stream,
 };
 
 static struct tx_isp_subdev_sensor_ops sensor_sensor_ops = {
@@ -1036,71 +821,36 @@ struct platform_device sensor_platform_device = {
 };
 
 static int sensor_probe(struct i2c_client *client, const struct i2c_device_id *id) {
-	struct tx_isp_subdev *sd;
-	struct tx_isp_video_in *video;
+	struct sensor_core *core;
 	struct tx_isp_sensor *sensor;
 
-	sensor = (struct tx_isp_sensor *) kzalloc(sizeof(*sensor), GFP_KERNEL);
-	if (!sensor) {
-		ISP_ERROR("Failed to allocate sensor subdev.\n");
+	core = sensor_core_alloc(&sensor_desc, 24000000);
+	if (!core)
 		return -ENOMEM;
-	}
-	memset(sensor, 0, sizeof(*sensor));
 
-	sensor->mclk = clk_get(NULL, "cgu_cim");
-	if (IS_ERR(sensor->mclk)) {
-		ISP_ERROR("Cannot get sensor input clock cgu_cim\n");
-		goto err_get_mclk;
-	}
-	private_clk_set_rate(sensor->mclk, 24000000);
-	private_clk_enable(sensor->mclk);
+	core->reset_gpio = reset_gpio[core->id];
+	core->pwdn_gpio = pwdn_gpio[core->id];
+	core->data_interface = data_interface[core->id];
+	core->attr = sensor_attr;
+	core->wsize = &sensor_win_sizes[0];
+	core->again = 0x37e;
+	sensor = &core->sensor;
+	core->timing.sclk = SENSOR_SUPPORT_30FPS_SCLK;
+	core->timing.hts = core->attr.total_width;
+	core->timing.min_fps = SENSOR_OUTPUT_MIN_FPS;
+	core->timing.max_fps = SENSOR_OUTPUT_MAX_FPS;
+	core->timing.margin = 5;
 
 	/*
 	  convert sensor-gain into isp-gain,
 	*/
-	sensor_attr.expo_fs = 1;
-	sd = &sensor->sd;
-	video = &sensor->video;
-	sensor->video.shvflip = shvflip;
-	sensor->video.attr = &sensor_attr;
-	sensor->video.vi_max_width = wsize->width;
-	sensor->video.vi_max_height = wsize->height;
-	sensor->video.mbus.width = wsize->width;
-	sensor->video.mbus.height = wsize->height;
-	sensor->video.mbus.code = wsize->mbus_code;
-	sensor->video.mbus.field = V4L2_FIELD_NONE;
-	sensor->video.mbus.colorspace = wsize->colorspace;
-	sensor->video.fps = wsize->fps;
-	tx_isp_subdev_init(&sensor_platform_device, sd, &sensor_ops);
-	tx_isp_set_subdevdata(sd, client);
-	tx_isp_set_subdev_hostdata(sd, sensor);
-	private_i2c_set_clientdata(client, sd);
-
-	pr_debug("probe ok ------->%s\n", SENSOR_NAME);
-
-	return 0;
-
-err_get_mclk:
-	private_clk_disable(sensor->mclk);
-	private_clk_put(sensor->mclk);
-	kfree(sensor);
-
-	return -1;
-}
-
-static int sensor_remove(struct i2c_client *client) {
-	struct tx_isp_subdev *sd = private_i2c_get_clientdata(client);
-	struct tx_isp_sensor *sensor = tx_isp_get_subdev_hostdata(sd);
-
-	if (reset_gpio != -1)
-		private_gpio_free(reset_gpio);
-	if (pwdn_gpio != -1)
-		private_gpio_free(pwdn_gpio);
-
-	private_clk_disable(sensor->mclk);
-	private_clk_put(sensor->mclk);
-	tx_isp_subdev_deinit(sd);
-	kfree(sensor);
+	core->attr.expo_fs = 1;
+	sensor->video.shvflip = shvflip[core->id];
+	sensor->video.attr = &core->attr;
+	sensor->video.vi_max_width = core->wsize->width;
+	sensor->video.vi_max_height = core->wsize->height;
+	sensor_core_set_video(sensor, core->wsize);
+	sensor_core_register(core, &sensor_platform_device, &sensor_ops, client);
 
 	return 0;
 }
@@ -1118,7 +868,7 @@ static struct i2c_driver sensor_driver = {
 		.name = SENSOR_NAME,
 	},
 	.probe = sensor_probe,
-	.remove = sensor_remove,
+	.remove = sensor_core_remove,
 	.id_table = sensor_id,
 };
 
@@ -444,6 +444,43 @@ struct isp_core_af_sta_info{
 	unsigned char  af_scale_bottom;
 };
 
+/*
+ * 3A statistics ring.
+ * The tuning device can be mmap'ed to get a read-only ring of the latest
+ * ISP_CORE_STATS_RING_SLOTS frames of AE/AWB/AF statistics. The slots are
+ * filled at frame done. poll() on the tuning device reports POLLIN while a
+ * newer frame than the last one consumed is there, read() consumes it and
+ * returns its sequence as an unsigned int.
+ * A slot is consistent when its sequence is the same before and after it
+ * has been copied by the reader.
+ */
+#define ISP_CORE_STATS_RING_SLOTS	4	/* must be a power of 2 */
+#define ISP_CORE_STATS_RING_MAGIC	0x33415354	/* "3AST" */
+
+struct isp_core_stats_frame{
+	unsigned int sequence;		/* frame sequence, 0 means the slot is empty or being updated */
+	unsigned int reserved;
+	unsigned long long timestamp;	/* raw monotonic time in ns */
+	struct isp_core_ae_sta_info ae;
+	struct isp_core_awb_sta_info awb;
+	struct isp_core_af_sta_info af;
+};
+
+struct isp_core_stats_ring{
+	unsigned int magic;
+	unsigned int slots;		/* number of slots */
+	unsigned int slot_size;		/* sizeof(struct isp_core_stats_frame) */
+	unsigned int sequence;		/* sequence of the latest complete slot */
+	struct isp_core_stats_frame frame[ISP_CORE_STATS_RING_SLOTS];
+};
+
+struct isp_core_stats_ring_attr{
+	unsigned int slots;
+	unsigned int slot_size;
+	unsigned int map_size;		/* length to pass to mmap */
+	unsigned int sequence;
+};
+
 typedef struct _system_tab_ctrl{
 	bool ctrl_global_freeze_firmware ;
 	bool ctrl_global_manual_exposure ;
@@ -655,6 +692,7 @@ enum isp_image_tuning_private_cmd_id {
 	IMAGE_TUNING_CID_CUSTOM_TEMPER_DNS,		//temper denoise
 	IMAGE_TUNING_CID_CUSTOM_DRC,			//raw dynamic range compression
 	IMAGE_TUNING_CID_CUSTOM_WDR,			//sharpen
+	IMAGE_TUNING_CID_STATS_RING_ATTR,		//3A statistics ring layout
 };
 
 struct image_tuning_ctrls {
@@ -792,6 +830,14 @@ typedef struct isp_core_tuning_driver {
 	spinlock_t 			slock;
 	struct mutex			mlock;
 	int			state;
+
+	/* 3A statistics ring */
+	struct isp_core_stats_ring	*stats_ring;
+	unsigned int			stats_ring_size;
+	unsigned int			stats_sequence;
+	atomic_t			stats_mapped;
+	wait_queue_head_t		stats_wq;
+
 	struct file_operations *fops;
 	int (*event)(struct isp_core_tuning_driver *tuning, unsigned int event, void *data);
 } image_tuning_vdrv_t;
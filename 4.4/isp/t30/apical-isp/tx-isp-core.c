@@ -13,6 +13,7 @@
 #include <asm/mipsregs.h>
 #include <linux/mm.h>
 #include <linux/clk.h>
+#include <linux/math64.h>
 
 #include <tx-isp-list.h>
 #include "tx-isp-core.h"
@@ -52,6 +53,19 @@ static int isp_clk = ISP_CLK_1080P_MODE;
 module_param(isp_clk, int, S_IRUGO);
 MODULE_PARM_DESC(isp_clk, "isp core clock");
 
+/* the core clock follows the pixel rate of the sensor mode when it isn't 0, isp_clk is the upper limit */
+static int isp_clk_auto = 0;
+module_param(isp_clk_auto, int, S_IRUGO);
+MODULE_PARM_DESC(isp_clk_auto, "scale isp core clock with the sensor mode");
+
+static int isp_clk_margin = 20;
+module_param(isp_clk_margin, int, S_IRUGO);
+MODULE_PARM_DESC(isp_clk_margin, "isp core clock margin, unit percent");
+
+static int isp_clk_min = 24000000;
+module_param(isp_clk_min, int, S_IRUGO);
+MODULE_PARM_DESC(isp_clk_min, "the lowest isp core clock");
+
 /*
    @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
    manager the buffer of frame channels
@@ -332,10 +346,40 @@ static int isp_configure_base_addr(struct tx_isp_core_device *core)
 	return 0;
 }
 
+/*
+ * Step the decimation pattern on a frame end of the channel, the result is
+ * used by the next frame. A skipped frame is cancelled on the dma writer, so
+ * it takes neither bus bandwidth nor a buffer, and raises no writer interrupt.
+ * The first frame after streamon is always written.
+ */
+static inline void isp_decimate_frame(struct isp_core_output_channel *chan)
+{
+	unsigned long flags = 0;
+
+	private_spin_lock_irqsave(&chan->slock, flags);
+	if (chan->state == TX_ISP_MODULE_RUNNING) {
+		if (chan->decimate_update) {
+			chan->decimate_pattern = chan->decimate_new_pattern;
+			chan->decimate_window = chan->decimate_new_window;
+			chan->decimate_pos = 0;
+			chan->decimate_update = 0;
+		} else if (chan->decimate_window) {
+			chan->decimate_pos = (chan->decimate_pos + 1) % chan->decimate_window;
+		}
+		chan->decimate_skip = chan->decimate_window && !(chan->decimate_pattern & (1 << chan->decimate_pos));
+		if (chan->decimate_skip)
+			chan->decimate_skipped++;
+	} else {
+		chan->decimate_skip = 0;
+	}
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+}
+
 static inline int isp_enable_channel(struct isp_core_output_channel *chan)
 {
 	unsigned int hw_dma = 0;
 	unsigned char next_bank = 0;
+	unsigned char onoff = 0;
 	hw_dma = APICAL_READ_32(0xb24 + 0x100 * (chan->index));
 	next_bank = (((hw_dma >> 8) & 0x7) + 1) % chan->usingbanks;
 	if(chan->pad->link.flag & TX_ISP_PADLINK_LFB){
@@ -351,9 +395,10 @@ static inline int isp_enable_channel(struct isp_core_output_channel *chan)
 		return 0;
 	}
 
-	if(chan->bank_flag[next_bank] ^ chan->dma_state){
+	onoff = chan->bank_flag[next_bank] && !chan->decimate_skip;
+	if(onoff ^ chan->dma_state){
 		/*printk("## %s %d ##\n",__func__,__LINE__);	*/
-		chan->dma_state = chan->bank_flag[next_bank];
+		chan->dma_state = onoff;
 		isp_enable_dma_transfer(chan, chan->dma_state);
 	}
 	return 0;
@@ -485,6 +530,7 @@ static inline void isp_core_update_addr(struct isp_core_output_channel *chan)
 		buf.priv = core->frame_sequeue;
 		tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_DQUEUE_BUFFER, &buf);
 		chan->bank_flag[bank_id] = 0;
+		chan->decimate_delivered++;
 	}else{
 		tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_DQUEUE_BUFFER, NULL);
 	}
@@ -498,6 +544,94 @@ static inline void isp_core_update_addr(struct isp_core_output_channel *chan)
 static char g_switch_lfb_off = 0;
 static char g_switch_lfb_on = 0;
 extern void tx_isp_sync_ldc(void);
+static struct tx_isp_core_device *g_core = NULL;
+
+/* the mean of the 5 bins AE histogram, every bin is weighted by its centre. */
+static inline unsigned int isp_core_ae_luma(void)
+{
+	unsigned int edge[6];
+	unsigned int hist[5];
+	unsigned int sum = 0;
+	unsigned int i = 0;
+
+	edge[0] = 0;
+	edge[1] = apical_isp_metering_hist_thresh_0_1_read();
+	edge[2] = apical_isp_metering_hist_thresh_1_2_read();
+	edge[3] = apical_isp_metering_hist_thresh_3_4_read();
+	edge[4] = apical_isp_metering_hist_thresh_4_5_read();
+	edge[5] = 255;
+
+	hist[0] = apical_isp_metering_hist_0_read();
+	hist[1] = apical_isp_metering_hist_1_read();
+	hist[3] = apical_isp_metering_hist_3_read();
+	hist[4] = apical_isp_metering_hist_4_read();
+	hist[2] = 0xffff - hist[0] - hist[1] - hist[3] - hist[4];
+
+	for (i = 0; i < 5; i++)
+		sum += hist[i] * ((edge[i] + edge[i + 1]) >> 1);
+	return sum / 0xffff;
+}
+
+/*
+ * The exposure the sensor applied to frame seq: it was requested delay
+ * frames before, the first frames of a stream get the earliest request.
+ */
+static inline struct isp_core_meta_expo *isp_core_meta_applied(struct tx_isp_core_device *core,
+		unsigned int seq, unsigned int delay)
+{
+	if (delay > ISP_CORE_META_DELAY_MAX - 1)
+		delay = ISP_CORE_META_DELAY_MAX - 1;
+	if (delay > seq - 1)
+		delay = seq - 1;
+	return &core->meta_expo[(seq - delay) % ISP_CORE_META_DELAY_MAX];
+}
+
+static inline void isp_core_latch_frame_meta(struct tx_isp_core_device *core)
+{
+	struct frame_channel_meta *meta = &core->frame_meta;
+	struct tx_isp_sensor_attribute *attr = core->vin.attr;
+	struct isp_core_meta_expo *expo = NULL;
+	unsigned int seq = core->frame_sequeue;
+	unsigned long flags = 0;
+
+	private_spin_lock_irqsave(&core->slock, flags);
+	expo = &core->meta_expo[seq % ISP_CORE_META_DELAY_MAX];
+	expo->integration_time = stab.global_integration_time;
+	expo->sensor_again = stab.global_sensor_analog_gain;
+	expo->sensor_dgain = stab.global_sensor_digital_gain;
+
+	meta->sequence = seq;
+	meta->integration_time = isp_core_meta_applied(core, seq, attr ? attr->integration_time_apply_delay : 0)->integration_time;
+	meta->sensor_again = isp_core_meta_applied(core, seq, attr ? attr->again_apply_delay : 0)->sensor_again;
+	meta->sensor_dgain = isp_core_meta_applied(core, seq, attr ? attr->dgain_apply_delay : 0)->sensor_dgain;
+	meta->isp_dgain = stab.global_isp_digital_gain;
+	meta->ae_luma = isp_core_ae_luma();
+	meta->awb_rgain = apical_isp_white_balance_gain_00_read();
+	meta->awb_bgain = apical_isp_white_balance_gain_11_read();
+	meta->daynight = core->tuning ? core->tuning->ctrls.daynight : 0;
+	private_spin_unlock_irqrestore(&core->slock, flags);
+}
+
+/*
+ * Get the capture parameters of the frame that the isp is outputting.
+ * It is called by the frame channels when a buffer is done.
+ */
+void tx_isp_core_get_frame_meta(struct frame_channel_meta *meta)
+{
+	struct tx_isp_core_device *core = g_core;
+	unsigned long flags = 0;
+	unsigned int index = meta->index;
+
+	if (core == NULL) {
+		memset(meta, 0, sizeof(*meta));
+	} else {
+		private_spin_lock_irqsave(&core->slock, flags);
+		*meta = core->frame_meta;
+		private_spin_unlock_irqrestore(&core->slock, flags);
+	}
+	meta->index = index;
+}
+
 static irqreturn_t ispcore_interrupt_service_routine(struct tx_isp_subdev *sd, u32 status, bool *handled)
 {
 	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
@@ -522,6 +656,7 @@ static irqreturn_t ispcore_interrupt_service_routine(struct tx_isp_subdev *sd, u
 						isp_configure_base_addr(core);
 						core->frame_state = 1;
 						core->frame_sequeue++;
+						isp_core_latch_frame_meta(core);
 						ret = IRQ_WAKE_THREAD;
 						break;
 					case APICAL_IRQ_FRAME_WRITER_FR:
@@ -566,7 +701,8 @@ static irqreturn_t ispcore_interrupt_service_routine(struct tx_isp_subdev *sd, u
 						core->frame_state = 0;
 						isp_configure_base_addr(core);
 						isp_modify_dma_direction(chan);
-						if(chan->dma_state != 1){
+						isp_decimate_frame(chan);
+						if(chan->dma_state != 1 || chan->decimate_window){
 							isp_enable_channel(chan);
 						}
 
@@ -599,7 +735,8 @@ static irqreturn_t ispcore_interrupt_service_routine(struct tx_isp_subdev *sd, u
 					case APICAL_IRQ_DS1_OUTPUT_END:
 						chan = &core->chans[ISP_DS1_VIDEO_CHANNEL];
 						isp_modify_dma_direction(chan);
-						if(chan->dma_state != 1){
+						isp_decimate_frame(chan);
+						if(chan->dma_state != 1 || chan->decimate_window){
 							isp_enable_channel(chan);
 						}
 						break;
@@ -607,7 +744,8 @@ static irqreturn_t ispcore_interrupt_service_routine(struct tx_isp_subdev *sd, u
 					case APICAL_IRQ_DS2_OUTPUT_END:
 						chan = &core->chans[ISP_DS2_VIDEO_CHANNEL];
 						isp_modify_dma_direction(chan);
-						if(chan->dma_state != 1){
+						isp_decimate_frame(chan);
+						if(chan->dma_state != 1 || chan->decimate_window){
 							isp_enable_channel(chan);
 						}
 						break;
@@ -1302,6 +1440,14 @@ static int ispcore_frame_channel_streamon(struct tx_isp_subdev_pad *pad)
 	private_spin_lock_irqsave(&chan->slock, flags);
 	chan->state = TX_ISP_MODULE_RUNNING;
 	pad->state = TX_ISP_PADSTATE_STREAM;
+	if (chan->decimate_window && !chan->decimate_update) {
+		chan->decimate_new_pattern = chan->decimate_pattern;
+		chan->decimate_new_window = chan->decimate_window;
+		chan->decimate_update = 1;
+	}
+	chan->decimate_skip = 0;
+	chan->decimate_delivered = 0;
+	chan->decimate_skipped = 0;
 	private_spin_unlock_irqrestore(&chan->slock, flags);
 	apical_isp_input_port_field_mode_write(0); // Temporary measures
 
@@ -1578,6 +1724,9 @@ static int ispcore_frame_channel_set_fmt(struct tx_isp_subdev_pad *pad, void *da
 		goto failed_s_fmt;
 	}
 	chan->fmt = *fmt;
+	/* a streaming channel has taken it at once */
+	if(chan->state == TX_ISP_MODULE_RUNNING)
+		tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_FMT_CHANGED, &chan->fmt);
 	return 0;
 failed_s_fmt:
 	if(fmt->scaler_enable)
@@ -1603,6 +1752,101 @@ static inline int ispcore_frame_channel_s_banks(struct tx_isp_subdev_pad *pad, v
 	return 0;
 }
 
+/*
+ * The decimation pattern of a channel, it takes effect on the next frame end
+ * and the window restarts there.
+ */
+static int ispcore_frame_channel_set_decimate(struct tx_isp_subdev_pad *pad, void *data)
+{
+	struct isp_core_output_channel *chan = pad->priv;
+	struct frame_channel_decimate *dec = data;
+	unsigned int mask = 0;
+	unsigned long flags = 0;
+
+	if (IS_ERR_OR_NULL(chan) || dec == NULL)
+		return -EINVAL;
+	if (dec->window > 32)
+		return -EINVAL;
+	mask = dec->window == 32 ? 0xffffffff : (1U << dec->window) - 1;
+	if (dec->window && !(dec->pattern & mask)) {
+		ISP_ERROR("chan%d: the decimation pattern writes no frame\n", chan->index);
+		return -EINVAL;
+	}
+
+	private_spin_lock_irqsave(&chan->slock, flags);
+	chan->decimate_new_pattern = dec->pattern & mask;
+	chan->decimate_new_window = dec->window;
+	chan->decimate_update = 1;
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+	return 0;
+}
+
+static int ispcore_frame_channel_get_decimate(struct tx_isp_subdev_pad *pad, void *data)
+{
+	struct isp_core_output_channel *chan = pad->priv;
+	struct frame_channel_decimate *dec = data;
+	unsigned long flags = 0;
+
+	if (IS_ERR_OR_NULL(chan) || dec == NULL)
+		return -EINVAL;
+
+	private_spin_lock_irqsave(&chan->slock, flags);
+	dec->pattern = chan->decimate_update ? chan->decimate_new_pattern : chan->decimate_pattern;
+	dec->window = chan->decimate_update ? chan->decimate_new_window : chan->decimate_window;
+	dec->delivered = chan->decimate_delivered;
+	dec->skipped = chan->decimate_skipped;
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+	return 0;
+}
+
+/*
+ * The packing of the raw frames, they are only given on DS1 when the isp is
+ * bypassed, DS1 DMA is the only one which takes the raw data.
+ * The frame channel fills the layout of its buffers.
+ */
+static int ispcore_frame_channel_get_raw_info(struct tx_isp_subdev_pad *pad, void *data)
+{
+	struct tx_isp_subdev *sd = IS_ERR_OR_NULL(pad) ? NULL : pad->sd;
+	struct tx_isp_core_device *core = IS_ERR_OR_NULL(sd) ? NULL : tx_isp_get_subdevdata(sd);
+	struct isp_core_output_channel *chan = IS_ERR_OR_NULL(pad) ? NULL : pad->priv;
+	struct frame_channel_raw_buffer *raw = data;
+	unsigned int black = 0;
+	int i;
+
+	if (IS_ERR_OR_NULL(core) || IS_ERR_OR_NULL(chan) || raw == NULL)
+		return -EINVAL;
+	if (chan->index != ISP_DS1_VIDEO_CHANNEL)
+		return -EPERM;
+	if (core->bypass != TX_ISP_FRAME_CHANNEL_BYPASS_ISP_ENABLE)
+		return -EPERM;
+
+	switch (core->vin.mbus.code) {
+		case V4L2_MBUS_FMT_SBGGR8_1X8:
+		case V4L2_MBUS_FMT_SGBRG8_1X8:
+		case V4L2_MBUS_FMT_SGRBG8_1X8:
+		case V4L2_MBUS_FMT_SRGGB8_1X8:
+			raw->bit_depth = 8;
+			break;
+		case V4L2_MBUS_FMT_SBGGR12_1X12:
+		case V4L2_MBUS_FMT_SGBRG12_1X12:
+		case V4L2_MBUS_FMT_SGRBG12_1X12:
+		case V4L2_MBUS_FMT_SRGGB12_1X12:
+			raw->bit_depth = 12;
+			break;
+		default:
+			raw->bit_depth = 10;
+			break;
+	}
+	raw->cfa = core->contrl.pattern;
+	/* the offset registers are tuning values, the pedestal is the sensor's */
+	if (core->vin.attr)
+		black = core->vin.attr->black_level;
+	for (i = 0; i < 4; i++)
+		raw->black_level[i] = black;
+
+	return 0;
+}
+
 static int ispcore_pad_event_handle(struct tx_isp_subdev_pad *pad, unsigned int event, void *data)
 {
 	int ret = 0;
@@ -1613,6 +1857,9 @@ static int ispcore_pad_event_handle(struct tx_isp_subdev_pad *pad, unsigned int
 	switch(event){
 		case TX_ISP_EVENT_FRAME_CHAN_BYPASS_ISP:
 			break;
+		case TX_ISP_EVENT_FRAME_CHAN_GET_RAW_INFO:
+			ret = ispcore_frame_channel_get_raw_info(pad, data);
+			break;
 		case TX_ISP_EVENT_FRAME_CHAN_GET_FMT:
 			ret = ispcore_frame_channel_get_fmt(pad, data);
 			break;
@@ -1634,6 +1881,12 @@ static int ispcore_pad_event_handle(struct tx_isp_subdev_pad *pad, unsigned int
 		case TX_ISP_EVENT_FRAME_CHAN_SET_BANKS:
 			ret = ispcore_frame_channel_s_banks(pad, data);
 			break;
+		case TX_ISP_EVENT_FRAME_CHAN_SET_DECIMATE:
+			ret = ispcore_frame_channel_set_decimate(pad, data);
+			break;
+		case TX_ISP_EVENT_FRAME_CHAN_GET_DECIMATE:
+			ret = ispcore_frame_channel_get_decimate(pad, data);
+			break;
 		default:
 			break;
 	}
@@ -1814,6 +2067,61 @@ static int isp_config_input_port(struct tx_isp_core_device *core)
 	return ret;
 }
 
+/*
+ * The clock takes the rate its dividers give, which may be above the one
+ * asked for. It is asked again for less by the overshoot until it stays at
+ * or below the ceiling, or it is left at the ceiling as before the scaling.
+ */
+#define ISP_CLK_SET_RETRY	4
+
+static unsigned long ispcore_clk_set_at_most(struct clk *clk, unsigned long rate, unsigned long ceiling)
+{
+	unsigned long got = 0;
+	int i = 0;
+
+	for (i = 0; i < ISP_CLK_SET_RETRY; i++) {
+		private_clk_set_rate(clk, rate);
+		got = private_clk_get_rate(clk);
+		if (got <= ceiling)
+			return got;
+		if (rate <= got - ceiling)
+			break;
+		rate -= got - ceiling;
+	}
+	private_clk_set_rate(clk, ceiling);
+	return private_clk_get_rate(clk);
+}
+
+/*
+ * The isp processes a pixel per clock, so the core clock must keep up with
+ * width * total height * fps, the lines of vertical blanking included.
+ * It is called at streamon and when the fps of the sensor is changed.
+ */
+static void ispcore_clks_scale(struct tx_isp_core_device *core)
+{
+	struct tx_isp_subdev *sd = &core->sd;
+	struct tx_isp_video_in *vin = &core->vin;
+	unsigned int num = vin->fps >> 16;
+	unsigned int den = vin->fps & 0xffff;
+	unsigned long long pixel_rate = 0;
+	unsigned long rate = 0;
+	int i = 0;
+
+	if (!isp_clk_auto || !vin->attr || !vin->attr->total_height || !num || !den)
+		return;
+
+	pixel_rate = div_u64((u64)vin->mbus.width * vin->attr->total_height * num, den);
+	rate = div_u64(pixel_rate * (100 + isp_clk_margin), 100);
+	rate = clamp_t(unsigned long, rate, isp_clk_min, isp_clk);
+
+	for (i = 0; i < sd->clk_num; i++) {
+		if (private_clk_get_rate(sd->clks[i]) == DUMMY_CLOCK_RATE)
+			continue;
+		core->clk_rate = ispcore_clk_set_at_most(sd->clks[i], rate, isp_clk);
+	}
+	core->clk_util = core->clk_rate ? div_u64(pixel_rate * 100, core->clk_rate) : 0;
+}
+
 static int inline isp_core_video_streamon(struct tx_isp_core_device *core)
 {
 	apical_api_control_t api;
@@ -1837,6 +2145,7 @@ static int inline isp_core_video_streamon(struct tx_isp_core_device *core)
 
 	/* config isp input port */
 	isp_config_input_port(core);
+	ispcore_clks_scale(core);
 
 	/*
 	 * clear interrupts state of isp-core.
@@ -2053,6 +2362,8 @@ static int ispcore_sync_sensor_attr(struct tx_isp_subdev *sd, void *arg)
 		memcpy(&core->vin, (void *)arg, sizeof(struct tx_isp_video_in));
 		/* isp_config_input_port(core); */
 		stab.global_max_integration_time = core->vin.attr->max_integration_time;
+		if (core->state == TX_ISP_MODULE_RUNNING)
+			ispcore_clks_scale(core);
 	}else
 		memset(&core->vin, 0, sizeof(struct tx_isp_video_in));
 	return 0;
@@ -2310,6 +2621,7 @@ static int isp_core_output_channel_deinit(struct tx_isp_core_device *core)
 static int isp_info_show(struct seq_file *m, void *v)
 {
 	int len = 0;
+	int i = 0;
 	struct tx_isp_module *module = (void *)(m->private);
 	struct tx_isp_subdev *sd = IS_ERR_OR_NULL(module) ? NULL : module_to_subdev(module);
 	struct tx_isp_core_device *core = IS_ERR_OR_NULL(sd) ? NULL : tx_isp_get_subdevdata(sd);
@@ -2466,6 +2778,13 @@ static int isp_info_show(struct seq_file *m, void *v)
 	len += seq_printf(m ,"ISP Top Value : 0x%x\n", APICAL_READ_32(0x40));
 	len += seq_printf(m ,"ISP Runing Mode : %s\n", ((apical_isp_ds1_cs_conv_clip_min_uv_read() == 512) ? "Night" : "Day"));
 	len += seq_printf(m ,"ISP OUTPUT FPS : %d / %d\n", vin->fps >> 16, vin->fps & 0xffff);
+	len += seq_printf(m ,"ISP Core Clock : %lu Hz, utilization %u%%\n", core->clk_rate, core->clk_util);
+	for (i = 0; i < core->num_chans; i++) {
+		if (core->chans[i].decimate_window)
+			len += seq_printf(m ,"ISP chan%d decimation : 0x%x / %d, delivered %u, skipped %u\n", i,
+					core->chans[i].decimate_pattern, core->chans[i].decimate_window,
+					core->chans[i].decimate_delivered, core->chans[i].decimate_skipped);
+	}
 	len += seq_printf(m ,"SENSOR analog gain : %d\n", sensor_again);
 	len += seq_printf(m ,"MAX SENSOR analog gain : %d\n", max_sensor_again);
 	len += seq_printf(m ,"SENSOR digital gain : %d\n", sensor_dgain);
@@ -2600,6 +2919,7 @@ static int tx_isp_core_probe(struct platform_device *pdev)
 	tx_isp_set_subdevdata(sd, core_dev);
 	tx_isp_set_module_nodeops(&sd->module, core_dev->tuning->fops);
 	tx_isp_set_subdev_debugops(sd, &isp_info_proc_fops);
+	g_core = core_dev;
 
 	/* apical init */
 	system_isp_set_base_address(core_dev->sd.base);
@@ -2623,6 +2943,7 @@ static int __exit tx_isp_core_remove(struct platform_device *pdev)
 	struct tx_isp_subdev *sd = module_to_subdev(module);
 	struct tx_isp_core_device *core = tx_isp_get_subdevdata(sd);
 
+	g_core = NULL;
 	if(core->tuning){
 		isp_core_tuning_deinit(core->tuning);
 		core->tuning = NULL;
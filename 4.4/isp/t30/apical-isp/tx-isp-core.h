@@ -100,6 +100,25 @@ struct isp_core_output_channel {
 	unsigned char reset_dma_flag;
 	unsigned char vflip_state;
 	unsigned char usingbanks;
+	/* the decimation pattern, the new one is latched on a frame end */
+	unsigned int decimate_pattern;
+	unsigned int decimate_window;
+	unsigned int decimate_pos;
+	unsigned int decimate_new_pattern;
+	unsigned int decimate_new_window;
+	unsigned char decimate_update;
+	unsigned char decimate_skip;
+	unsigned int decimate_delivered;
+	unsigned int decimate_skipped;
+};
+
+/* the sensor applies an exposure at most this many frames after the request */
+#define ISP_CORE_META_DELAY_MAX	4
+
+struct isp_core_meta_expo {
+	unsigned int integration_time;
+	unsigned int sensor_again;
+	unsigned int sensor_dgain;
 };
 
 struct tx_isp_core_device {
@@ -128,6 +147,13 @@ struct tx_isp_core_device {
 	unsigned int hflip_state; //0:disable, 1: enable
 	unsigned int hflip_change; //0:disable, 1: enable
 	unsigned int isp_daynight_switch;
+	/* the capture parameters latched at the last frame start */
+	struct frame_channel_meta frame_meta;
+	/* the exposure requested at the last frame starts, by sequence */
+	struct isp_core_meta_expo meta_expo[ISP_CORE_META_DELAY_MAX];
+	/* the core clock chosen for the sensor mode, 0 when it is fixed */
+	unsigned long clk_rate;
+	unsigned int clk_util;
 	/* i2c sync messages */
 	struct tx_isp_i2c_msg i2c_msgs[TX_ISP_I2C_SET_BUTTON];
 	/* the private parameters */
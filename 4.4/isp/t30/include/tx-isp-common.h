@@ -283,6 +283,7 @@ struct tx_isp_sensor_attribute{
 	unsigned short again_apply_delay;
 	unsigned short dgain_apply_delay;
 	unsigned short one_line_expr_in_us;
+	unsigned short black_level;	//the raw pedestal in 12 bits, 0 is unknown
 	TX_ISP_SENSOR_CTRL sensor_ctrl;
 	void *priv; /* point to struct tx_isp_sensor_board_info */
 };
@@ -330,6 +331,11 @@ enum tx_isp_notification {
 	TX_ISP_EVENT_FRAME_CHAN_DQUEUE_BUFFER,
 	TX_ISP_EVENT_FRAME_CHAN_FREE_BUFFER,
 	TX_ISP_EVENT_FRAME_CHAN_SET_BANKS,
+	TX_ISP_EVENT_FRAME_CHAN_SLICE_START,
+	TX_ISP_EVENT_FRAME_CHAN_GET_RAW_INFO,
+	TX_ISP_EVENT_FRAME_CHAN_SET_DECIMATE,
+	TX_ISP_EVENT_FRAME_CHAN_GET_DECIMATE,
+	TX_ISP_EVENT_FRAME_CHAN_FMT_CHANGED,
 	/* the tuning node of isp's core */
 	TX_ISP_EVENT_ACTIVATE_MODULE = NOTIFICATION_TYPE_TUN_OPS,
 	TX_ISP_EVENT_SLAVE_MODULE,
@@ -383,6 +389,95 @@ struct frame_image_format {
 	unsigned int rate_mask;
 };
 
+/**
+ * struct frame_channel_meta - capture parameters of a frame
+ * @index:	buffer index, given by the caller of VIDIOC_DEFAULT_CMD_GET_FRAME_META
+ * @sequence:	isp frame sequence the parameters were latched at
+ * @integration_time:	sensor integration time, in lines
+ * @sensor_again:	sensor analog gain, log2 fixed point (5 fraction bits)
+ * @sensor_dgain:	sensor digital gain, log2 fixed point (5 fraction bits)
+ * @isp_dgain:		isp digital gain, log2 fixed point (5 fraction bits)
+ * @ae_luma:	average luma from the AE histogram, 0 ~ 255
+ * @awb_rgain:	white balance red gain
+ * @awb_bgain:	white balance blue gain
+ * @daynight:	day(0) or night(1) mode
+ * @width:	width of the frame in the buffer
+ * @height:	height of the frame in the buffer
+ * @bytesperline:	stride of the frame in the buffer
+ * @fmt_sequence:	bumped by every format change of a streaming channel,
+ *		the first buffer of a new format has a new value
+ */
+struct frame_channel_meta {
+	unsigned int index;
+	unsigned int sequence;
+	unsigned int integration_time;
+	unsigned int sensor_again;
+	unsigned int sensor_dgain;
+	unsigned int isp_dgain;
+	unsigned int ae_luma;
+	unsigned int awb_rgain;
+	unsigned int awb_bgain;
+	unsigned int daynight;
+	unsigned int width;
+	unsigned int height;
+	unsigned int bytesperline;
+	unsigned int fmt_sequence;
+};
+
+/*
+ * struct frame_channel_slice - progress of a buffer in slice mode
+ * @index:	buffer index
+ * @lines:	the lines to wait for; return the lines have been written
+ * @timeout:	the longest time to wait, in ms
+ * @lead_time:	how long the buffer was given before the whole frame was
+ *		written, in us; it is set when the whole frame is written
+ */
+struct frame_channel_slice {
+	unsigned int index;
+	unsigned int lines;
+	unsigned int timeout;
+	unsigned int lead_time;
+};
+
+/*
+ * struct frame_channel_raw_buffer - a raw buffer exported as a dmabuf
+ * @index:	buffer index, given by the caller
+ * @fd:		the dmabuf of the buffer
+ * @length:	size of the buffer
+ * @width:	width of the frame
+ * @height:	height of the frame
+ * @bytesperline:	a pixel takes 16 bits, the valid bits are the lsbs
+ * @bit_depth:	the valid bits of a pixel
+ * @cfa:	the color of the first pixels, 0:RGGB 1:GRBG 2:GBRG 3:BGGR
+ * @black_level:	the black level of the four colors in cfa order, in 12 bits,
+ *		0 if the sensor does not give its pedestal
+ */
+struct frame_channel_raw_buffer {
+	unsigned int index;
+	int fd;
+	unsigned int length;
+	unsigned int width;
+	unsigned int height;
+	unsigned int bytesperline;
+	unsigned int bit_depth;
+	unsigned int cfa;
+	unsigned int black_level[4];
+};
+
+/*
+ * struct frame_channel_decimate - the frames which are written by a channel
+ * @pattern:	bit n is the n-th frame of the window, 1 is written, 0 is skipped
+ * @window:	the frames of a window, 1 ~ 32; 0 writes all frames
+ * @delivered:	the frames which have been written since streamon, read only
+ * @skipped:	the frames which have been skipped by the pattern, read only
+ */
+struct frame_channel_decimate {
+	unsigned int pattern;
+	unsigned int window;
+	unsigned int delivered;
+	unsigned int skipped;
+};
+
 #define ISP_LFB_DEFAULT_BUF_BASE0 0xf0000000
 #define ISP_LFB_DEFAULT_BUF_BASE1 0xf8000000
 enum tx_isp_module_link_id {
@@ -397,6 +492,12 @@ enum tx_isp_module_link_id {
 #define VIDIOC_GET_FRAME_FORMAT		_IOR('V', BASE_VIDIOC_PRIVATE + 4, struct frame_image_format)
 #define VIDIOC_DEFAULT_CMD_SET_BANKS	_IOW('V', BASE_VIDIOC_PRIVATE + 5, int)
 #define VIDIOC_DEFAULT_CMD_ISP_TUNING	_IOWR('V', BASE_VIDIOC_PRIVATE + 6, struct isp_image_tuning_default_ctrl)
+#define VIDIOC_DEFAULT_CMD_GET_FRAME_META	_IOWR('V', BASE_VIDIOC_PRIVATE + 7, struct frame_channel_meta)
+#define VIDIOC_DEFAULT_CMD_SET_SLICE	_IOW('V', BASE_VIDIOC_PRIVATE + 8, int)
+#define VIDIOC_DEFAULT_CMD_WAIT_SLICE	_IOWR('V', BASE_VIDIOC_PRIVATE + 9, struct frame_channel_slice)
+#define VIDIOC_DEFAULT_CMD_EXPORT_RAW	_IOWR('V', BASE_VIDIOC_PRIVATE + 10, struct frame_channel_raw_buffer)
+#define VIDIOC_DEFAULT_CMD_SET_DECIMATE	_IOW('V', BASE_VIDIOC_PRIVATE + 11, struct frame_channel_decimate)
+#define VIDIOC_DEFAULT_CMD_GET_DECIMATE	_IOR('V', BASE_VIDIOC_PRIVATE + 12, struct frame_channel_decimate)
 
 #define VIDIOC_CREATE_SUBDEV_LINKS	_IOW('V', BASE_VIDIOC_PRIVATE + 16, int)
 #define VIDIOC_DESTROY_SUBDEV_LINKS	_IOW('V', BASE_VIDIOC_PRIVATE + 17, int)
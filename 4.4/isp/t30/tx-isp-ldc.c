@@ -1026,6 +1026,11 @@ static int ldc_pad_event_handle(struct tx_isp_subdev_pad *pad, unsigned int even
 		case TX_ISP_EVENT_FRAME_CHAN_SET_FMT:
 			ret = ldc_frame_channel_set_fmt(pad, data);
 			break;
+		case TX_ISP_EVENT_FRAME_CHAN_FMT_CHANGED:
+			/* the input has switched to the format set through us */
+			if(pad->type == TX_ISP_PADTYPE_INPUT)
+				ret = tx_isp_send_event_to_remote(pad->sd->outpads, event, data);
+			break;
 		case TX_ISP_EVENT_FRAME_CHAN_STREAM_ON:
 			ret = ldc_frame_channel_streamon(pad);
 			break;
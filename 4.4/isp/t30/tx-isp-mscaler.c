@@ -60,6 +60,8 @@ unsigned int ispscalerwh = 0;
 module_param(ispscalerwh, int, S_IRUGO);
 MODULE_PARM_DESC(ispscalerwh, "The size of isp's scaler");
 
+static void mscaler_output_channel_config(struct isp_mscaler_output_channel *chan, struct frame_image_format *fmt);
+
 /*
    @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
    manager the buffer of frame channels
@@ -97,6 +99,17 @@ static void inline cleanup_buffer_fifo(struct list_head *fifo)
 	}
 }
 
+static void inline release_busy_buffer(struct isp_mscaler_output_channel *chan, unsigned int addr)
+{
+	struct frame_channel_buffer *buf;
+	tx_list_for_each_entry(buf, &chan->busy, entry){
+		if(buf->addr == addr){
+			tx_list_del(&(buf->entry));
+			break;
+		}
+	}
+}
+
 static void channel_dma_buffer_done(struct isp_mscaler_output_channel *chan)
 {
 	struct tx_isp_mscaler_device *mscaler = chan->priv;
@@ -114,6 +127,7 @@ static void channel_dma_buffer_done(struct isp_mscaler_output_channel *chan)
 				buf.priv = tx_isp_sd_readl(&(mscaler->sd), CHx_DMAOUT_Y_LAST_STATS_NUM(chan->index));
 				break;
 		}
+		release_busy_buffer(chan, buf.addr);
 		tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_DQUEUE_BUFFER, &buf);
 		chan->frame_cnt++;
 	}
@@ -140,6 +154,57 @@ static void configure_channel_dma_addr(struct isp_mscaler_output_channel *chan)
 				tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_Y_ADDR(chan->index), buf->addr);
 				break;
 		}
+		push_buffer_fifo(&chan->busy, buf);
+	}
+}
+
+/*
+ * Apply the format that was set when the channel was streaming.
+ * It is called between two frames, when all the channels have done and
+ * the front module hasn't been notified yet. The addresses in the dma fifo
+ * were computed with the old format, so they are cleared and the buffers
+ * are written again with the new one. No buffer is dropped.
+ */
+static void channel_apply_pending_fmt(struct isp_mscaler_output_channel *chan)
+{
+	struct tx_isp_mscaler_device *mscaler = chan->priv;
+	struct frame_channel_format *cfmt = NULL;
+
+	if(!chan->fmt_pending || chan->state != TX_ISP_MODULE_RUNNING)
+		return;
+
+	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_Y_ADDR_CLR(chan->index), 1);
+	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_UV_ADDR_CLR(chan->index), 1);
+	tx_list_splice_init(&chan->busy, &chan->fifo);
+
+	cfmt = (struct frame_channel_format *)(chan->pending_fmt.pix.priv);
+	mscaler_output_channel_config(chan, &chan->pending_fmt);
+	chan->fmt = chan->pending_fmt;
+	chan->lineoffset = chan->fmt.pix.width * (cfmt->depth / 8);
+	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_Y_STRI(chan->index), chan->lineoffset);
+	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_UV_STRI(chan->index), chan->lineoffset);
+	configure_channel_dma_addr(chan);
+	chan->fmt_pending = false;
+	chan->fmt_changes++;
+	tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_FMT_CHANGED, &chan->fmt);
+}
+
+/*
+ * A new frame starts, the first buffer of busy list is the one
+ * which will be written by dma; the frame channel follows it in slice mode.
+ */
+static void msclaer_notify_slice_start(struct tx_isp_mscaler_device *mscaler)
+{
+	struct isp_mscaler_output_channel *chan = NULL;
+	struct frame_channel_buffer *buf = NULL;
+	unsigned int index = 0;
+
+	for(index = 0; index < mscaler->num_outputs; index++){
+		chan = &(mscaler->outputs[index]);
+		if(chan->state != TX_ISP_MODULE_RUNNING || tx_list_empty(&chan->busy))
+			continue;
+		buf = tx_list_first_entry(&chan->busy, struct frame_channel_buffer, entry);
+		tx_isp_send_event_to_remote(chan->pad, TX_ISP_EVENT_FRAME_CHAN_SLICE_START, buf);
 	}
 }
 
@@ -154,8 +219,11 @@ static void msclaer_notify_front_module(struct tx_isp_mscaler_device *mscaler, u
 	struct isp_mscaler_input_channel *input = mscaler->inputs;
 //	unsigned int chans_enable = tx_isp_sd_readl(&(mscaler->sd), MSCA_CH_EN) & 0x7;
 	unsigned int chans_status = tx_isp_sd_readl(&(mscaler->sd), MSCA_CH_STAT) & 0x7;
+	unsigned int index = 0;
 	chan_done_state |= 1<<chan_id;
 	if((chans_status & chan_done_state) == chans_status){
+		for(index = 0; index < mscaler->num_outputs; index++)
+			channel_apply_pending_fmt(&(mscaler->outputs[index]));
 		tx_isp_send_event_to_remote(input->pad, TX_ISP_EVENT_FRAME_CHAN_QUEUE_BUFFER, NULL);
 		chan_done_state = 0;
 	}
@@ -195,6 +263,8 @@ static irqreturn_t mscaler_core_interrupt_service_routine(struct tx_isp_subdev *
 				case MS_IRQ_CSC_BIT:
 					break;
 				case MS_IRQ_FRM_BIT:
+					msclaer_notify_slice_start(mscaler);
+					break;
 				case MS_IRQ_CH2_CROP_BIT:
 				case MS_IRQ_CH1_CROP_BIT:
 				case MS_IRQ_CH0_CROP_BIT:
@@ -244,6 +314,7 @@ static int mscaler_frame_channel_freebufs(struct tx_isp_subdev_pad *pad, void *d
 	if(chan){
 		private_spin_lock_irqsave(&chan->slock, flags);
 		cleanup_buffer_fifo(&chan->fifo);
+		cleanup_buffer_fifo(&chan->busy);
 		private_spin_unlock_irqrestore(&chan->slock, flags);
 	}
 	return 0;
@@ -424,6 +495,9 @@ static int mscaler_frame_channel_streamon(struct tx_isp_subdev_pad *pad)
 		spin_unlock_irqrestore(&chan->slock, flags);
 		return ISP_SUCCESS;
 	}
+	/* the buffers of the channel can hold the frame of this size at most. */
+	chan->max_sizeimage = chan->fmt.pix.sizeimage;
+	chan->fmt_pending = false;
 	/* configure dma */
 	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_Y_STRI(chan->index), chan->lineoffset);
 	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_UV_STRI(chan->index), chan->lineoffset);
@@ -480,7 +554,9 @@ static int mscaler_frame_channel_streamoff(struct tx_isp_subdev_pad *pad)
 
 	/* streamoff */
 	pad->state = TX_ISP_PADSTATE_LINKED;
+	chan->fmt_pending = false;
 	cleanup_buffer_fifo(&chan->fifo);
+	cleanup_buffer_fifo(&chan->busy);
 	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_Y_ADDR_CLR(chan->index), 1); // clear Y fifo
 	tx_isp_sd_writel(&(mscaler->sd), CHx_DMAOUT_UV_ADDR_CLR(chan->index), 1); // clear UV fifo
 	spin_unlock_irqrestore(&chan->slock, flags);
@@ -854,6 +930,37 @@ static void mscaler_output_channel_config(struct isp_mscaler_output_channel *cha
 	tx_isp_sd_writel(&(mscaler->sd), CHx_OUT_FMT(chan->index), cfmt->priv);
 }
 
+/*
+ * Change the crop and scaler of a streaming channel. The new format
+ * takes effect on the next frame boundary and the queued buffers are
+ * reused, so the frame must fit in the buffers the stream was started with.
+ */
+static int mscaler_frame_channel_change_fmt(struct isp_mscaler_output_channel *chan,
+		struct frame_image_format *fmt, struct frame_channel_format *cfmt)
+{
+	unsigned long flags = 0;
+
+	if(fmt->pix.pixelformat != chan->fmt.pix.pixelformat){
+		ISP_ERROR("The chan%d can't change the pixel format when streaming!\n", chan->index);
+		return -EBUSY;
+	}
+
+	fmt->pix.bytesperline = fmt->pix.width * cfmt->depth / 8;
+	fmt->pix.sizeimage = fmt->pix.bytesperline * ((fmt->pix.height + 0xf) & (~0xf));
+	fmt->pix.priv = (unsigned int)cfmt;
+	if(fmt->pix.sizeimage > chan->max_sizeimage){
+		ISP_ERROR("The chan%d buffers are too small for %d*%d, please restart the stream!\n",
+				chan->index, fmt->pix.width, fmt->pix.height);
+		return -ENOSPC;
+	}
+
+	private_spin_lock_irqsave(&chan->slock, flags);
+	chan->pending_fmt = *fmt;
+	chan->fmt_pending = true;
+	private_spin_unlock_irqrestore(&chan->slock, flags);
+	return 0;
+}
+
 static int mscaler_frame_channel_set_fmt(struct tx_isp_subdev_pad *pad, void *data)
 {
 	/*struct tx_isp_subdev *sd = IS_ERR_OR_NULL(pad) ? NULL : pad->sd;*/
@@ -936,6 +1043,9 @@ static int mscaler_frame_channel_set_fmt(struct tx_isp_subdev_pad *pad, void *da
 		ISP_ERROR("OUTPUT can't support the fmt(%c%c%c%c)\n", value[0], value[1], value[2], value[3]);
 		return -EINVAL;
 	}
+	if(chan->state == TX_ISP_MODULE_RUNNING)
+		return mscaler_frame_channel_change_fmt(chan, fmt, cfmt);
+
 	private_mutex_lock(&mscaler->mlock);
 	if((fmt->pix.pixelformat == V4L2_PIX_FMT_RGB565)
 				|| (fmt->pix.pixelformat == V4L2_PIX_FMT_BGR32)){
@@ -1043,6 +1153,7 @@ static int mscaler_output_channel_init(struct tx_isp_mscaler_device *mscaler)
 		chan->min_width = 128;
 		chan->min_height = 128;
 		init_buffer_fifo(&(chan->fifo));
+		init_buffer_fifo(&(chan->busy));
 		private_spin_lock_init(&(chan->slock));
 		private_init_completion(&chan->stop_comp);
 		chan->priv = mscaler;
@@ -1137,6 +1248,7 @@ static int isp_mscaler_show(struct seq_file *m, void *v)
 		if(output->state != TX_ISP_MODULE_RUNNING)
 			continue;
 		len += seq_printf(m ,"output frames: %d\n", output->frame_cnt);
+		len += seq_printf(m ,"format changes: %d\n", output->fmt_changes);
 		fmt = (char *)(&output->fmt.pix.pixelformat);
 		len += seq_printf(m ,"output pixformat: %c%c%c%c\n", fmt[0],fmt[1],fmt[2],fmt[3]);
 		len += seq_printf(m ,"output resolution: %d * %d\n", output->fmt.pix.width, output->fmt.pix.height);
@@ -29,7 +29,13 @@ struct isp_mscaler_output_channel {
 	bool	has_crop;
 	bool	has_scaler;
 	struct list_head fifo;
+	struct list_head busy;	/* the buffers that have been written to dma fifo */
 	spinlock_t slock;
+	/* the format is changed on the next frame boundary when streaming */
+	struct frame_image_format pending_fmt;
+	bool	fmt_pending;
+	unsigned int max_sizeimage;
+	unsigned int fmt_changes;
 	/*unsigned char bank_flag[ISP_DMA_WRITE_MAXBASE_NUM];*/
 	/*unsigned char vflip_flag[ISP_DMA_WRITE_MAXBASE_NUM];*/
 	unsigned int lineoffset;
@@ -8,58 +8,22 @@
  */
 
 #include <txx-funcs.h>
-
-static const unsigned int __pow2_lut[33]={
-		1073741824,1097253708,1121280436,1145833280,1170923762,1196563654,1222764986,1249540052,
-		1276901417,1304861917,1333434672,1362633090,1392470869,1422962010,1454120821,1485961921,
-		1518500250,1551751076,1585730000,1620452965,1655936265,1692196547,1729250827,1767116489,
-		1805811301,1845353420,1885761398,1927054196,1969251188,2012372174,2056437387,2101467502,
-		2147483648U};
+#include <tx-isp-fixmath.h>
 
 uint32_t private_math_exp2(uint32_t val, const unsigned char shift_in, const unsigned char shift_out)
 {
-	unsigned int fract_part = (val & ((1<<shift_in)-1));
-	unsigned int int_part = val >> shift_in;
-	if (shift_in <= 5)
-	{
-		unsigned int lut_index = fract_part << (5-shift_in);
-		return __pow2_lut[lut_index] >> (30 - shift_out - int_part);
-	}
-	else
-	{
-		unsigned int lut_index = fract_part >> (shift_in - 5);
-		unsigned int lut_fract = fract_part & ((1<<(shift_in-5))-1);
-		unsigned int a = __pow2_lut[lut_index];
-		unsigned int b =  __pow2_lut[lut_index+1];
-		unsigned int res = ((unsigned long long)(b - a)*lut_fract) >> (shift_in-5);
-		res = (res + a) >> (30-shift_out-int_part);
-		return res;
-	}
+	return tx_isp_math_exp2(val, shift_in, shift_out);
 }
 EXPORT_SYMBOL(private_math_exp2);
 
 uint8_t private_leading_one_position(const uint32_t in)
 {
-	uint8_t pos = 0;
-	uint32_t val = in;
-	if (val >= 1<<16) { val >>= 16; pos += 16; }
-	if (val >= 1<< 8) { val >>=  8; pos +=  8; }
-	if (val >= 1<< 4) { val >>=  4; pos +=  4; }
-	if (val >= 1<< 2) { val >>=  2; pos +=  2; }
-	if (val >= 1<< 1) {             pos +=  1; }
-	return pos;
+	return tx_isp_leading_one_position(in);
 }
 
 int private_leading_one_position_64(uint64_t val)
 {
-	int pos = 0;
-	if (val >= (uint64_t)1<<32) { val >>= 32; pos += 32; }
-	if (val >= 1<<16) { val >>= 16; pos += 16; }
-	if (val >= 1<< 8) { val >>=  8; pos +=  8; }
-	if (val >= 1<< 4) { val >>=  4; pos +=  4; }
-	if (val >= 1<< 2) { val >>=  2; pos +=  2; }
-	if (val >= 1<< 1) {             pos +=  1; }
-	return pos;
+	return tx_isp_leading_one_position_64(val);
 }
 //  y = log2(x)
 //
@@ -69,81 +33,15 @@ int private_leading_one_position_64(uint64_t val)
 //
 uint32_t private_log2_int_to_fixed(const uint32_t val, const uint8_t out_precision, const uint8_t shift_out)
 {
-	int i;
-	int pos = 0;
-	uint32_t a = 0;
-	uint32_t b = 0;
-	uint32_t in = val;
-	uint32_t result = 0;
-	const unsigned char precision = out_precision;
-
-	if(0 == val)
-	{
-		return 0;
-	}
-	// integral part
-	pos = private_leading_one_position(val);
-	// fractional part
-	a = (pos <= 15) ? (in << (15 - pos)) : (in>>(pos - 15));
-	for(i = 0; i < precision; ++i)
-	{
-		b = a * a;
-		if(b & (1<<31))
-		{
-			result = (result << 1) + 1;
-			a = b >> 16;
-		}
-		else
-		{
-			result = (result << 1);
-			a = b >> 15;
-		}
-	}
-	return (((pos << precision) + result) << shift_out) | ((a & 0x7fff)>> (15-shift_out));
+	return tx_isp_log2_int_to_fixed(val, out_precision, shift_out);
 }
 EXPORT_SYMBOL(private_log2_int_to_fixed);
 
 uint32_t private_log2_int_to_fixed_64(uint64_t val, uint8_t out_precision, uint8_t shift_out)
 {
-	int i;
-	int pos = 0;
-	uint64_t a = 0;
-	uint64_t b = 0;
-	uint64_t in = val;
-	uint64_t result = 0;
-	const unsigned char precision = out_precision;
-
-	if(0 == val)
-	{
-		return 0;
-	}
-	// integral part
-	pos = private_leading_one_position_64(val);
-	// fractional part
-	a = (pos <= 15) ? (in << (15 - pos)) : (in>>(pos - 15));
-	for(i = 0; i < precision; ++i)
-	{
-		b = a * a;
-		if(b & (1<<31))
-		{
-			result = (result << 1) + 1;
-			a = b >> 16;
-		}
-		else
-		{
-			result = (result << 1);
-			a = b >> 15;
-		}
-	}
-	return (uint32_t)((((pos << precision) + result) << shift_out) | ((a & 0x7fff)>> (15-shift_out)));
+	return tx_isp_log2_int_to_fixed_64(val, out_precision, shift_out);
 }
-//  y = log2(x)
-//
-//	input:  Fixed point: x1.y1
-//	output: Fixed point: x2.y2
-//  y1: in_fraction
-//  y2: out_precision
-//
+
 uint32_t private_log2_fixed_to_fixed(const uint32_t val, const int in_fix_point, const uint8_t out_fix_point)
 {
 	return private_log2_int_to_fixed(val, out_fix_point, 0) - (in_fix_point << out_fix_point);
@@ -50,6 +50,9 @@ struct tx_isp_csi_device {
 	void __iomem *phy_base;
 	void * pdata;
 	unsigned int lans;
+	unsigned int err1_cnt;
+	unsigned int err2_cnt;
+	unsigned int recover_cnt;
 };
 
 #define csi_readl(port,reg)					\
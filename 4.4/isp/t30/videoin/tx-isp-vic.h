@@ -6,7 +6,13 @@
 #include <tx-lfb-regs.h>
 /*#include <linux/seq_file.h>*/
 #include <linux/proc_fs.h>
+#include <linux/hrtimer.h>
 /*#include <jz_proc.h>*/
+enum tx_isp_vic_recovery_state {
+	TX_ISP_VIC_RECOVERY_IDLE,
+	TX_ISP_VIC_RECOVERY_WAIT_FRAME,	/* blocks have been reset, wait for a good frame */
+};
+
 struct tx_isp_vic_device {
 	struct tx_isp_subdev sd;
 	struct tx_isp_video_in vin;
@@ -22,6 +28,21 @@ struct tx_isp_vic_device {
 	struct mutex snap_mlock;
 	unsigned int vic_frd_c;
 
+	/* online error recovery */
+	int recovery_state;
+	unsigned long recovery_start;
+	unsigned long recovery_kick;
+	unsigned int vic_err_c;
+	unsigned int lfb_err_c;
+	unsigned int csi_err_c;
+	unsigned int recovery_c;
+	unsigned int recovery_retry_c;
+	unsigned int recovery_last_ms;
+	unsigned int recovery_max_ms;
+	/* a link that stops sending frames is recovered by the watchdog */
+	struct hrtimer watchdog;
+	unsigned int watchdog_frd_c;
+	unsigned int watchdog_c;
 };
 
 #define tx_isp_vic_readl(port,reg)						\
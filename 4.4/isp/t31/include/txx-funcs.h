@@ -197,4 +197,6 @@ void private_get_isp_priv_mem(unsigned int *phyaddr, unsigned int *size);
 
 int private_driver_get_interface(void);
 
+#include <tx-isp-shim.h>
+
 #endif /*__TXX_DRV_FUNCS_H__*/
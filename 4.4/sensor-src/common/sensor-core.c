@@ -0,0 +1,918 @@
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/i2c.h>
+#include <linux/delay.h>
+#include <linux/gpio.h>
+#include <linux/clk.h>
+#include <linux/ktime.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/bitops.h>
+#include <sensor-core.h>
+
+/* Instances of this module's driver, the core is linked into each converted driver */
+static unsigned long sensor_core_ids;
+
+/*
+ * The init tables are played in batches: runs of consecutive registers
+ * become one auto-increment write, and up to SENSOR_CORE_XFER_MSGS writes
+ * go out in one i2c_transfer. A delay entry flushes the batch first.
+ */
+#define SENSOR_CORE_XFER_MSGS	16
+#define SENSOR_CORE_XFER_BYTES	256
+
+struct sensor_core_xfer {
+	struct i2c_msg msg[SENSOR_CORE_XFER_MSGS];
+	unsigned char buf[SENSOR_CORE_XFER_BYTES];
+	unsigned int nmsg;
+	unsigned int used;
+	uint16_t next_reg;
+	struct sensor_core_stats *stats;	/* NULL when not accounted */
+};
+
+static int sensor_core_raw_read(struct tx_isp_subdev *sd, uint16_t reg, unsigned char *value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	struct i2c_client *client = tx_isp_get_subdevdata(sd);
+	unsigned char buf[2] = {reg >> 8, reg & 0xff};
+	struct i2c_msg msg[2] = {
+		[0] = {
+			.addr = client->addr,
+			.flags = 0,
+			.len = core->desc->reg_bytes,
+			.buf = &buf[2 - core->desc->reg_bytes],
+		},
+		[1] = {
+			.addr = client->addr,
+			.flags = I2C_M_RD,
+			.len = 1,
+			.buf = value,
+		}
+	};
+	int ret;
+
+	ret = private_i2c_transfer(client->adapter, msg, 2);
+	if (ret > 0)
+		ret = 0;
+
+	return ret;
+}
+
+static int sensor_core_raw_write(struct tx_isp_subdev *sd, uint16_t reg, unsigned char value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	struct i2c_client *client = tx_isp_get_subdevdata(sd);
+	unsigned char buf[3] = {reg >> 8, reg & 0xff, value};
+	struct i2c_msg msg = {
+		.addr = client->addr,
+		.flags = 0,
+		.len = core->desc->reg_bytes + 1,
+		.buf = &buf[2 - core->desc->reg_bytes],
+	};
+	int ret;
+
+	ret = private_i2c_transfer(client->adapter, &msg, 1);
+	if (ret > 0)
+		ret = 0;
+
+	return ret;
+}
+
+/*
+ * Wait for an init table still being played. init_done is complete while
+ * nothing is pending; completion_done takes its lock, so init_ret is read
+ * after the worker has written it.
+ */
+static void sensor_core_init_wait(struct sensor_core *core) {
+	ktime_t start;
+
+	if (likely(completion_done(&core->init_done)))
+		return;
+
+	start = ktime_get();
+	wait_for_completion(&core->init_done);
+	core->init_wait_us = ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+/*
+ * Every access waits for the init table. A failed init table fails every
+ * access after it too, until an init plays through or the sensor is reset.
+ */
+static int sensor_core_init_sync(struct sensor_core *core) {
+	sensor_core_init_wait(core);
+
+	return core->init_ret;
+}
+
+/*
+ * Register shadow. Every register but the volatile ones is cached by its
+ * address, with the current page in the high byte on paged sensors; a
+ * write of the cached value is dropped and a cached read does no I/O.
+ * A table played in full starts it over with what the table wrote.
+ */
+void sensor_core_cache_invalidate(struct sensor_core *core) {
+	memset(core->cache, 0, sizeof(core->cache));
+	core->page = -1;
+}
+
+static struct sensor_core_cache *sensor_core_cache_slot(struct sensor_core *core, uint16_t reg,
+							 uint16_t *key) {
+	const struct sensor_core_desc *desc = core->desc;
+	unsigned int i;
+
+	for (i = 0; i < desc->nr_volatile; i++)
+		if (desc->volatile_regs[i] == reg)
+			return NULL;
+
+	if (desc->page_reg) {
+		if (core->page < 0)
+			return NULL;
+		*key = (core->page << 8) | (reg & 0xff);
+	} else {
+		*key = reg;
+	}
+
+	return &core->cache[(*key ^ (*key >> 6)) & (SENSOR_CORE_CACHE_SIZE - 1)];
+}
+
+/* Returns 0 when the register already holds value, else caches it and returns 1 */
+static int sensor_core_cache_update(struct sensor_core *core, uint16_t reg, unsigned char value) {
+	struct sensor_core_cache *slot;
+	uint16_t key;
+
+	if (core->desc->page_reg && reg == core->desc->page_reg) {
+		if (core->page == value)
+			return 0;
+		core->page = value;
+		return 1;
+	}
+
+	slot = sensor_core_cache_slot(core, reg, &key);
+	if (!slot)
+		return 1;
+	if (slot->valid && slot->key == key && slot->value == value)
+		return 0;
+	slot->key = key;
+	slot->value = value;
+	slot->valid = 1;
+
+	return 1;
+}
+
+int sensor_core_read(struct tx_isp_subdev *sd, uint16_t reg, unsigned char *value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	struct sensor_core_cache *slot = NULL;
+	uint16_t key;
+	int ret;
+
+	ret = sensor_core_init_sync(core);
+	if (ret)
+		return ret;
+
+	if (core->desc->page_reg && reg == core->desc->page_reg) {
+		if (core->page >= 0) {
+			*value = core->page;
+			core->cached_reads++;
+			return 0;
+		}
+	} else {
+		slot = sensor_core_cache_slot(core, reg, &key);
+		if (slot && slot->valid && slot->key == key) {
+			*value = slot->value;
+			core->cached_reads++;
+			return 0;
+		}
+	}
+
+	ret = sensor_core_raw_read(sd, reg, value);
+	if (ret)
+		return ret;
+	sensor_core_cache_update(core, reg, *value);
+
+	return 0;
+}
+
+int sensor_core_write(struct tx_isp_subdev *sd, uint16_t reg, unsigned char value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	int ret;
+
+	ret = sensor_core_init_sync(core);
+	if (ret)
+		return ret;
+
+	if (!sensor_core_cache_update(core, reg, value)) {
+		core->dropped_writes++;
+		return 0;
+	}
+
+	ret = sensor_core_raw_write(sd, reg, value);
+	if (ret)
+		sensor_core_cache_invalidate(core);
+
+	return ret;
+}
+
+int sensor_core_read_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
+	const struct sensor_core_desc *desc = sd_to_sensor_core(sd)->desc;
+	unsigned char val;
+	int ret;
+
+	ret = sensor_core_init_sync(sd_to_sensor_core(sd));
+	if (ret)
+		return ret;
+
+	while (vals->reg_num != desc->reg_end) {
+		if (vals->reg_num == desc->reg_delay) {
+			private_msleep(vals->value);
+		} else {
+			ret = sensor_core_raw_read(sd, vals->reg_num, &val);
+			if (ret < 0)
+				return ret;
+		}
+		vals++;
+	}
+
+	return 0;
+}
+
+static int sensor_core_xfer_flush(struct sensor_core *core, struct i2c_client *client,
+				  struct sensor_core_xfer *xfer) {
+	int ret;
+
+	if (!xfer->nmsg)
+		return 0;
+
+	ret = private_i2c_transfer(client->adapter, xfer->msg, xfer->nmsg);
+	if (xfer->stats) {
+		xfer->stats->xfers++;
+		xfer->stats->msgs += xfer->nmsg;
+	}
+	xfer->nmsg = 0;
+	xfer->used = 0;
+
+	return ret < 0 ? ret : 0;
+}
+
+static int sensor_core_xfer_add(struct sensor_core *core, struct i2c_client *client,
+				struct sensor_core_xfer *xfer, uint16_t reg, unsigned char value) {
+	const struct sensor_core_desc *desc = core->desc;
+	struct i2c_msg *msg = xfer->nmsg ? &xfer->msg[xfer->nmsg - 1] : NULL;
+	int ret;
+
+	/* the open write grows while the addresses follow on */
+	if (msg && reg == xfer->next_reg && msg->len - desc->reg_bytes < desc->burst_len
+	    && xfer->used < SENSOR_CORE_XFER_BYTES) {
+		xfer->buf[xfer->used++] = value;
+		msg->len++;
+		xfer->next_reg++;
+		return 0;
+	}
+
+	if (xfer->nmsg == SENSOR_CORE_XFER_MSGS
+	    || xfer->used + desc->reg_bytes + 1 > SENSOR_CORE_XFER_BYTES) {
+		ret = sensor_core_xfer_flush(core, client, xfer);
+		if (ret)
+			return ret;
+	}
+
+	msg = &xfer->msg[xfer->nmsg++];
+	msg->addr = client->addr;
+	msg->flags = 0;
+	msg->len = desc->reg_bytes + 1;
+	msg->buf = &xfer->buf[xfer->used];
+	if (desc->reg_bytes == 2)
+		xfer->buf[xfer->used++] = reg >> 8;
+	xfer->buf[xfer->used++] = reg & 0xff;
+	xfer->buf[xfer->used++] = value;
+	xfer->next_reg = reg + 1;
+
+	return 0;
+}
+
+static int sensor_core_play_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	const struct sensor_core_desc *desc = core->desc;
+	struct i2c_client *client = tx_isp_get_subdevdata(sd);
+	struct sensor_core_xfer xfer;
+	ktime_t start = ktime_get();
+	int ret = 0;
+
+	xfer.nmsg = 0;
+	xfer.used = 0;
+	xfer.stats = &core->last;
+	memset(&core->last, 0, sizeof(core->last));
+	core->last.tables = 1;
+	sensor_core_cache_invalidate(core);
+
+	while (vals->reg_num != desc->reg_end) {
+		if (vals->reg_num == desc->reg_delay) {
+			ret = sensor_core_xfer_flush(core, client, &xfer);
+			if (ret)
+				break;
+			private_msleep(vals->value);
+		} else {
+			ret = sensor_core_xfer_add(core, client, &xfer, vals->reg_num, vals->value);
+			if (ret)
+				break;
+			/* every register is written, the shadow learns what it holds */
+			sensor_core_cache_update(core, vals->reg_num, vals->value);
+			core->last.regs++;
+		}
+		vals++;
+	}
+	if (!ret)
+		ret = sensor_core_xfer_flush(core, client, &xfer);
+	if (ret)
+		sensor_core_cache_invalidate(core);
+
+	core->last.us = ktime_to_us(ktime_sub(ktime_get(), start));
+	core->total.tables++;
+	core->total.regs += core->last.regs;
+	core->total.xfers += core->last.xfers;
+	core->total.msgs += core->last.msgs;
+	core->total.us += core->last.us;
+	pr_debug("%s: %u regs in %u transfers (%u msgs), %u us\n", desc->name,
+		 core->last.regs, core->last.xfers, core->last.msgs, core->last.us);
+
+	return ret;
+}
+
+int sensor_core_write_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
+	int ret;
+
+	ret = sensor_core_init_sync(sd_to_sensor_core(sd));
+	if (ret)
+		return ret;
+
+	return sensor_core_play_array(sd, vals);
+}
+
+static void sensor_core_init_work(struct work_struct *work) {
+	struct sensor_core *core = container_of(work, struct sensor_core, init_work);
+	ktime_t start = ktime_get();
+
+	core->init_queue_us = ktime_to_us(ktime_sub(start, core->init_start));
+	core->init_ret = sensor_core_play_array(&core->sensor.sd, core->init_vals);
+	core->init_play_us = ktime_to_us(ktime_sub(ktime_get(), start));
+	if (core->init_ret)
+		ISP_ERROR("err: %s init table failed %d\n", core->desc->name, core->init_ret);
+	pr_debug("%s: init table queued %u us, played in %u us\n", core->desc->name,
+		 core->init_queue_us, core->init_play_us);
+
+	complete_all(&core->init_done);
+}
+
+/*
+ * Play an init table on the sensor's worker and return at once, so the
+ * isp can go on with its own setup. The next access to the sensor, at
+ * the latest the stream on, waits for the table to be written.
+ */
+int sensor_core_init_async(struct tx_isp_subdev *sd, struct regval_list *vals) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+
+	sensor_core_init_wait(core);
+	if (!core->init_wq) {
+		core->init_ret = sensor_core_play_array(sd, vals);
+		return core->init_ret;
+	}
+
+	reinit_completion(&core->init_done);
+	core->init_vals = vals;
+	core->init_ret = 0;
+	core->init_wait_us = 0;
+	core->init_start = ktime_get();
+	queue_work(core->init_wq, &core->init_work);
+
+	return 0;
+}
+
+static int sensor_core_xfer_add_table(struct sensor_core *core, struct i2c_client *client,
+				      struct sensor_core_xfer *xfer, struct regval_list *vals) {
+	int ret;
+
+	for (; vals && vals->reg_num != core->desc->reg_end; vals++) {
+		ret = sensor_core_xfer_add(core, client, xfer, vals->reg_num, vals->value);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Write the per frame registers as one unit: they are wrapped in the group
+ * hold of the sensor, when it has one, and go out in a single transfer so
+ * the sensor latches them together at the next frame start.
+ */
+int sensor_core_write_group(struct tx_isp_subdev *sd, struct regval_list *vals, unsigned int count) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	struct i2c_client *client = tx_isp_get_subdevdata(sd);
+	struct sensor_core_xfer xfer;
+	unsigned int changed = 0;
+	unsigned int i;
+	int ret;
+
+	ret = sensor_core_init_sync(core);
+	if (ret)
+		return ret;
+
+	xfer.nmsg = 0;
+	xfer.used = 0;
+	xfer.stats = NULL;
+
+	ret = sensor_core_xfer_add_table(core, client, &xfer, core->desc->hold_on);
+	for (i = 0; !ret && i < count; i++) {
+		if (!sensor_core_cache_update(core, vals[i].reg_num, vals[i].value)) {
+			core->dropped_writes++;
+			continue;
+		}
+		ret = sensor_core_xfer_add(core, client, &xfer, vals[i].reg_num, vals[i].value);
+		changed++;
+	}
+	if (!changed)
+		return ret;
+	if (!ret)
+		ret = sensor_core_xfer_add_table(core, client, &xfer, core->desc->hold_off);
+	if (!ret)
+		ret = sensor_core_xfer_flush(core, client, &xfer);
+	if (ret)
+		sensor_core_cache_invalidate(core);
+
+	return ret;
+}
+
+/*
+ * Write the registers of a table that don't already hold their value, in
+ * one transfer. A table that repeats the end of the init table just played
+ * writes nothing.
+ */
+static int sensor_core_update_array(struct sensor_core *core, struct regval_list *vals) {
+	const struct sensor_core_desc *desc = core->desc;
+	struct i2c_client *client = tx_isp_get_subdevdata(&core->sensor.sd);
+	struct sensor_core_xfer xfer;
+	int ret;
+
+	ret = sensor_core_init_sync(core);
+	if (ret)
+		return ret;
+
+	xfer.nmsg = 0;
+	xfer.used = 0;
+	xfer.stats = NULL;
+
+	for (; !ret && vals->reg_num != desc->reg_end; vals++) {
+		if (vals->reg_num == desc->reg_delay) {
+			ret = sensor_core_xfer_flush(core, client, &xfer);
+			if (!ret)
+				private_msleep(vals->value);
+		} else if (sensor_core_cache_update(core, vals->reg_num, vals->value)) {
+			ret = sensor_core_xfer_add(core, client, &xfer, vals->reg_num, vals->value);
+		} else {
+			core->dropped_writes++;
+		}
+	}
+	if (!ret)
+		ret = sensor_core_xfer_flush(core, client, &xfer);
+	if (ret)
+		sensor_core_cache_invalidate(core);
+
+	return ret;
+}
+
+int sensor_core_fps_check(int fps, unsigned int min_fps, unsigned int max_fps) {
+	unsigned int newformat; //the format is 24.8
+
+	newformat = (((fps >> 16) / (fps & 0xffff)) << 8) + ((((fps >> 16) % (fps & 0xffff)) << 8) / (fps & 0xffff));
+	if (newformat > (max_fps << 8) || newformat < (min_fps << 8)) {
+		ISP_ERROR("warn: fps(%x) not in range\n", fps);
+		return -1;
+	}
+
+	return 0;
+}
+
+unsigned int sensor_core_fps_to_vts(unsigned int sclk, unsigned int hts, int fps) {
+	return sclk * (fps & 0xffff) / hts / ((fps & 0xffff0000) >> 16);
+}
+
+#define SENSOR_CORE_GAIN(lut, i) (*(const unsigned int *) ((const char *) (lut) + (i) * stride + offset))
+
+/*
+ * Binary search version of the again_lut walk of the drivers: the entry
+ * with the largest gain not above isp_gain among those up to max_gain,
+ * the max_gain entry itself for larger gains. The table must be sorted.
+ * Returns -1 when the walk would not find an entry either.
+ */
+int sensor_core_gain_index(const void *lut, unsigned int n, size_t stride, size_t offset,
+			   unsigned int max_gain, unsigned int isp_gain) {
+	unsigned int lo, hi, mid, end;
+
+	if (isp_gain == 0)
+		return 0;
+
+	/* entries past the first gain above max_gain are never looked at */
+	lo = 0;
+	hi = n;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (SENSOR_CORE_GAIN(lut, mid) <= max_gain)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	end = lo;
+
+	/* the first entry above isp_gain, the answer is the one before it */
+	lo = 0;
+	hi = end;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (SENSOR_CORE_GAIN(lut, mid) <= isp_gain)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < end)
+		return lo ? lo - 1 : 0;
+
+	/* isp_gain is above every entry, clamp to the first max_gain entry */
+	if (!end || SENSOR_CORE_GAIN(lut, end - 1) != max_gain)
+		return -1;
+	for (lo = end - 1; lo && SENSOR_CORE_GAIN(lut, lo - 1) == max_gain; lo--)
+		;
+
+	return lo;
+}
+
+/* The frame length of fps in the active mode, 0 when fps is out of range */
+unsigned int sensor_core_fps_vts(struct tx_isp_subdev *sd, int fps) {
+	struct sensor_core_timing *timing = &sd_to_sensor_core(sd)->timing;
+
+	if (!timing->hts) {
+		ISP_ERROR("err: %s has no line timing\n", sd_to_sensor_core(sd)->desc->name);
+		return 0;
+	}
+	if (sensor_core_fps_check(fps, timing->min_fps, timing->max_fps))
+		return 0;
+
+	return sensor_core_fps_to_vts(timing->sclk, timing->hts, fps);
+}
+
+/* Publish a new frame length, the isp is only synced when something changed */
+int sensor_core_sync_vts(struct tx_isp_subdev *sd, int fps, unsigned int vts) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	struct tx_isp_sensor *sensor = &core->sensor;
+	unsigned int margin = core->timing.margin;
+
+	if (!core->resync && sensor->video.fps == fps && sensor->video.attr->total_height == vts &&
+	    sensor->video.attr->max_integration_time == vts - margin) {
+		core->skipped_syncs++;
+		return 0;
+	}
+
+	sensor->video.fps = fps;
+	sensor->video.attr->max_integration_time_native = vts - margin;
+	sensor->video.attr->integration_time_limit = vts - margin;
+	sensor->video.attr->total_height = vts;
+	sensor->video.attr->max_integration_time = vts - margin;
+	core->resync = 0;
+
+	return tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
+}
+
+void sensor_core_set_video(struct tx_isp_sensor *sensor, struct tx_isp_sensor_win_setting *wsize) {
+	sensor->video.mbus.width = wsize->width;
+	sensor->video.mbus.height = wsize->height;
+	sensor->video.mbus.code = wsize->mbus_code;
+	sensor->video.mbus.field = V4L2_FIELD_NONE;
+	sensor->video.mbus.colorspace = wsize->colorspace;
+	sensor->video.fps = wsize->fps;
+}
+
+static struct regval_list *sensor_core_stream_vals(struct sensor_core *core, int enable) {
+	const struct sensor_core_desc *desc = core->desc;
+
+	if (core->data_interface == TX_SENSOR_DATA_INTERFACE_DVP)
+		return enable ? desc->stream_on_dvp : desc->stream_off_dvp;
+	if (core->data_interface == TX_SENSOR_DATA_INTERFACE_MIPI)
+		return enable ? desc->stream_on_mipi : desc->stream_off_mipi;
+
+	return NULL;
+}
+
+/* Play the stream on/off table of the current data interface, through the shadow */
+int sensor_core_stream(struct tx_isp_subdev *sd, int enable) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	struct regval_list *vals = sensor_core_stream_vals(core, enable);
+	int ret;
+
+	if (!vals) {
+		ISP_ERROR("Don't support this Sensor Data interface\n");
+		return -1;
+	}
+
+	ret = sensor_core_update_array(core, vals);
+	if (!ret)
+		core->streaming = enable;
+
+	return ret;
+}
+
+int sensor_core_s_stream(struct tx_isp_subdev *sd, int enable) {
+	int ret;
+
+	ret = sensor_core_stream(sd, enable);
+	ISP_WARNING("%s stream %s\n", sd_to_sensor_core(sd)->desc->name, enable ? "on" : "off");
+
+	return ret;
+}
+
+/*
+ * Move the sensor to another mode of the same interface. Only the delta
+ * between the two init tables is written when the driver has one, the
+ * whole new table otherwise, with the stream stopped meanwhile. A sensor
+ * whose stream off table writes nothing can not be stopped, it is not
+ * switched while streaming.
+ */
+int sensor_core_switch_mode(struct tx_isp_subdev *sd, struct tx_isp_sensor_win_setting *wsize) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	const struct sensor_core_desc *desc = core->desc;
+	struct regval_list *vals = wsize->regs;
+	int streaming = core->streaming;
+	unsigned int i;
+	int ret = 0;
+
+	if (core->wsize == wsize)
+		return 0;
+
+	if (streaming) {
+		struct regval_list *off = sensor_core_stream_vals(core, 0);
+
+		if (!off || off->reg_num == desc->reg_end) {
+			ISP_ERROR("err: %s can not stop its stream to switch mode\n", desc->name);
+			return -EBUSY;
+		}
+	}
+
+	for (i = 0; i < desc->nr_deltas; i++) {
+		if (desc->deltas[i].from == core->wsize->regs && desc->deltas[i].to == wsize->regs) {
+			vals = desc->deltas[i].delta;
+			break;
+		}
+	}
+
+	if (streaming)
+		ret = sensor_core_stream(sd, 0);
+	if (!ret)
+		ret = sensor_core_write_array(sd, vals);
+	if (!ret && streaming)
+		ret = sensor_core_stream(sd, 1);
+	if (ret) {
+		ISP_ERROR("err: %s mode switch failed\n", desc->name);
+		return ret;
+	}
+
+	pr_debug("%s: switched to %dx%d with %s table\n", desc->name, wsize->width, wsize->height,
+		 vals == wsize->regs ? "the full" : "a delta");
+	core->wsize = wsize;
+	core->resync = 1;
+	sensor_core_set_video(&core->sensor, wsize);
+
+	return 0;
+}
+
+int sensor_core_detect(struct tx_isp_subdev *sd, unsigned int *ident) {
+	const struct sensor_core_desc *desc = sd_to_sensor_core(sd)->desc;
+	unsigned char v;
+	int ret;
+	int i;
+
+	*ident = 0;
+	for (i = 0; i < 2; i++) {
+		ret = sensor_core_read(sd, desc->id_reg[i], &v);
+		ISP_WARNING("-----%s: %d ret = %d, v = 0x%02x\n", __func__, __LINE__, ret, v);
+		if (ret < 0)
+			return ret;
+		if (v != desc->id_val[i])
+			return -ENODEV;
+		*ident = (*ident << 8) | v;
+	}
+
+	return 0;
+}
+
+static void sensor_core_gpio_seq(int gpio, const char *label, const struct sensor_gpio_step *step) {
+	if (gpio == -1 || !step)
+		return;
+
+	if (private_gpio_request(gpio, label)) {
+		ISP_ERROR("gpio request fail %d\n", gpio);
+		return;
+	}
+
+	for (; step->level >= 0; step++) {
+		private_gpio_direction_output(gpio, step->level);
+		private_msleep(step->delay_ms);
+	}
+}
+
+int sensor_core_g_chip_ident(struct tx_isp_subdev *sd, struct tx_isp_chip_ident *chip) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	const struct sensor_core_desc *desc = core->desc;
+	struct i2c_client *client = tx_isp_get_subdevdata(sd);
+	unsigned int ident = 0;
+	int ret;
+
+	/* the reset is how a sensor recovers from a failed init table */
+	sensor_core_init_wait(core);
+	sensor_core_cache_invalidate(core);
+	core->streaming = 0;
+	sensor_core_gpio_seq(core->reset_gpio, "sensor_reset", desc->reset_seq);
+	sensor_core_gpio_seq(core->pwdn_gpio, "sensor_pwdn", desc->pwdn_seq);
+	/* the reset has dropped the registers a failed init table left */
+	core->init_ret = 0;
+
+	ret = sensor_core_detect(sd, &ident);
+	if (ret) {
+		ISP_ERROR("chip found @ 0x%x (%s) is not an %s chip.\n",
+			  client->addr, client->adapter->name, desc->name);
+		return ret;
+	}
+	ISP_WARNING("%s chip found @ 0x%02x (%s)\n",
+		    desc->name, client->addr, client->adapter->name);
+	ISP_WARNING("sensor driver version %s\n", desc->version);
+	if (chip) {
+		strlcpy(chip->name, desc->name, sizeof(chip->name));
+		chip->ident = ident;
+		chip->revision = (char *) desc->version;
+	}
+
+	return 0;
+}
+
+int sensor_core_g_register(struct tx_isp_subdev *sd, struct tx_isp_dbg_register *reg) {
+	unsigned char val = 0;
+	int len = 0;
+	int ret = 0;
+
+	len = strlen(sd->chip.name);
+	if (len && strncmp(sd->chip.name, reg->name, len)) {
+		return -EINVAL;
+	}
+	if (!private_capable(CAP_SYS_ADMIN))
+		return -EPERM;
+	/* the debug access goes around a failed init table, not a pending one */
+	sensor_core_init_wait(sd_to_sensor_core(sd));
+	ret = sensor_core_raw_read(sd, reg->reg & 0xffff, &val);
+	reg->val = val;
+	reg->size = 2;
+
+	return ret;
+}
+
+int sensor_core_s_register(struct tx_isp_subdev *sd, const struct tx_isp_dbg_register *reg) {
+	int len = 0;
+	int ret;
+
+	len = strlen(sd->chip.name);
+	if (len && strncmp(sd->chip.name, reg->name, len)) {
+		return -EINVAL;
+	}
+	if (!private_capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	/* as g_register */
+	sensor_core_init_wait(sd_to_sensor_core(sd));
+	sensor_core_cache_invalidate(sd_to_sensor_core(sd));
+	ret = sensor_core_raw_write(sd, reg->reg & 0xffff, reg->val & 0xff);
+
+	return ret;
+}
+
+static int sensor_core_stats_show(struct seq_file *m, void *v) {
+	struct sensor_core *core = m->private;
+	const struct sensor_core_stats *st[2] = {&core->last, &core->total};
+	const char *name[2] = {"last", "total"};
+	int i;
+
+	seq_printf(m, "%-8s%8s%8s%8s%8s%10s\n", "", "tables", "regs", "xfers", "msgs", "us");
+	for (i = 0; i < 2; i++)
+		seq_printf(m, "%-8s%8u%8u%8u%8u%10u\n", name[i], st[i]->tables,
+			   st[i]->regs, st[i]->xfers, st[i]->msgs, st[i]->us);
+	seq_printf(m, "cache: %u writes dropped, %u reads served\n",
+		   core->dropped_writes, core->cached_reads);
+	seq_printf(m, "attr: %u syncs skipped\n", core->skipped_syncs);
+	seq_printf(m, "init: %u us queued, %u us played, %u us waited\n",
+		   core->init_queue_us, core->init_play_us, core->init_wait_us);
+
+	return 0;
+}
+
+static int sensor_core_stats_open(struct inode *inode, struct file *file) {
+	return single_open(file, sensor_core_stats_show, PDE_DATA(inode));
+}
+
+static const struct file_operations sensor_core_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = sensor_core_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Allocate the device and start its input clock, the gpios default to
+ * unused. A mclk_rate of 0 leaves the clock to the driver, the t40/t41
+ * drivers take it from the register info of the sensor.
+ */
+struct sensor_core *sensor_core_alloc(const struct sensor_core_desc *desc, unsigned long mclk_rate) {
+	const char *mclk_name;
+	struct sensor_core *core;
+
+	core = kzalloc(sizeof(*core), GFP_KERNEL);
+	if (!core) {
+		ISP_ERROR("Failed to allocate sensor subdev.\n");
+		return NULL;
+	}
+	for (core->id = 0; core->id < SENSOR_CORE_MAX_INSTANCES; core->id++)
+		if (!test_and_set_bit(core->id, &sensor_core_ids))
+			break;
+	if (core->id == SENSOR_CORE_MAX_INSTANCES) {
+		ISP_ERROR("Too many %s sensors.\n", desc->name);
+		kfree(core);
+		return NULL;
+	}
+	core->desc = desc;
+	core->page = -1;
+	core->reset_gpio = -1;
+	core->pwdn_gpio = -1;
+	INIT_WORK(&core->init_work, sensor_core_init_work);
+	init_completion(&core->init_done);
+	complete_all(&core->init_done);
+	/* without a worker the init tables are played synchronously */
+	core->init_wq = alloc_ordered_workqueue("%s-init", 0, desc->name);
+	if (!mclk_rate)
+		return core;
+
+	mclk_name = desc->mclk_name ? desc->mclk_name : "cgu_cim";
+	core->sensor.mclk = clk_get(NULL, mclk_name);
+	if (IS_ERR(core->sensor.mclk)) {
+		ISP_ERROR("Cannot get sensor input clock %s\n", mclk_name);
+		if (core->init_wq)
+			destroy_workqueue(core->init_wq);
+		clear_bit(core->id, &sensor_core_ids);
+		kfree(core);
+		return NULL;
+	}
+	private_clk_set_rate(core->sensor.mclk, mclk_rate);
+	private_clk_prepare_enable(core->sensor.mclk);
+
+	return core;
+}
+
+void sensor_core_register(struct sensor_core *core, struct platform_device *pdev,
+			  struct tx_isp_subdev_ops *ops, struct i2c_client *client) {
+	struct tx_isp_subdev *sd = &core->sensor.sd;
+
+	/* the first sensor keeps the names of the single sensor drivers */
+	core->pdev = *pdev;
+	if (core->id) {
+		core->pdev.id = core->id;
+		snprintf(core->proc_name, sizeof(core->proc_name), "jz/sensor/i2c_stats%d", core->id);
+	} else {
+		strcpy(core->proc_name, "jz/sensor/i2c_stats");
+	}
+
+	tx_isp_subdev_init(&core->pdev, sd, ops);
+	tx_isp_set_subdevdata(sd, client);
+	tx_isp_set_subdev_hostdata(sd, &core->sensor);
+	private_i2c_set_clientdata(client, sd);
+	proc_create_data(core->proc_name, 0444, NULL, &sensor_core_stats_fops, core);
+
+	pr_debug("probe ok ------->%s\n", core->desc->name);
+}
+
+void sensor_core_free(struct sensor_core *core) {
+	if (core->init_wq)
+		destroy_workqueue(core->init_wq);
+	if (core->sensor.mclk) {
+		private_clk_disable_unprepare(core->sensor.mclk);
+		private_clk_put(core->sensor.mclk);
+	}
+	clear_bit(core->id, &sensor_core_ids);
+	kfree(core);
+}
+
+int sensor_core_remove(struct i2c_client *client) {
+	struct tx_isp_subdev *sd = private_i2c_get_clientdata(client);
+	struct sensor_core *core = sd_to_sensor_core(sd);
+
+	if (core->reset_gpio != -1)
+		private_gpio_free(core->reset_gpio);
+	if (core->pwdn_gpio != -1)
+		private_gpio_free(core->pwdn_gpio);
+
+	remove_proc_entry(core->proc_name, NULL);
+	tx_isp_subdev_deinit(sd);
+	sensor_core_free(core);
+
+	return 0;
+}
@@ -20,40 +20,37 @@
 #include <tx-isp-common.h>
 #include <sensor-common.h>
 #include <sensor-info.h>
+#include <sensor-core.h>
 
 #define SENSOR_NAME "sc2336"
 #define SENSOR_CHIP_ID_H (0xcb)
 #define SENSOR_CHIP_ID_L (0x3a)
 #define SENSOR_REG_END 0xffff
 #define SENSOR_REG_DELAY 0xfffe
+#define SENSOR_SUPPORT_SCLK (0x8ca * 0x5a0 * 25)
 #define SENSOR_OUTPUT_MAX_FPS 25
 #define SENSOR_OUTPUT_MIN_FPS 5
 #define SENSOR_VERSION "H20231116a"
 
-static int reset_gpio = GPIO_PA(17);
-module_param(reset_gpio, int, S_IRUGO);
-MODULE_PARM_DESC(reset_gpio, "Reset GPIO NUM");
+static int reset_gpio[SENSOR_CORE_MAX_INSTANCES] = {GPIO_PA(17), -1};
+module_param_array(reset_gpio, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(reset_gpio, "Reset GPIO NUM, one per sensor");
 
-static int pwdn_gpio = -1;
-module_param(pwdn_gpio, int, S_IRUGO);
-MODULE_PARM_DESC(pwdn_gpio, "Power down GPIO NUM");
+static int pwdn_gpio[SENSOR_CORE_MAX_INSTANCES] = {-1, -1};
+module_param_array(pwdn_gpio, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(pwdn_gpio, "Power down GPIO NUM, one per sensor");
 
-static int data_interface = TX_SENSOR_DATA_INTERFACE_MIPI;
-module_param(data_interface, int, S_IRUGO);
-MODULE_PARM_DESC(data_interface, "Sensor Date interface");
+static int data_interface[SENSOR_CORE_MAX_INSTANCES] = {TX_SENSOR_DATA_INTERFACE_MIPI, TX_SENSOR_DATA_INTERFACE_MIPI};
+module_param_array(data_interface, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(data_interface, "Sensor Date interface, one per sensor");
 
-static int shvflip = 1;
-module_param(shvflip, int, S_IRUGO);
-MODULE_PARM_DESC(shvflip, "Sensor HV Flip Enable interface");
+static int shvflip[SENSOR_CORE_MAX_INSTANCES] = {1, 1};
+module_param_array(shvflip, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(shvflip, "Sensor HV Flip Enable interface, one per sensor");
 
 
 //static unsigned int expo_val = 0x031f0320;
 
-struct regval_list {
-	uint16_t reg_num;
-	unsigned char value;
-};
-
 struct again_lut {
 	unsigned int value;
 	unsigned int gain;
@@ -226,25 +223,12 @@ struct again_lut sensor_again_lut[] = {
 struct tx_isp_sensor_attribute sensor_attr;
 
 unsigned int sensor_alloc_again(unsigned int isp_gain, unsigned char shift, unsigned int *sensor_again) {
-	struct again_lut *lut = sensor_again_lut;
-	while (lut->gain <= sensor_attr.max_again) {
-		if (isp_gain == 0) {
-			*sensor_again = lut[0].value;
-			return lut[0].gain;
-		} else if (isp_gain < lut->gain) {
-			*sensor_again = (lut - 1)->value;
-			return (lut - 1)->gain;
-		} else {
-			if ((lut->gain == sensor_attr.max_again) && (isp_gain >= lut->gain)) {
-				*sensor_again = lut->value;
-				return lut->gain;
-			}
-		}
+	int i = sensor_core_again_index(sensor_again_lut, sensor_attr.max_again, isp_gain);
 
-		lut++;
-	}
-
-	return isp_gain;
+	if (i < 0)
+		return isp_gain;
+	*sensor_again = sensor_again_lut[i].value;
+	return sensor_again_lut[i].gain;
 }
 
 unsigned int sensor_alloc_dgain(unsigned int isp_gain, unsigned char shift, unsigned int *sensor_dgain) {
@@ -471,7 +455,6 @@ static struct tx_isp_sensor_win_setting sensor_win_sizes[] = {
 		.regs = sensor_init_regs_1920_1080_30fps_mipi,
 	},
 };
-struct tx_isp_sensor_win_setting *wsize = &sensor_win_sizes[0];
 
 static struct regval_list sensor_stream_on_mipi[] = {
 	//{0x0100, 0x01},
@@ -483,126 +466,53 @@ static struct regval_list sensor_stream_off_mipi[] = {
 	{SENSOR_REG_END, 0x00},
 };
 
-int sensor_read(struct tx_isp_subdev *sd, uint16_t reg,
-		unsigned char *value) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	uint8_t buf[2] = {(reg >> 8) & 0xff, reg & 0xff};
-	struct i2c_msg msg[2] = {
-		[0] = {
-			.addr = client->addr,
-			.flags = 0,
-			.len = 2,
-			.buf = buf,
-		},
-		[1] = {
-			.addr = client->addr,
-			.flags = I2C_M_RD,
-			.len = 1,
-			.buf = value,
-		}
-	};
-	int ret;
-	ret = private_i2c_transfer(client->adapter, msg, 2);
-	if (ret > 0)
-		ret = 0;
-
-	return ret;
-}
-
-int sensor_write(struct tx_isp_subdev *sd, uint16_t reg,
-		 unsigned char value) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	uint8_t buf[3] = {(reg >> 8) & 0xff, reg & 0xff, value};
-	struct i2c_msg msg = {
-		.addr = client->addr,
-		.flags = 0,
-		.len = 3,
-		.buf = buf,
-	};
-	int ret;
-	ret = private_i2c_transfer(client->adapter, &msg, 1);
-	if (ret > 0)
-		ret = 0;
-
-	return ret;
-}
-
-#if 0
-static int sensor_read_array(struct tx_isp_subdev *sd, struct regval_list *vals)
-{
-	int ret;
-	unsigned char val;
-	while (vals->reg_num != SENSOR_REG_END) {
-		if (vals->reg_num == SENSOR_REG_DELAY) {
-			msleep(vals->value);
-		} else {
-			ret = sensor_read(sd, vals->reg_num, &val);
-			if (ret < 0)
-				return ret;
-		}
-		vals++;
-	}
-
-	return 0;
-}
-#endif
+static const struct sensor_gpio_step sensor_reset_seq[] = {
+	{1, 10}, {0, 10}, {1, 10},
+	SENSOR_GPIO_SEQ_END,
+};
 
-static int sensor_write_array(struct tx_isp_subdev *sd, struct regval_list *vals) {
-	int ret;
-	while (vals->reg_num != SENSOR_REG_END) {
-		if (vals->reg_num == SENSOR_REG_DELAY) {
-			msleep(vals->value);
-		} else {
-			ret = sensor_write(sd, vals->reg_num, vals->value);
-			if (ret < 0)
-				return ret;
-		}
-		vals++;
-	}
+static const struct sensor_gpio_step sensor_pwdn_seq[] = {
+	{0, 10}, {1, 10},
+	SENSOR_GPIO_SEQ_END,
+};
 
-	return 0;
-}
+static const struct sensor_core_desc sensor_desc = {
+	.name = SENSOR_NAME,
+	.version = SENSOR_VERSION,
+	.reg_bytes = 2,
+	.burst_len = 32,
+	.reg_end = SENSOR_REG_END,
+	.reg_delay = SENSOR_REG_DELAY,
+	.id_reg = {0x3107, 0x3108},
+	.id_val = {SENSOR_CHIP_ID_H, SENSOR_CHIP_ID_L},
+	.reset_seq = sensor_reset_seq,
+	.pwdn_seq = sensor_pwdn_seq,
+	.stream_on_mipi = sensor_stream_on_mipi,
+	.stream_off_mipi = sensor_stream_off_mipi,
+};
 
 static int sensor_reset(struct tx_isp_subdev *sd, struct tx_isp_initarg *init) {
 	return 0;
 }
 
-static int sensor_detect(struct tx_isp_subdev *sd, unsigned int *ident) {
-	int ret;
-	unsigned char v;
-
-	ret = sensor_read(sd, 0x3107, &v);
-	ISP_WARNING("-----%s: %d ret = %d, v = 0x%02x\n", __func__, __LINE__, ret, v);
-	if (ret < 0)
-		return ret;
-	if (v != SENSOR_CHIP_ID_H)
-		return -ENODEV;
-	*ident = v;
-
-	ret = sensor_read(sd, 0x3108, &v);
-	ISP_WARNING("-----%s: %d ret = %d, v = 0x%02x\n", __func__, __LINE__, ret, v);
-	if (ret < 0)
-		return ret;
-	if (v != SENSOR_CHIP_ID_L)
-		return -ENODEV;
-	*ident = (*ident << 8) | v;
-
-	return 0;
-}
-
 static int sensor_set_expo(struct tx_isp_subdev *sd, int value) {
-	int ret = -1;
+	struct sensor_core *core = sd_to_sensor_core(sd);
+	int ret = 0;
 	int it = (value & 0xffff) * 2;
 	int again = (value & 0xffff0000) >> 16;
+	struct regval_list regs[] = {
+		{0x3e00, (unsigned char) ((it >> 12) & 0xf)},
+		{0x3e01, (unsigned char) ((it >> 4) & 0xff)},
+		{0x3e02, (unsigned char) ((it & 0x0f) << 4)},
+		{0x3e07, (unsigned char) (again & 0xff)},
+		{0x3e09, (unsigned char) (((again >> 8) & 0xff))},
+	};
 
-	ret += sensor_write(sd, 0x3e00, (unsigned char) ((it >> 12) & 0xf));
-	ret += sensor_write(sd, 0x3e01, (unsigned char) ((it >> 4) & 0xff));
-	ret += sensor_write(sd, 0x3e02, (unsigned char) ((it & 0x0f) << 4));
-	ret = sensor_write(sd, 0x3e07, (unsigned char) (again & 0xff));
-	ret += sensor_write(sd, 0x3e09, (unsigned char) (((again >> 8) & 0xff)));
-
-	//expo_val = value;
+	ret = sensor_core_write_group(sd, regs, ARRAY_SIZE(regs));
+	if (ret < 0)
+		return ret;
 
+	core->again = again;
 	return 0;
 }
 
@@ -612,9 +522,9 @@ static int sensor_set_integration_time(struct tx_isp_subdev *sd, int value)
        int ret = 0;
 
        value *= 2;
-       ret = sensor_write(sd, 0x3e00, (unsigned char)((value >> 12) & 0x0f));
-       ret += sensor_write(sd, 0x3e01, (unsigned char)((value >> 4) & 0xff));
-       ret += sensor_write(sd, 0x3e02, (unsigned char)((value & 0x0f) << 4));
+       ret = sensor_core_write(sd, 0x3e00, (unsigned char)((value >> 12) & 0x0f));
+       ret += sensor_core_write(sd, 0x3e01, (unsigned char)((value >> 4) & 0xff));
+       ret += sensor_core_write(sd, 0x3e02, (unsigned char)((value & 0x0f) << 4));
        if (ret < 0)
 	       return ret;
 
@@ -625,8 +535,8 @@ static int sensor_set_analog_gain(struct tx_isp_subdev *sd, int value)
 {
        int ret = 0;
 
-       ret += sensor_write(sd, 0x3e09, (unsigned char)(value & 0xff));
-       ret += sensor_write(sd, 0x3e08, (unsigned char)((value & 0xff00) >> 8));
+       ret += sensor_core_write(sd, 0x3e09, (unsigned char)(value & 0xff));
+       ret += sensor_core_write(sd, 0x3e08, (unsigned char)((value & 0xff00) >> 8));
        if (ret < 0)
 	       return ret;
 
@@ -642,54 +552,51 @@ static int sensor_get_black_pedestal(struct tx_isp_subdev *sd, int value) {
 	return 0;
 }
 
-static int sensor_set_attr(struct tx_isp_subdev *sd, struct tx_isp_sensor_win_setting *wise) {
+static int sensor_set_attr(struct tx_isp_subdev *sd, struct tx_isp_sensor_win_setting *wsize) {
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 
 	sensor->video.vi_max_width = wsize->width;
 	sensor->video.vi_max_height = wsize->height;
-	sensor->video.mbus.width = wsize->width;
-	sensor->video.mbus.height = wsize->height;
-	sensor->video.mbus.code = wsize->mbus_code;
-	sensor->video.mbus.field = TISP_FIELD_NONE;
-	sensor->video.mbus.colorspace = wsize->colorspace;
-	sensor->video.fps = wsize->fps;
+	sensor_core_set_video(sensor, wsize);
 
 	return 0;
 }
 
 static int sensor_init(struct tx_isp_subdev *sd, struct tx_isp_initarg *init) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = 0;
 
 	if (!init->enable)
 		return ISP_SUCCESS;
 
-	sensor_set_attr(sd, wsize);
+	sensor_set_attr(sd, core->wsize);
 	sensor->video.state = TX_ISP_MODULE_INIT;
 	ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
-	sensor->priv = wsize;
+	sensor->priv = core->wsize;
 
 	return 0;
 }
 
 static int sensor_s_stream(struct tx_isp_subdev *sd, struct tx_isp_initarg *init) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = 0;
 
 	if (init->enable) {
+		/* the t41 isp starts the sensor at the first stream on */
 		if (sensor->video.state == TX_ISP_MODULE_INIT) {
-			ret = sensor_write_array(sd, wsize->regs);
+			ret = sensor_core_write_array(sd, core->wsize->regs);
 			if (ret)
 				return ret;
 			sensor->video.state = TX_ISP_MODULE_RUNNING;
 		}
 		if (sensor->video.state == TX_ISP_MODULE_RUNNING) {
-
-			ret = sensor_write_array(sd, sensor_stream_on_mipi);
+			ret = sensor_core_stream(sd, 1);
 			ISP_WARNING("%s stream on\n", SENSOR_NAME);
 		}
 	} else {
-		ret = sensor_write_array(sd, sensor_stream_off_mipi);
+		ret = sensor_core_stream(sd, 0);
 		ISP_WARNING("%s stream off\n", SENSOR_NAME);
 	}
 
@@ -697,54 +604,32 @@ static int sensor_s_stream(struct tx_isp_subdev *sd, struct tx_isp_initarg *init
 }
 
 static int sensor_set_fps(struct tx_isp_subdev *sd, int fps) {
-	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
-	unsigned int sclk = 0;
-	unsigned int hts = 0;
+	struct regval_list regs[2];
 	unsigned int vts = 0;
-	unsigned char val = 0;
-	unsigned int newformat = 0; //the format is 24.8
 	int ret = 0;
 
-	sclk = 0x8ca * 0x5a0 * 25;
-
-	newformat = (((fps >> 16) / (fps & 0xffff)) << 8) + ((((fps >> 16) % (fps & 0xffff)) << 8) / (fps & 0xffff));
-	if (newformat > (SENSOR_OUTPUT_MAX_FPS << 8) || newformat < (SENSOR_OUTPUT_MIN_FPS << 8)) {
-		ISP_ERROR("warn: fps(%x) not in range\n", fps);
+	vts = sensor_core_fps_vts(sd, fps);
+	if (!vts)
 		return -1;
-	}
 
-	ret += sensor_read(sd, 0x320c, &val);
-	hts = val << 8;
-	ret += sensor_read(sd, 0x320d, &val);
-	hts = (hts | val);
-	if (0 != ret) {
-		ISP_ERROR("Error: %s read error\n", SENSOR_NAME);
-		return -1;
-	}
-
-	vts = sclk * (fps & 0xffff) / hts / ((fps & 0xffff0000) >> 16);
-	ret = sensor_write(sd, 0x320f, (unsigned char) (vts & 0xff));
-	ret += sensor_write(sd, 0x320e, (unsigned char) (vts >> 8));
-	if (0 != ret) {
+	regs[0] = (struct regval_list) {0x320f, (unsigned char) (vts & 0xff)};
+	regs[1] = (struct regval_list) {0x320e, (unsigned char) (vts >> 8)};
+	ret = sensor_core_write_group(sd, regs, ARRAY_SIZE(regs));
+	if (ret < 0) {
 		ISP_ERROR("Error: %s write error\n", SENSOR_NAME);
 		return ret;
 	}
-	sensor->video.fps = fps;
-	sensor->video.attr->max_integration_time_native = vts - 6;
-	sensor->video.attr->integration_time_limit = vts - 6;
-	sensor->video.attr->total_height = vts;
-	sensor->video.attr->max_integration_time = vts - 6;
-	ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
 
-	return ret;
+	return sensor_core_sync_vts(sd, fps, vts);
 }
 
 static int sensor_set_mode(struct tx_isp_subdev *sd, int value) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	int ret = ISP_SUCCESS;
 
-	if (wsize) {
-		sensor_set_attr(sd, wsize);
+	if (core->wsize) {
+		sensor_set_attr(sd, core->wsize);
 		ret = tx_isp_call_subdev_notify(sd, TX_ISP_EVENT_SYNC_SENSOR_ATTR, &sensor->video);
 	}
 
@@ -757,19 +642,19 @@ static int sensor_set_vflip(struct tx_isp_subdev *sd, int enable) {
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 
 	/* 2'b01:mirror,2'b10:filp */
-	val = sensor_read(sd, 0x3221, &val);
+	val = sensor_core_read(sd, 0x3221, &val);
 	switch (enable) {
 		case 0:
-			sensor_write(sd, 0x3221, val & 0x99);
+			sensor_core_write(sd, 0x3221, val & 0x99);
 			break;
 		case 1:
-			sensor_write(sd, 0x3221, val | 0x06);
+			sensor_core_write(sd, 0x3221, val | 0x06);
 			break;
 		case 2:
-			sensor_write(sd, 0x3221, val | 0x60);
+			sensor_core_write(sd, 0x3221, val | 0x60);
 			break;
 		case 3:
-			sensor_write(sd, 0x3221, val | 0x66);
+			sensor_core_write(sd, 0x3221, val | 0x66);
 			break;
 	}
 
@@ -780,6 +665,7 @@ static int sensor_set_vflip(struct tx_isp_subdev *sd, int enable) {
 }
 
 static int sensor_attr_check(struct tx_isp_subdev *sd) {
+	struct sensor_core *core = sd_to_sensor_core(sd);
 	struct tx_isp_sensor *sensor = sd_to_sensor_device(sd);
 	struct tx_isp_sensor_register_info *info = &sensor->info;
 	struct i2c_client *client = tx_isp_get_subdevdata(sd);
@@ -788,13 +674,13 @@ static int sensor_attr_check(struct tx_isp_subdev *sd) {
 
 	switch (info->default_boot) {
 		case 0:
-			wsize = &sensor_win_sizes[0];
-			memcpy(&(sensor_attr.mipi), &sensor_mipi, sizeof(sensor_mipi));
-			sensor_attr.mipi.image_twidth = 1920,
-			sensor_attr.mipi.image_theight = 1080,
-			sensor_attr.data_type = TX_SENSOR_DATA_TYPE_LINEAR;
-			sensor_attr.again = 0;
-			sensor_attr.integration_time = 0x118a;
+			core->wsize = &sensor_win_sizes[0];
+			memcpy(&(core->attr.mipi), &sensor_mipi, sizeof(sensor_mipi));
+			core->attr.mipi.image_twidth = 1920,
+			core->attr.mipi.image_theight = 1080,
+			core->attr.data_type = TX_SENSOR_DATA_TYPE_LINEAR;
+			core->attr.again = 0;
+			core->attr.integration_time = 0x118a;
 			break;
 		default:
 			ISP_ERROR("Have no this MCLK Source!!!\n");
@@ -802,12 +688,12 @@ static int sensor_attr_check(struct tx_isp_subdev *sd) {
 
 	switch (info->video_interface) {
 		case TISP_SENSOR_VI_MIPI_CSI0:
-			sensor_attr.dbus_type = TX_SENSOR_DATA_INTERFACE_MIPI;
-			sensor_attr.mipi.index = 0;
+			core->attr.dbus_type = TX_SENSOR_DATA_INTERFACE_MIPI;
+			core->attr.mipi.index = 0;
 			break;
 		case TISP_SENSOR_VI_MIPI_CSI1:
-			sensor_attr.dbus_type = TX_SENSOR_DATA_INTERFACE_MIPI;
-			sensor_attr.mipi.index = 1;
+			core->attr.dbus_type = TX_SENSOR_DATA_INTERFACE_MIPI;
+			core->attr.mipi.index = 1;
 		default:
 			ISP_ERROR("Have no this MCLK Source!!!\n");
 	}
@@ -827,14 +713,14 @@ static int sensor_attr_check(struct tx_isp_subdev *sd) {
 	rate = private_clk_get_rate(sensor->mclk);
 	private_clk_set_rate(sensor->mclk, 24000000);
 	private_clk_prepare_enable(sensor->mclk);
-	reset_gpio = info->rst_gpio;
-	pwdn_gpio = info->pwdn_gpio;
+	core->reset_gpio = info->rst_gpio;
+	core->pwdn_gpio = info->pwdn_gpio;
 
-	sensor_set_attr(sd, wsize);
-	sensor->video.fps = wsize->fps;
-	sensor->video.max_fps = wsize->fps;
+	sensor_set_attr(sd, core->wsize);
+	sensor->video.fps = core->wsize->fps;
+	sensor->video.max_fps = core->wsize->fps;
 	sensor->video.min_fps = SENSOR_OUTPUT_MIN_FPS << 16 | 1;
-	sensor->priv = wsize;
+	sensor->priv = core->wsize;
 
 	return 0;
 
@@ -842,51 +728,10 @@ static int sensor_attr_check(struct tx_isp_subdev *sd) {
 
 static int sensor_g_chip_ident(struct tx_isp_subdev *sd,
 			       struct tx_isp_chip_ident *chip) {
-	struct i2c_client *client = tx_isp_get_subdevdata(sd);
-	unsigned int ident = 0;
-	int ret = ISP_SUCCESS;
-
+	/* the clock and gpios of this sensor are in its register info */
 	sensor_attr_check(sd);
-	if (reset_gpio != -1) {
-		ret = private_gpio_request(reset_gpio, "sensor_reset");
-		if (!ret) {
-			private_gpio_direction_output(reset_gpio, 1);
-			private_msleep(10);
-			private_gpio_direction_output(reset_gpio, 0);
-			private_msleep(10);
-			private_gpio_direction_output(reset_gpio, 1);
-			private_msleep(10);
-		} else {
-			ISP_ERROR("gpio request fail %d\n", reset_gpio);
-		}
-	}
-	if (pwdn_gpio != -1) {
-		ret = private_gpio_request(pwdn_gpio, "sensor_pwdn");
-		if (!ret) {
-			private_gpio_direction_output(pwdn_gpio, 0);
-			private_msleep(10);
-			private_gpio_direction_output(pwdn_gpio, 1);
-			private_msleep(10);
-		} else {
-			ISP_ERROR("gpio request fail %d\n", pwdn_gpio);
-		}
-	}
-	ret = sensor_detect(sd, &ident);
-	if (ret) {
-		ISP_ERROR("chip found @ 0x%x (%s) is not an %s chip.\n",
-			  client->addr, client->adapter->name, SENSOR_NAME);
-		return ret;
-	}
-	ISP_WARNING("%s chip found @ 0x%02x (%s)\n",
-		    SENSOR_NAME, client->addr, client->adapter->name);
-	ISP_WARNING("sensor driver version %s\n", SENSOR_VERSION);
-	if (chip) {
-		memcpy(chip->name, SENSOR_NAME, sizeof(SENSOR_NAME));
-		chip->ident = ident;
-		chip->revision = SENSOR_VERSION;
-	}
 
-	return 0;
+	return sensor_core_g_chip_ident(sd, chip);
 }
 
 static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, void *arg) {
@@ -923,10 +768,10 @@ static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, v
 				ret = sensor_set_mode(sd, sensor_val->value);
 			break;
 		case TX_ISP_EVENT_SENSOR_PREPARE_CHANGE:
-			ret = sensor_write_array(sd, sensor_stream_off_mipi);
+			ret = sensor_core_stream(sd, 0);
 			break;
 		case TX_ISP_EVENT_SENSOR_FINISH_CHANGE:
-			ret = sensor_write_array(sd, sensor_stream_on_mipi);
+			ret = sensor_core_stream(sd, 1);
 			break;
 		case TX_ISP_EVENT_SENSOR_FPS:
 			if (arg)
@@ -943,44 +788,12 @@ static int sensor_sensor_ops_ioctl(struct tx_isp_subdev *sd, unsigned int cmd, v
 	return ret;
 }
 
-static int sensor_g_register(struct tx_isp_subdev *sd, struct tx_isp_dbg_register *reg) {
-	unsigned char val = 0;
-	int len = 0;
-	int ret = 0;
-
-	len = strlen(sd->chip.name);
-	if (len && strncmp(sd->chip.name, reg->name, len)) {
-		return -EINVAL;
-	}
-	if (!private_capable(CAP_SYS_ADMIN))
-		return -EPERM;
-	ret = sensor_read(sd, reg->reg & 0xffff, &val);
-	reg->val = val;
-	reg->size = 2;
-
-	return ret;
-}
-
-static int sensor_s_register(struct tx_isp_subdev *sd, const struct tx_isp_dbg_register *reg) {
-	int len = 0;
-
-	len = strlen(sd->chip.name);
-	if (len && strncmp(sd->chip.name, reg->name, len)) {
-		return -EINVAL;
-	}
-	if (!private_capable(CAP_SYS_ADMIN))
-		return -EPERM;
-	sensor_write(sd, reg->reg & 0xffff, reg->val & 0xff);
-
-	return 0;
-}
-
 static struct tx_isp_subdev_core_ops sensor_core_ops = {
 	.g_chip_ident = sensor_g_chip_ident,
 	.reset = sensor_reset,
 	.init = sensor_init,
-	.g_register = sensor_g_register,
-	.s_register = sensor_s_register,
+	.g_register = sensor_core_g_register,
+	.s_register = sensor_core_s_register,
 };
 
 static struct tx_isp_subdev_video_ops sensor_video_ops = {
@@ -1012,29 +825,31 @@ struct platform_device sensor_platform_device = {
 
 static int sensor_probe(struct i2c_client *client,
 			const struct i2c_device_id *id) {
-	struct tx_isp_subdev *sd;
-	struct tx_isp_video_in *video;
+	struct sensor_core *core;
 	struct tx_isp_sensor *sensor;
 
-	sensor = (struct tx_isp_sensor *) kzalloc(sizeof(*sensor), GFP_KERNEL);
-	if (!sensor) {
-		ISP_ERROR("Failed to allocate sensor subdev.\n");
+	/* the input clock is started by sensor_attr_check */
+	core = sensor_core_alloc(&sensor_desc, 0);
+	if (!core)
 		return -ENOMEM;
-	}
-	memset(sensor, 0, sizeof(*sensor));
 
-	sd = &sensor->sd;
-	video = &sensor->video;
+	core->reset_gpio = reset_gpio[core->id];
+	core->pwdn_gpio = pwdn_gpio[core->id];
+	core->data_interface = data_interface[core->id];
+	core->attr = sensor_attr;
+	core->wsize = &sensor_win_sizes[0];
+	sensor = &core->sensor;
 	sensor->dev = &client->dev;
-	sensor_attr.expo_fs = 1;
-	sensor->video.shvflip = 1;
-	sensor->video.attr = &sensor_attr;
-	tx_isp_subdev_init(&sensor_platform_device, sd, &sensor_ops);
-	tx_isp_set_subdevdata(sd, client);
-	tx_isp_set_subdev_hostdata(sd, sensor);
-	private_i2c_set_clientdata(client, sd);
+	core->timing.sclk = SENSOR_SUPPORT_SCLK;
+	core->timing.hts = core->attr.total_width;
+	core->timing.min_fps = SENSOR_OUTPUT_MIN_FPS;
+	core->timing.max_fps = SENSOR_OUTPUT_MAX_FPS;
+	core->timing.margin = 6;
 
-	pr_debug("probe ok ------->%s\n", SENSOR_NAME);
+	core->attr.expo_fs = 1;
+	sensor->video.shvflip = shvflip[core->id];
+	sensor->video.attr = &core->attr;
+	sensor_core_register(core, &sensor_platform_device, &sensor_ops, client);
 
 	return 0;
 }
@@ -1043,17 +858,13 @@ static int sensor_remove(struct i2c_client *client) {
 	struct tx_isp_subdev *sd = private_i2c_get_clientdata(client);
 	struct tx_isp_sensor *sensor = tx_isp_get_subdev_hostdata(sd);
 
-	if (reset_gpio != -1)
-		private_gpio_free(reset_gpio);
-	if (pwdn_gpio != -1)
-		private_gpio_free(pwdn_gpio);
-
-	private_clk_disable_unprepare(sensor->mclk);
-	private_devm_clk_put(&client->dev, sensor->mclk);
-	tx_isp_subdev_deinit(sd);
-	kfree(sensor);
+	if (sensor->mclk) {
+		private_clk_disable_unprepare(sensor->mclk);
+		private_devm_clk_put(&client->dev, sensor->mclk);
+		sensor->mclk = NULL;
+	}
 
-	return 0;
+	return sensor_core_remove(client);
 }
 
 static const struct i2c_device_id sensor_id[] = {
@@ -0,0 +1,987 @@
+/*
+ * The private_* wrappers which are the same on every soc and kernel. The
+ * t40/t41 firmware archives carry weak copies of them, these definitions
+ * take their place when the module is linked. The soc trees keep only the
+ * wrappers they change, see include/tx-isp-shim.h. The memory tracking of
+ * the allocators and the isp log are the same everywhere and live here too.
+ */
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/clk.h>
+#include <linux/file.h>
+#include <linux/gpio.h>
+#include <linux/time.h>
+#include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/module.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/kthread.h>
+#include <linux/interrupt.h>
+#include <linux/miscdevice.h>
+#include <linux/errno.h>
+#include <linux/i2c.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/completion.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/device.h>
+#include <linux/platform_device.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/resource.h>
+#include <linux/dma-mapping.h>
+#include <soc/gpio.h>
+#include <asm/io.h>
+#include <asm/uaccess.h>
+#include <asm/cacheflush.h>
+#include <jz_proc.h>
+
+#include <txx-funcs.h>
+#include <tx-isp-shim.h>
+
+MODULE_INFO(isp_shim, __stringify(TX_ISP_SHIM_VERSION));
+
+/* platform interfaces */
+int private_platform_driver_register(struct platform_driver *drv)
+{
+	return platform_driver_register(drv);
+}
+
+void private_platform_driver_unregister(struct platform_driver *drv)
+{
+	platform_driver_unregister(drv);
+}
+
+void private_platform_set_drvdata(struct platform_device *pdev, void *data)
+{
+	platform_set_drvdata(pdev, data);
+}
+
+void *private_platform_get_drvdata(struct platform_device *pdev)
+{
+	return platform_get_drvdata(pdev);
+}
+
+int private_platform_device_register(struct platform_device *pdev)
+{
+	return platform_device_register(pdev);
+}
+
+void private_platform_device_unregister(struct platform_device *pdev)
+{
+	platform_device_unregister(pdev);
+}
+
+struct resource *private_platform_get_resource(struct platform_device *dev,
+					       unsigned int type, unsigned int num)
+{
+	return platform_get_resource(dev, type, num);
+}
+
+void private_dev_set_drvdata(struct device *dev, void *data)
+{
+	dev_set_drvdata(dev, data);
+}
+
+void* private_dev_get_drvdata(const struct device *dev)
+{
+	return dev_get_drvdata(dev);
+}
+
+int private_platform_get_irq(struct platform_device *dev, unsigned int num)
+{
+	return platform_get_irq(dev, num);
+}
+
+struct resource * private_request_mem_region(resource_size_t start, resource_size_t n,
+					     const char *name)
+{
+	return request_mem_region(start, n, name);
+}
+
+void private_release_mem_region(resource_size_t start, resource_size_t n)
+{
+	release_mem_region(start, n);
+}
+
+void __iomem * private_ioremap(phys_addr_t offset, unsigned long size)
+{
+	return ioremap(offset, size);
+}
+
+void private_iounmap(const volatile void __iomem *addr)
+{
+	iounmap(addr);
+}
+
+/* interrupt interfaces */
+int private_request_threaded_irq(unsigned int irq, irq_handler_t handler,
+				 irq_handler_t thread_fn, unsigned long irqflags,
+				 const char *devname, void *dev_id)
+{
+	return request_threaded_irq(irq, handler, thread_fn, irqflags, devname, dev_id);
+}
+
+void private_enable_irq(unsigned int irq)
+{
+	enable_irq(irq);
+}
+
+void private_disable_irq(unsigned int irq)
+{
+	disable_irq(irq);
+}
+
+void private_free_irq(unsigned int irq, void *dev_id)
+{
+	free_irq(irq, dev_id);
+}
+
+/* lock and mutex interfaces */
+void __private_spin_lock_irqsave(spinlock_t *lock, unsigned long *flags)
+{
+	raw_spin_lock_irqsave(spinlock_check(lock), *flags);
+}
+
+void private_spin_unlock_irqrestore(spinlock_t *lock, unsigned long flags)
+{
+	spin_unlock_irqrestore(lock, flags);
+}
+
+void private_spin_lock_init(spinlock_t *lock)
+{
+	spin_lock_init(lock);
+}
+
+void private_mutex_lock(struct mutex *lock)
+{
+	mutex_lock(lock);
+}
+
+void private_mutex_unlock(struct mutex *lock)
+{
+	mutex_unlock(lock);
+}
+
+void private_raw_mutex_init(struct mutex *lock, const char *name, struct lock_class_key *key)
+{
+	__mutex_init(lock, name, key);
+}
+
+/* clock interfaces */
+struct clk * private_clk_get(struct device *dev, const char *id)
+{
+	return clk_get(dev, id);
+}
+EXPORT_SYMBOL(private_clk_get);
+
+struct clk * private_devm_clk_get(struct device *dev, const char *id)
+{
+	return devm_clk_get(dev, id);
+}
+EXPORT_SYMBOL(private_devm_clk_get);
+
+unsigned long private_clk_get_rate(struct clk *clk)
+{
+	return clk_get_rate(clk);
+}
+EXPORT_SYMBOL(private_clk_get_rate);
+
+/* i2c interfaces */
+struct i2c_adapter* private_i2c_get_adapter(int nr)
+{
+	return i2c_get_adapter(nr);
+}
+
+void private_i2c_put_adapter(struct i2c_adapter *adap)
+{
+	i2c_put_adapter(adap);
+}
+
+int private_i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	return i2c_transfer(adap, msgs, num);
+}
+EXPORT_SYMBOL(private_i2c_transfer);
+
+int private_i2c_register_driver(struct module *owner, struct i2c_driver *driver)
+{
+	return i2c_register_driver(owner, driver);
+}
+
+void private_i2c_del_driver(struct i2c_driver *drv)
+{
+	i2c_del_driver(drv);
+}
+EXPORT_SYMBOL(private_i2c_del_driver);
+
+struct i2c_client *private_i2c_new_device(struct i2c_adapter *adap, struct i2c_board_info const *info)
+{
+	return i2c_new_device(adap, info);
+}
+
+void private_i2c_set_clientdata(struct i2c_client *dev, void *data)
+{
+	i2c_set_clientdata(dev, data);
+}
+EXPORT_SYMBOL(private_i2c_set_clientdata);
+
+void *private_i2c_get_clientdata(const struct i2c_client *dev)
+{
+	return i2c_get_clientdata(dev);
+}
+EXPORT_SYMBOL(private_i2c_get_clientdata);
+
+int private_i2c_add_driver(struct i2c_driver *drv)
+{
+	return i2c_add_driver(drv);
+}
+EXPORT_SYMBOL(private_i2c_add_driver);
+
+void private_i2c_unregister_device(struct i2c_client *client)
+{
+	i2c_unregister_device(client);
+}
+
+/* gpio interfaces */
+int private_gpio_request(unsigned gpio, const char *label)
+{
+	return gpio_request(gpio, label);
+}
+EXPORT_SYMBOL(private_gpio_request);
+
+void private_gpio_free(unsigned gpio)
+{
+	gpio_free(gpio);
+}
+EXPORT_SYMBOL(private_gpio_free);
+
+int private_gpio_direction_output(unsigned gpio, int value)
+{
+	return gpio_direction_output(gpio, value);
+}
+EXPORT_SYMBOL(private_gpio_direction_output);
+
+int private_gpio_direction_input(unsigned gpio)
+{
+	return gpio_direction_input(gpio);
+}
+
+int private_gpio_set_debounce(unsigned gpio, unsigned debounce)
+{
+	return gpio_set_debounce(gpio, debounce);
+}
+
+int private_jzgpio_set_func(enum gpio_port port, enum gpio_function func,unsigned long pins)
+{
+	return jzgpio_set_func(port, func, pins);
+}
+EXPORT_SYMBOL(private_jzgpio_set_func);
+
+/* system interfaces */
+void private_msleep(unsigned int msecs)
+{
+	msleep(msecs);
+}
+EXPORT_SYMBOL(private_msleep);
+
+bool private_capable(int cap)
+{
+	return capable(cap);
+}
+EXPORT_SYMBOL(private_capable);
+
+unsigned long long private_sched_clock(void)
+{
+	return sched_clock();
+}
+
+bool private_try_module_get(struct module *module)
+{
+	return try_module_get(module);
+}
+
+int private_request_module(bool wait, const char *fmt, ...)
+{
+	int ret = 0;
+	struct va_format vaf;
+	va_list args;
+	va_start(args, fmt);
+	vaf.fmt = fmt;
+	vaf.va = &args;
+	ret =  __request_module(true,"%pV", &vaf);
+	va_end(args);
+	return ret;
+}
+
+void private_module_put(struct module *module)
+{
+	module_put(module);
+}
+
+/* wait interfaces */
+void private_init_completion(struct completion *x)
+{
+	init_completion(x);
+}
+
+void private_complete(struct completion *x)
+{
+	complete(x);
+}
+
+int private_wait_for_completion_interruptible(struct completion *x)
+{
+	return wait_for_completion_interruptible(x);
+}
+
+unsigned long private_wait_for_completion_timeout(struct completion *x, unsigned long timeover)
+{
+	return wait_for_completion_timeout(x, timeover);
+}
+
+int private_wait_event_interruptible(wait_queue_head_t *q, int (*state)(void *), void *data)
+{
+	return wait_event_interruptible((*q), state(data));
+}
+
+void private_wake_up_all(wait_queue_head_t *q)
+{
+	wake_up_all(q);
+}
+
+void private_wake_up(wait_queue_head_t *q)
+{
+	wake_up(q);
+}
+
+void private_init_waitqueue_head(wait_queue_head_t *q)
+{
+	init_waitqueue_head(q);
+}
+
+/* misc driver interfaces */
+int private_misc_register(struct miscdevice *mdev)
+{
+	return misc_register(mdev);
+}
+
+void private_misc_deregister(struct miscdevice *mdev)
+{
+	misc_deregister(mdev);
+}
+
+/* copy user interfaces */
+long private_copy_from_user(void *to, const void __user *from, long size)
+{
+	return copy_from_user(to, from,size);
+}
+
+long private_copy_to_user(void __user *to, const void *from, long size)
+{
+	return copy_to_user(to, from, size);
+}
+
+/* file interfaces */
+struct file *private_filp_open(const char *filename, int flags, umode_t mode)
+{
+	return filp_open(filename, flags, mode);
+}
+
+int private_filp_close(struct file *filp, fl_owner_t id)
+{
+	return filp_close(filp, id);
+}
+
+ssize_t private_vfs_read(struct file *file, char __user *buf, size_t count, loff_t *pos)
+{
+	return vfs_read(file, buf, count, pos);
+}
+
+ssize_t private_vfs_write(struct file *file, const char __user *buf, size_t count, loff_t *pos)
+{
+	return vfs_write(file, buf, count, pos);
+}
+
+loff_t private_vfs_llseek(struct file *file, loff_t offset, int whence)
+{
+	return vfs_llseek(file, offset, whence);
+}
+
+mm_segment_t private_get_fs(void)
+{
+	return get_fs();
+}
+
+void private_set_fs(mm_segment_t val)
+{
+	set_fs(val);
+}
+
+void private_dma_cache_sync(struct device *dev, void *vaddr, size_t size,
+			    enum dma_data_direction direction)
+{
+	dma_cache_sync(dev, vaddr, size, direction);
+}
+
+void private_getrawmonotonic(struct timespec *ts)
+{
+	getrawmonotonic(ts);
+}
+
+/* kthread interfaces */
+bool private_kthread_should_stop(void)
+{
+	return kthread_should_stop();
+}
+
+struct task_struct* private_kthread_run(int (*threadfn)(void *data), void *data, const char namefmt[])
+{
+	return kthread_run(threadfn, data, namefmt);
+}
+
+int private_kthread_stop(struct task_struct *k)
+{
+	return kthread_stop(k);
+}
+
+/* proc file interfaces */
+ssize_t private_seq_read(struct file *file, char __user *buf, size_t size, loff_t *ppos)
+{
+	return seq_read(file, buf, size, ppos);
+}
+
+loff_t private_seq_lseek(struct file *file, loff_t offset, int whence)
+{
+	return seq_lseek(file, offset, whence);
+}
+
+int private_single_release(struct inode *inode, struct file *file)
+{
+	return single_release(inode, file);
+}
+
+int private_single_open_size(struct file *file, int (*show)(struct seq_file *, void *), void *data, size_t size)
+{
+	return single_open_size(file, show, data, size);
+}
+
+struct proc_dir_entry* private_jz_proc_mkdir(char *s)
+{
+	return jz_proc_mkdir(s);
+}
+
+void private_proc_remove(struct proc_dir_entry *de)
+{
+	proc_remove(de);
+}
+
+void private_seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	struct va_format vaf;
+	va_list args;
+	int r = 0;
+	va_start(args, fmt);
+
+	vaf.fmt = fmt;
+	vaf.va = &args;
+
+	seq_printf(m, "%pV", &vaf);
+	r = m->count;
+	va_end(args);
+}
+
+unsigned long long private_simple_strtoull(const char *cp, char **endp, unsigned int base)
+{
+	return simple_strtoull(cp, endp,  base);
+}
+
+/* time and work interfaces */
+ktime_t private_ktime_set(const long secs, const unsigned long nsecs)
+{
+	return ktime_set(secs, nsecs);
+}
+
+void private_set_current_state(unsigned int state)
+{
+	__set_current_state(state);
+	return;
+}
+
+int private_schedule_hrtimeout(ktime_t *ex, const enum hrtimer_mode mode)
+{
+	return schedule_hrtimeout(ex, mode);
+}
+
+bool private_schedule_work(struct work_struct *work)
+{
+	return schedule_work(work);
+}
+
+void private_do_gettimeofday(struct timeval *tv)
+{
+	do_gettimeofday(tv);
+	return;
+}
+
+/*
+ * The memory allocated through private_vmalloc and private_kmalloc is
+ * recorded with its call site, /proc/jz/isp-mem lists every buffer with
+ * the requested size and the real footprint, so the cost of a mode and the
+ * saving of isp_memopt can be measured. A record is allocated with the gfp
+ * of the buffer it tracks; the proc file copies the records out under the
+ * lock and prints the copy.
+ */
+#define ISP_MEM_HASH_SIZE	64
+#define ISP_MEM_PROC_NAME	"jz/isp-mem"
+
+enum isp_mem_type {
+	ISP_MEM_VMALLOC,
+	ISP_MEM_KMALLOC,
+	ISP_MEM_TYPE_MAX,
+};
+
+static const char *isp_mem_type_name[ISP_MEM_TYPE_MAX] = {"vmalloc", "kmalloc"};
+
+struct isp_mem_record {
+	struct hlist_node node;
+	const void *addr;
+	size_t size;
+	size_t footprint;
+	unsigned long caller;
+	int type;
+};
+
+static struct hlist_head isp_mem_hash[ISP_MEM_HASH_SIZE];
+static size_t isp_mem_total[ISP_MEM_TYPE_MAX];
+static size_t isp_mem_peak[ISP_MEM_TYPE_MAX];
+static unsigned int isp_mem_untracked;
+static unsigned int isp_mem_count;
+static DEFINE_SPINLOCK(isp_mem_lock);
+
+#define isp_mem_bucket(addr) (&isp_mem_hash[((unsigned long)(addr) >> 4) % ISP_MEM_HASH_SIZE])
+
+static void isp_mem_track(const void *addr, size_t size, size_t footprint, unsigned long caller, int type, gfp_t gfp)
+{
+	struct isp_mem_record *rec = NULL;
+	unsigned long flags = 0;
+
+	if(addr == NULL)
+		return;
+
+	rec = kmalloc(sizeof(*rec), gfp);
+	spin_lock_irqsave(&isp_mem_lock, flags);
+	if(rec == NULL){
+		isp_mem_untracked++;
+		spin_unlock_irqrestore(&isp_mem_lock, flags);
+		return;
+	}
+	rec->addr = addr;
+	rec->size = size;
+	rec->footprint = footprint;
+	rec->caller = caller;
+	rec->type = type;
+	hlist_add_head(&rec->node, isp_mem_bucket(addr));
+	isp_mem_count++;
+	isp_mem_total[type] += footprint;
+	if(isp_mem_total[type] > isp_mem_peak[type])
+		isp_mem_peak[type] = isp_mem_total[type];
+	spin_unlock_irqrestore(&isp_mem_lock, flags);
+}
+
+static void isp_mem_untrack(const void *addr)
+{
+	struct isp_mem_record *rec = NULL;
+	unsigned long flags = 0;
+
+	if(addr == NULL)
+		return;
+
+	spin_lock_irqsave(&isp_mem_lock, flags);
+	hlist_for_each_entry(rec, isp_mem_bucket(addr), node){
+		if(rec->addr == addr){
+			hlist_del(&rec->node);
+			isp_mem_count--;
+			isp_mem_total[rec->type] -= rec->footprint;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&isp_mem_lock, flags);
+
+	if(rec)
+		kfree(rec);
+}
+
+/* memory interfaces */
+void *private_vmalloc(unsigned long size)
+{
+	void *addr = vmalloc(size);
+	isp_mem_track(addr, size, PAGE_ALIGN(size), (unsigned long)__builtin_return_address(0),
+			ISP_MEM_VMALLOC, GFP_KERNEL);
+	return addr;
+}
+
+void private_vfree(const void *addr)
+{
+	isp_mem_untrack(addr);
+	vfree(addr);
+}
+
+void * private_kmalloc(size_t s, gfp_t gfp)
+{
+	void *addr = kmalloc(s, gfp);
+	isp_mem_track(addr, s, addr ? ksize(addr) : 0, (unsigned long)__builtin_return_address(0),
+			ISP_MEM_KMALLOC, gfp);
+	return addr;
+}
+
+void private_kfree(void *p){
+	isp_mem_untrack(p);
+	kfree(p);
+}
+
+/* proc file interfaces */
+
+extern unsigned long ispmem_base;
+extern unsigned long ispmem_size;
+
+static void get_isp_priv_mem(unsigned int *phyaddr, unsigned int *size)
+{
+	*phyaddr = ispmem_base;
+	*size = ispmem_size;
+}
+
+void private_get_isp_priv_mem(unsigned int *phyaddr, unsigned int *size)
+{
+	get_isp_priv_mem(phyaddr, size);
+}
+
+static int isp_mem_show(struct seq_file *m, void *v)
+{
+	struct isp_mem_record *rec = NULL;
+	struct isp_mem_record *copy = NULL;
+	size_t total[ISP_MEM_TYPE_MAX], peak[ISP_MEM_TYPE_MAX];
+	unsigned int phyaddr = 0, size = 0;
+	unsigned int n = 0, count = 0, untracked = 0;
+	unsigned long flags = 0;
+	int i = 0;
+
+	spin_lock_irqsave(&isp_mem_lock, flags);
+	count = isp_mem_count;
+	spin_unlock_irqrestore(&isp_mem_lock, flags);
+	/* the buffers allocated meanwhile are left out */
+	copy = vmalloc((count + 1) * sizeof(*copy));
+	if(copy == NULL)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&isp_mem_lock, flags);
+	for(i = 0; i < ISP_MEM_HASH_SIZE; i++){
+		hlist_for_each_entry(rec, &isp_mem_hash[i], node){
+			if(n == count)
+				break;
+			copy[n++] = *rec;
+		}
+	}
+	memcpy(total, isp_mem_total, sizeof(total));
+	memcpy(peak, isp_mem_peak, sizeof(peak));
+	untracked = isp_mem_untracked;
+	spin_unlock_irqrestore(&isp_mem_lock, flags);
+
+	get_isp_priv_mem(&phyaddr, &size);
+	seq_printf(m, "reserved: 0x%08x size %u\n", phyaddr, size);
+	seq_printf(m, "%-8s %-10s %10s %10s  %s\n", "type", "addr", "size", "footprint", "caller");
+	for(i = 0; i < n; i++)
+		seq_printf(m, "%-8s %p %10zu %10zu  %pS\n", isp_mem_type_name[copy[i].type],
+				copy[i].addr, copy[i].size, copy[i].footprint, (void *)copy[i].caller);
+	for(i = 0; i < ISP_MEM_TYPE_MAX; i++)
+		seq_printf(m, "%s total: %zu peak: %zu\n", isp_mem_type_name[i], total[i], peak[i]);
+	if(untracked)
+		seq_printf(m, "untracked: %u\n", untracked);
+	vfree(copy);
+
+	return 0;
+}
+
+static int isp_mem_open(struct inode *inode, struct file *file)
+{
+	return single_open_size(file, isp_mem_show, NULL, 8192);
+}
+
+static const struct file_operations isp_mem_fops = {
+	.read = seq_read,
+	.open = isp_mem_open,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int isp_mem_init(void)
+{
+	if(proc_create(ISP_MEM_PROC_NAME, S_IRUGO, NULL, &isp_mem_fops) == NULL)
+		printk(KERN_WARNING "isp: failed to create /proc/%s\n", ISP_MEM_PROC_NAME);
+	return 0;
+}
+
+void isp_mem_exit(void)
+{
+	struct isp_mem_record *rec = NULL;
+	struct hlist_node *tmp = NULL;
+	int i = 0;
+
+	remove_proc_entry(ISP_MEM_PROC_NAME, NULL);
+	for(i = 0; i < ISP_MEM_HASH_SIZE; i++){
+		hlist_for_each_entry_safe(rec, tmp, &isp_mem_hash[i], node){
+			hlist_del(&rec->node);
+			kfree(rec);
+		}
+	}
+}
+
+/* isp log */
+static int print_level = TX_ISP_LOG_WARNING_LEVEL;
+module_param(print_level, int, S_IRUGO);
+MODULE_PARM_DESC(print_level, "isp print level");
+
+/*
+ * The messages are formatted into a ring and printed to the console by a
+ * worker, so a recurring error in an interrupt or a per-frame path doesn't
+ * stall the isp. Every call site may print ISP_LOG_SITE_BURST messages in
+ * ISP_LOG_SITE_INTERVAL, the others are counted and reported with the next
+ * message; the stack is dumped once for every call site of errors.
+ * The call sites are kept in a small table, the least recently used one
+ * gives its place up; the sites whose stack has been dumped are kept apart,
+ * so an evicted site doesn't dump it again. A message is cut at
+ * ISP_LOG_MSG_LEN bytes.
+ * The recent messages can be read from /proc/jz/isp-log.
+ */
+#define ISP_LOG_RING_SIZE	64
+#define ISP_LOG_MSG_LEN		256
+#define ISP_LOG_SITES		32
+#define ISP_LOG_DUMPED		64
+#define ISP_LOG_SITE_BURST	10
+#define ISP_LOG_SITE_INTERVAL	(5 * HZ)
+#define ISP_LOG_PROC_NAME	"jz/isp-log"
+
+struct isp_log_entry {
+	unsigned long long ts;
+	unsigned int level;
+	unsigned int suppressed;
+	char msg[ISP_LOG_MSG_LEN];
+};
+
+struct isp_log_site {
+	unsigned long caller;
+	unsigned long begin;
+	unsigned long last;
+	unsigned int printed;
+	unsigned int suppressed;
+};
+
+static struct isp_log_entry isp_log_ring[ISP_LOG_RING_SIZE];
+static unsigned int isp_log_head;	/* the count of messages */
+static unsigned int isp_log_tail;	/* the next message to the console */
+static unsigned int isp_log_lost;
+static struct isp_log_site isp_log_sites[ISP_LOG_SITES];
+static unsigned long isp_log_dumped[ISP_LOG_DUMPED];
+static unsigned int isp_log_ndumped;
+static DEFINE_SPINLOCK(isp_log_lock);
+
+static void isp_log_work_func(struct work_struct *work)
+{
+	struct isp_log_entry entry;
+	unsigned long flags = 0;
+	unsigned int lost = 0;
+
+	spin_lock_irqsave(&isp_log_lock, flags);
+	while(isp_log_tail != isp_log_head){
+		entry = isp_log_ring[isp_log_tail % ISP_LOG_RING_SIZE];
+		isp_log_tail++;
+		lost = isp_log_lost;
+		isp_log_lost = 0;
+		spin_unlock_irqrestore(&isp_log_lock, flags);
+
+		if(lost)
+			printk(KERN_WARNING "isp: %u messages are lost\n", lost);
+		if(entry.suppressed)
+			printk(KERN_WARNING "isp: %u messages are suppressed\n", entry.suppressed);
+		printk("%s", entry.msg);
+
+		spin_lock_irqsave(&isp_log_lock, flags);
+	}
+	spin_unlock_irqrestore(&isp_log_lock, flags);
+}
+static DECLARE_WORK(isp_log_work, isp_log_work_func);
+
+/*
+ * It is called with isp_log_lock held. Once ISP_LOG_DUMPED sites have
+ * dumped their stack no more stacks are dumped.
+ */
+static bool isp_log_dump_once(unsigned long caller)
+{
+	unsigned int i;
+
+	for(i = 0; i < isp_log_ndumped; i++){
+		if(isp_log_dumped[i] == caller)
+			return false;
+	}
+	if(isp_log_ndumped == ISP_LOG_DUMPED)
+		return false;
+	isp_log_dumped[isp_log_ndumped++] = caller;
+	return true;
+}
+
+/* It is called with isp_log_lock held */
+static bool isp_log_site_allow(unsigned long caller, unsigned int level, unsigned int *suppressed, bool *dump)
+{
+	struct isp_log_site *site = NULL;
+	struct isp_log_site *lru = &isp_log_sites[0];
+	unsigned int i;
+
+	for(i = 0; i < ISP_LOG_SITES; i++){
+		if(isp_log_sites[i].caller == caller){
+			site = &isp_log_sites[i];
+			break;
+		}
+		if(lru->caller && (!isp_log_sites[i].caller || time_before(isp_log_sites[i].last, lru->last)))
+			lru = &isp_log_sites[i];
+	}
+	if(!site){
+		site = lru;
+		memset(site, 0, sizeof(*site));
+		site->caller = caller;
+		site->begin = jiffies;
+	}
+	site->last = jiffies;
+
+	if(time_after(jiffies, site->begin + ISP_LOG_SITE_INTERVAL)){
+		site->begin = jiffies;
+		site->printed = 0;
+	}
+
+	if(site->printed >= ISP_LOG_SITE_BURST){
+		site->suppressed++;
+		return false;
+	}
+
+	site->printed++;
+	*suppressed = site->suppressed;
+	site->suppressed = 0;
+	if(level >= TX_ISP_LOG_ERROR_LEVEL && isp_log_dump_once(caller))
+		*dump = true;
+	return true;
+}
+
+int isp_printf(unsigned int level, unsigned char *fmt, ...)
+{
+	unsigned long caller = (unsigned long)__builtin_return_address(0);
+	struct isp_log_entry *entry = NULL;
+	unsigned int suppressed = 0;
+	unsigned long flags = 0;
+	bool dump = false;
+	va_list args;
+	int r = 0;
+
+	if(level < print_level)
+		return 0;
+
+	spin_lock_irqsave(&isp_log_lock, flags);
+	if(!isp_log_site_allow(caller, level, &suppressed, &dump)){
+		spin_unlock_irqrestore(&isp_log_lock, flags);
+		return 0;
+	}
+
+	/* the oldest message is overwritten if the worker is late */
+	if(isp_log_head - isp_log_tail >= ISP_LOG_RING_SIZE){
+		isp_log_tail++;
+		isp_log_lost++;
+	}
+	entry = &isp_log_ring[isp_log_head % ISP_LOG_RING_SIZE];
+	entry->ts = local_clock();
+	entry->level = level;
+	entry->suppressed = suppressed;
+	va_start(args, fmt);
+	r = vscnprintf(entry->msg, sizeof(entry->msg), (const char *)fmt, args);
+	va_end(args);
+	isp_log_head++;
+	spin_unlock_irqrestore(&isp_log_lock, flags);
+
+	schedule_work(&isp_log_work);
+	if(dump)
+		dump_stack();
+	return r;
+}
+EXPORT_SYMBOL(isp_printf);
+
+static int isp_log_show(struct seq_file *m, void *v)
+{
+	struct isp_log_entry entry;
+	unsigned long long ts = 0;
+	unsigned long flags = 0;
+	unsigned int head, index;
+	unsigned long rem;
+	const char *msg;
+	size_t len;
+
+	spin_lock_irqsave(&isp_log_lock, flags);
+	head = isp_log_head;
+	spin_unlock_irqrestore(&isp_log_lock, flags);
+
+	index = head > ISP_LOG_RING_SIZE ? head - ISP_LOG_RING_SIZE : 0;
+	for(; index != head; index++){
+		spin_lock_irqsave(&isp_log_lock, flags);
+		if(isp_log_head - index > ISP_LOG_RING_SIZE){
+			/* it has been overwritten */
+			spin_unlock_irqrestore(&isp_log_lock, flags);
+			continue;
+		}
+		entry = isp_log_ring[index % ISP_LOG_RING_SIZE];
+		spin_unlock_irqrestore(&isp_log_lock, flags);
+
+		ts = entry.ts;
+		rem = do_div(ts, 1000000000);
+		if(entry.suppressed)
+			seq_printf(m, "[%5lu.%06lu] %u messages are suppressed\n",
+					(unsigned long)ts, rem / 1000, entry.suppressed);
+		msg = printk_skip_level(entry.msg);
+		len = strlen(msg);
+		seq_printf(m, "[%5lu.%06lu] <%u> %s%s", (unsigned long)ts, rem / 1000,
+				entry.level, msg, (len && msg[len - 1] == '\n') ? "" : "\n");
+	}
+	return 0;
+}
+
+static int isp_log_open(struct inode *inode, struct file *file)
+{
+	return single_open_size(file, isp_log_show, NULL, ISP_LOG_RING_SIZE * (ISP_LOG_MSG_LEN + 64));
+}
+
+static const struct file_operations isp_log_fops = {
+	.read = seq_read,
+	.open = isp_log_open,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int isp_log_init(void)
+{
+	if(proc_create(ISP_LOG_PROC_NAME, S_IRUGO, NULL, &isp_log_fops) == NULL)
+		printk(KERN_WARNING "isp: failed to create /proc/%s\n", ISP_LOG_PROC_NAME);
+	return 0;
+}
+
+void isp_log_exit(void)
+{
+	remove_proc_entry(ISP_LOG_PROC_NAME, NULL);
+	flush_work(&isp_log_work);
+}
+
+/*
+ * Every wrapper of the symbol table is taken here, a wrapper which is removed
+ * or renamed without regenerating the table breaks the build.
+ */
+#define TX_ISP_SHIM_ENTRY(sym) (unsigned long)&sym,
+static const unsigned long tx_isp_shim_table[] __used = {
+	TX_ISP_SHIM_SYMBOLS(TX_ISP_SHIM_ENTRY)
+};
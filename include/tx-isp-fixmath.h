@@ -0,0 +1,102 @@
+#ifndef __TX_ISP_FIXMATH_H__
+#define __TX_ISP_FIXMATH_H__
+
+/*
+ * Fixed point helpers of the wrapper layers, they are called by the
+ * AE/AWB loops of the firmware every frame.
+ *
+ * The results are bit exact with the old compare chain and loop versions;
+ * the msb is found by fls(), which is a single clz instruction on mips32.
+ */
+#include <linux/types.h>
+#include <linux/bitops.h>
+
+/* 2^(i/32) in Q30, i = 0 ~ 32 */
+static const unsigned int __tx_isp_pow2_lut[33]={
+	1073741824,1097253708,1121280436,1145833280,1170923762,1196563654,1222764986,1249540052,
+	1276901417,1304861917,1333434672,1362633090,1392470869,1422962010,1454120821,1485961921,
+	1518500250,1551751076,1585730000,1620452965,1655936265,1692196547,1729250827,1767116489,
+	1805811301,1845353420,1885761398,1927054196,1969251188,2012372174,2056437387,2101467502,
+	2147483648U};
+
+static inline uint8_t tx_isp_leading_one_position(uint32_t val)
+{
+	return val ? fls(val) - 1 : 0;
+}
+
+static inline int tx_isp_leading_one_position_64(uint64_t val)
+{
+	return val ? fls64(val) - 1 : 0;
+}
+
+/*
+ * The fractional bits of log2, a is the mantissa normalized to [1, 2) in Q15.
+ * Every step squares it, the bit is 1 when the square is not less than 2.
+ */
+static inline uint32_t __tx_isp_log2_fract(uint32_t pos, uint32_t a, uint8_t precision, uint8_t shift_out)
+{
+	uint32_t result = 0;
+	uint32_t b;
+	int i;
+
+	for(i = 0; i < precision; i++){
+		b = a * a;
+		if(b & (1U << 31)){
+			result = (result << 1) + 1;
+			a = b >> 16;
+		}else{
+			result = (result << 1);
+			a = b >> 15;
+		}
+	}
+
+	return (((pos << precision) + result) << shift_out) | ((a & 0x7fff) >> (15 - shift_out));
+}
+
+/* y = log2(x), x is an integer, y is fixed point with precision fraction bits */
+static inline uint32_t tx_isp_log2_int_to_fixed(uint32_t val, uint8_t precision, uint8_t shift_out)
+{
+	uint32_t pos;
+
+	if(val == 0)
+		return 0;
+
+	pos = tx_isp_leading_one_position(val);
+	return __tx_isp_log2_fract(pos, (pos <= 15) ? (val << (15 - pos)) : (val >> (pos - 15)),
+			precision, shift_out);
+}
+
+static inline uint32_t tx_isp_log2_int_to_fixed_64(uint64_t val, uint8_t precision, uint8_t shift_out)
+{
+	uint32_t pos;
+
+	if(val == 0)
+		return 0;
+
+	pos = tx_isp_leading_one_position_64(val);
+	return __tx_isp_log2_fract(pos, (uint32_t)((pos <= 15) ? (val << (15 - pos)) : (val >> (pos - 15))),
+			precision, shift_out);
+}
+
+/* y = 2^x, x is fixed point with shift_in fraction bits, y has shift_out fraction bits */
+static inline uint32_t tx_isp_math_exp2(uint32_t val, unsigned char shift_in, unsigned char shift_out)
+{
+	unsigned int fract_part = val & ((1 << shift_in) - 1);
+	unsigned int int_part = val >> shift_in;
+	unsigned int lut_index, lut_fract, a, b;
+
+	if(shift_in <= 5){
+		lut_index = fract_part << (5 - shift_in);
+		return __tx_isp_pow2_lut[lut_index] >> (30 - shift_out - int_part);
+	}
+
+	lut_index = fract_part >> (shift_in - 5);
+	lut_fract = fract_part & ((1 << (shift_in - 5)) - 1);
+	a = __tx_isp_pow2_lut[lut_index];
+	b = __tx_isp_pow2_lut[lut_index + 1];
+	a += ((unsigned long long)(b - a) * lut_fract) >> (shift_in - 5);
+
+	return a >> (30 - shift_out - int_part);
+}
+
+#endif /* __TX_ISP_FIXMATH_H__ */
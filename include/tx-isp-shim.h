@@ -0,0 +1,122 @@
+#ifndef __TX_ISP_SHIM_H__
+#define __TX_ISP_SHIM_H__
+
+/*
+ * The private_* wrappers which are the same on every soc and kernel are
+ * kept once in common/tx-isp-shim.c. The file has no kernel or soc
+ * conditionals, each isp module builds it against its own kernel headers
+ * and txx-funcs.h. TX_ISP_SHIM_VERSION is raised when a wrapper changes
+ * its abi.
+ */
+
+#define TX_ISP_SHIM_VERSION	1
+
+/*
+ * isp_printf and its ring are kept in the shim too, the log levels are the
+ * same on every soc.
+ */
+#define TX_ISP_LOG_WARNING_LEVEL	0x1
+#define TX_ISP_LOG_ERROR_LEVEL		0x2
+
+int isp_printf(unsigned int level, unsigned char *fmt, ...);
+int isp_log_init(void);
+void isp_log_exit(void);
+int isp_mem_init(void);
+void isp_mem_exit(void);
+
+/* BEGIN TX_ISP_SHIM_SYMBOLS, generated by tools/gen-shim-symbols.sh */
+#define TX_ISP_SHIM_SYMBOLS(X) \
+	X(private_platform_driver_register) \
+	X(private_platform_driver_unregister) \
+	X(private_platform_set_drvdata) \
+	X(private_platform_get_drvdata) \
+	X(private_platform_device_register) \
+	X(private_platform_device_unregister) \
+	X(private_platform_get_resource) \
+	X(private_dev_set_drvdata) \
+	X(private_dev_get_drvdata) \
+	X(private_platform_get_irq) \
+	X(private_request_mem_region) \
+	X(private_release_mem_region) \
+	X(private_ioremap) \
+	X(private_iounmap) \
+	X(private_request_threaded_irq) \
+	X(private_enable_irq) \
+	X(private_disable_irq) \
+	X(private_free_irq) \
+	X(__private_spin_lock_irqsave) \
+	X(private_spin_unlock_irqrestore) \
+	X(private_spin_lock_init) \
+	X(private_mutex_lock) \
+	X(private_mutex_unlock) \
+	X(private_raw_mutex_init) \
+	X(private_clk_get) \
+	X(private_devm_clk_get) \
+	X(private_clk_get_rate) \
+	X(private_i2c_get_adapter) \
+	X(private_i2c_put_adapter) \
+	X(private_i2c_transfer) \
+	X(private_i2c_register_driver) \
+	X(private_i2c_del_driver) \
+	X(private_i2c_new_device) \
+	X(private_i2c_set_clientdata) \
+	X(private_i2c_get_clientdata) \
+	X(private_i2c_add_driver) \
+	X(private_i2c_unregister_device) \
+	X(private_gpio_request) \
+	X(private_gpio_free) \
+	X(private_gpio_direction_output) \
+	X(private_gpio_direction_input) \
+	X(private_gpio_set_debounce) \
+	X(private_jzgpio_set_func) \
+	X(private_msleep) \
+	X(private_capable) \
+	X(private_sched_clock) \
+	X(private_try_module_get) \
+	X(private_request_module) \
+	X(private_module_put) \
+	X(private_init_completion) \
+	X(private_complete) \
+	X(private_wait_for_completion_interruptible) \
+	X(private_wait_for_completion_timeout) \
+	X(private_wait_event_interruptible) \
+	X(private_wake_up_all) \
+	X(private_wake_up) \
+	X(private_init_waitqueue_head) \
+	X(private_misc_register) \
+	X(private_misc_deregister) \
+	X(private_copy_from_user) \
+	X(private_copy_to_user) \
+	X(private_filp_open) \
+	X(private_filp_close) \
+	X(private_vfs_read) \
+	X(private_vfs_write) \
+	X(private_vfs_llseek) \
+	X(private_get_fs) \
+	X(private_set_fs) \
+	X(private_dma_cache_sync) \
+	X(private_getrawmonotonic) \
+	X(private_kthread_should_stop) \
+	X(private_kthread_run) \
+	X(private_kthread_stop) \
+	X(private_seq_read) \
+	X(private_seq_lseek) \
+	X(private_single_release) \
+	X(private_single_open_size) \
+	X(private_jz_proc_mkdir) \
+	X(private_proc_remove) \
+	X(private_seq_printf) \
+	X(private_simple_strtoull) \
+	X(private_ktime_set) \
+	X(private_set_current_state) \
+	X(private_schedule_hrtimeout) \
+	X(private_schedule_work) \
+	X(private_do_gettimeofday) \
+	X(private_vmalloc) \
+	X(private_vfree) \
+	X(private_kmalloc) \
+	X(private_kfree) \
+	X(private_get_isp_priv_mem)
+/* END TX_ISP_SHIM_SYMBOLS */
+
+#endif /* __TX_ISP_SHIM_H__ */
@@ -0,0 +1,206 @@
+#!/bin/sh
+#
+# Regenerate the mode switch deltas of a sensor driver from its init tables.
+#
+# usage: gen-sensor-deltas.sh [--check] driver.c...
+# With --check the drivers are not touched, the exit status is 1 if one is stale.
+#
+# The driver lists the switches it wants in the comment that opens the
+# generated block, one "from to" pair of init tables per line, named
+# without their sensor_init_regs_ prefix. A "page <reg>" line names the
+# page select register of sensors with paged registers:
+#
+#	/* BEGIN SENSOR_DELTAS, generated by tools/gen-sensor-deltas.sh
+#	 * page 0xfe
+#	 * 1920_1080_15fps_mipi 1920_1080_25fps_mipi
+#	 */
+#	/* END SENSOR_DELTAS */
+#
+# A delta holds the registers whose final value differs between the two
+# tables, each written once at the place of its last write in the target
+# table. Delays are kept when a register was written since the previous
+# one. The generated sensor_deltas[] is handed to the core by the
+# sensor_core_desc.
+
+CHECK=0
+if [ "$1" = "--check" ]; then
+	CHECK=1
+	shift
+fi
+
+[ $# -gt 0 ] || { echo "usage: $0 [--check] driver.c..." >&2; exit 2; }
+
+STALE=0
+for SRC in "$@"; do
+	[ -f "$SRC" ] || { echo "$0: $SRC missing" >&2; exit 2; }
+	grep -q '^/\* BEGIN SENSOR_DELTAS' "$SRC" || { echo "$0: $SRC has no SENSOR_DELTAS block" >&2; exit 2; }
+	TMP="$(mktemp)"
+
+	awk '
+	function norm(v) {
+		v = tolower(v)
+		sub(/^0x0*/, "", v)
+		return v == "" ? "0" : v
+	}
+	function special(r) {
+		return r !~ /^0[xX][0-9a-fA-F]+$/
+	}
+	# final value and index of the last write of every register of table t
+	function finals(t,    i, page, key) {
+		page = ""
+		for (i = 1; i <= n[t]; i++) {
+			if (special(reg[t, i]))
+				continue
+			if (pagereg != "" && norm(reg[t, i]) == pagereg) {
+				page = norm(val[t, i])
+				continue
+			}
+			key = page ":" norm(reg[t, i])
+			fin[t, key] = norm(val[t, i])
+			last[t, key] = i
+			keys[t, key] = 1
+		}
+	}
+	function delta(a, b,    i, page, pageval, outpage, key, wrote, k) {
+		finals(a)
+		finals(b)
+		for (k in keys)
+			if (index(k, a SUBSEP) == 1) {
+				key = substr(k, length(a SUBSEP) + 1)
+				if (!((b, key) in fin))
+					printf("%s: %s is set by %s but not by %s, not reverted\n",
+					       FILENAME, key, a, b) > "/dev/stderr"
+			}
+
+		print "static struct regval_list sensor_delta_" a "_to_" b "[] = {"
+		page = ""
+		outpage = ""
+		wrote = 0
+		for (i = 1; i <= n[b]; i++) {
+			if (reg[b, i] ~ /REG_END/)
+				break
+			if (special(reg[b, i])) {
+				if (wrote)
+					print "\t{" reg[b, i] ", " val[b, i] "},"
+				wrote = 0
+				continue
+			}
+			if (pagereg != "" && norm(reg[b, i]) == pagereg) {
+				page = norm(val[b, i])
+				pageval = val[b, i]
+				continue
+			}
+			key = page ":" norm(reg[b, i])
+			if (last[b, key] != i || ((a, key) in fin && fin[a, key] == fin[b, key]))
+				continue
+			if (pagereg != "" && outpage != page) {
+				print "\t{" pagetok ", " pageval "},"
+				outpage = page
+			}
+			print "\t{" reg[b, i] ", " val[b, i] "},"
+			wrote = 1
+		}
+		print "\t{" endtok ", 0x00},"
+		print "};"
+		print ""
+	}
+
+	# pass one, the tables and the switches asked for
+	FNR == NR {
+		if (/^\/\* BEGIN SENSOR_DELTAS/) {
+			spec = 1
+			next
+		}
+		if (spec) {
+			if ($0 ~ /^ \*\//) {
+				spec = 0
+				next
+			}
+			sub(/^ \* */, "")
+			if ($1 == "page") {
+				pagetok = $2
+				pagereg = norm($2)
+			} else if (NF == 2) {
+				pairs++
+				from[pairs] = $1
+				to[pairs] = $2
+			}
+			next
+		}
+		if (match($0, /^static struct regval_list sensor_init_regs_[A-Za-z0-9_]+\[\]/)) {
+			t = substr($0, 44, RLENGTH - 45)
+			n[t] = 0
+			next
+		}
+		if (t != "") {
+			if ($0 ~ /^};/) {
+				t = ""
+				next
+			}
+			line = $0
+			sub(/\/[\/*].*/, "", line)
+			gsub(/[ \t{}]/, "", line)
+			if (split(line, f, ",") >= 2 && f[1] != "") {
+				n[t]++
+				reg[t, n[t]] = f[1]
+				val[t, n[t]] = f[2]
+				if (f[1] ~ /REG_END/)
+					endtok = f[1]
+			}
+		}
+		next
+	}
+
+	# pass two, rewrite the generated part of the block
+	/^\/\* BEGIN SENSOR_DELTAS/ {
+		print
+		head = 1
+		next
+	}
+	head {
+		print
+		if ($0 ~ /^ \*\//) {
+			head = 0
+			skip = 1
+			if (endtok == "")
+				endtok = "SENSOR_REG_END"
+			for (p = 1; p <= pairs; p++) {
+				if (!(from[p] in n) || !(to[p] in n)) {
+					printf("%s: no table sensor_init_regs_%s or sensor_init_regs_%s\n",
+					       FILENAME, from[p], to[p]) > "/dev/stderr"
+					exit 2
+				}
+				delta(from[p], to[p])
+			}
+			print "static const struct sensor_core_delta sensor_deltas[] = {"
+			for (p = 1; p <= pairs; p++)
+				print "\t{sensor_init_regs_" from[p] ", sensor_init_regs_" to[p] \
+				      ", sensor_delta_" from[p] "_to_" to[p] "},"
+			print "};"
+		}
+		next
+	}
+	/^\/\* END SENSOR_DELTAS/ {
+		skip = 0
+	}
+	!skip {
+		print
+	}' "$SRC" "$SRC" > "$TMP" || { rm -f "$TMP"; exit 2; }
+
+	if cmp -s "$TMP" "$SRC"; then
+		rm -f "$TMP"
+		continue
+	fi
+
+	if [ $CHECK -eq 1 ]; then
+		rm -f "$TMP"
+		echo "$SRC is stale, run tools/gen-sensor-deltas.sh" >&2
+		STALE=1
+		continue
+	fi
+
+	cat "$TMP" > "$SRC"
+	rm -f "$TMP"
+done
+
+exit $STALE
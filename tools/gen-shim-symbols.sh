@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Regenerate the symbol table of include/tx-isp-shim.h from the wrappers
+# defined in common/tx-isp-shim.c.
+#
+# usage: gen-shim-symbols.sh [--check] [top directory]
+# With --check the header is not touched, the exit status is 1 if it is stale.
+
+CHECK=0
+if [ "$1" = "--check" ]; then
+	CHECK=1
+	shift
+fi
+
+TOP="${1:-$(dirname "$0")/..}"
+SRC="$TOP/common/tx-isp-shim.c"
+HDR="$TOP/include/tx-isp-shim.h"
+TMP="$(mktemp)"
+
+[ -f "$SRC" ] && [ -f "$HDR" ] || { echo "$0: $SRC or $HDR missing" >&2; exit 2; }
+
+grep -E '^[a-z][^;]*[ *]_*private_[a-z0-9_]+ *\(' "$SRC" | \
+	sed -E 's/^[^(]*[ *](_*private_[a-z0-9_]+) *\(.*/\1/' | \
+	awk '
+	BEGIN { print "#define TX_ISP_SHIM_SYMBOLS(X) \\" }
+	{ if (NR > 1) print line " \\"; line = "\tX(" $0 ")" }
+	END { print line }' > "$TMP.table"
+
+awk -v table="$TMP.table" '
+	/^\/\* BEGIN TX_ISP_SHIM_SYMBOLS/ { print; while ((getline l < table) > 0) print l; skip = 1; next }
+	/^\/\* END TX_ISP_SHIM_SYMBOLS/ { skip = 0 }
+	!skip { print }' "$HDR" > "$TMP"
+rm -f "$TMP.table"
+
+if cmp -s "$TMP" "$HDR"; then
+	rm -f "$TMP"
+	exit 0
+fi
+
+if [ $CHECK -eq 1 ]; then
+	rm -f "$TMP"
+	echo "$HDR is stale, run tools/gen-shim-symbols.sh" >&2
+	exit 1
+fi
+
+cat "$TMP" > "$HDR"
+rm -f "$TMP"
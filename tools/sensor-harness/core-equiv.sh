@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Check that the drivers converted to the sensor core write the same
+# registers, in the same order and with the same bytes, as before.
+#
+# usage: core-equiv.sh [-r rev] [soc/driver ...]
+#	-r rev		the conversion commit, the drivers of rev are run
+#			against the ones of its parent
+#
+# Both versions run the default scenario of sensor-harness.sh and their
+# traces are diffed: every i2c transfer with its bytes, the gpio and
+# clock changes and the virtual time of each. The exit status is 1 when
+# a trace differs. The chip ident handed to the isp is not bus traffic,
+# a change of it is printed but passes; the gc2053 of the parent of the
+# conversion reported only the low byte of its id, 0x53.
+
+HDIR="$(cd "$(dirname "$0")" && pwd)"
+# Add a shared sensor core and convert gc2053/sc2335 to it
+REV=53091a9
+
+while getopts r: opt; do
+	case $opt in
+	r) REV="$OPTARG" ;;
+	*) exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+[ $# -ge 1 ] || set -- t31/gc2053 t31/sc2335
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+bad=0
+for kernel in 3.10 4.4; do
+	for drv in "$@"; do
+		"$HDIR/sensor-harness.sh" -k $kernel -b "$REV^" "$drv" > "$WORK/old" 2> /dev/null && \
+		"$HDIR/sensor-harness.sh" -k $kernel -b "$REV" "$drv" > "$WORK/new" 2> /dev/null || {
+			echo "$kernel $drv: harness failed"
+			bad=1
+			continue
+		}
+		n=$(grep -c ' i2c ' "$WORK/new")
+		old=$(awk '$2 == "ident" { print $4 }' "$WORK/old")
+		new=$(awk '$2 == "ident" { print $4 }' "$WORK/new")
+		[ "$old" = "$new" ] || echo "$kernel $drv: ident $old, now $new"
+		sed -i '/^ *[0-9]* ident /d' "$WORK/old" "$WORK/new"
+		if diff -u "$WORK/old" "$WORK/new" > "$WORK/diff"; then
+			echo "$kernel $drv: identical, $n transfers"
+		else
+			echo "$kernel $drv: DIFFERS"
+			cat "$WORK/diff"
+			bad=1
+		fi
+	done
+done
+exit $bad
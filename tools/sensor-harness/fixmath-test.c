@@ -0,0 +1,163 @@
+/*
+ * Host check of include/tx-isp-fixmath.h against the math it replaced,
+ * fixmath-ref.h, and the time of both. Built and run by unit-test.sh.
+ *
+ * The 32 bit msb search is run on every input. The log2 result depends
+ * only on the msb and the 16 bits from it down, so one input per msb and
+ * mantissa covers every input; exp2 is run on every input whose result
+ * fits in 32 bits, for every shift_in up to 16.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <tx-isp-fixmath.h>
+#include "fixmath-ref.h"
+
+static unsigned long errors;
+static volatile uint32_t sink;
+
+#define CHECK(expr, ref, fmt, ...) do {						\
+	uint32_t __n = (expr), __r = (ref);					\
+	if (__n != __r && errors++ < 10)					\
+		printf("differs: " fmt ": %u, ref %u\n", ##__VA_ARGS__, __n, __r);	\
+} while (0)
+
+static double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* one input of each msb and mantissa, the bits below the mantissa vary */
+static uint32_t log2_input(unsigned int pos, uint32_t mant) {
+	if (pos <= 15)
+		return (mant | 1 << 15) >> (15 - pos);
+	return (mant | 1 << 15) << (pos - 15) | ((mant * 2654435761U) & ((1U << (pos - 15)) - 1));
+}
+
+static uint64_t log2_input_64(unsigned int pos, uint32_t mant) {
+	uint64_t low;
+
+	if (pos <= 15)
+		return (mant | 1 << 15) >> (15 - pos);
+	low = (uint64_t) mant * 0x9e3779b97f4a7c15ULL;
+	return (uint64_t) (mant | 1 << 15) << (pos - 15) | (low & ((1ULL << (pos - 15)) - 1));
+}
+
+static void test_leading_one(void) {
+	uint64_t v;
+	unsigned int p;
+
+	v = 0;
+	do {
+		CHECK(tx_isp_leading_one_position((uint32_t) v), ref_leading_one_position((uint32_t) v),
+		      "leading_one_position(%#x)", (uint32_t) v);
+	} while (++v <= 0xffffffffU);
+
+	CHECK(tx_isp_leading_one_position_64(0), ref_leading_one_position_64(0), "leading_one_position_64(0)");
+	for (p = 0; p < 64; p++) {
+		uint64_t b = 1ULL << p;
+		uint64_t m[3] = {b, b | (b - 1), b | (0x9e3779b97f4a7c15ULL & (b - 1))};
+		int i;
+
+		for (i = 0; i < 3; i++)
+			CHECK(tx_isp_leading_one_position_64(m[i]), ref_leading_one_position_64(m[i]),
+			      "leading_one_position_64(%#llx)", (unsigned long long) m[i]);
+	}
+}
+
+static void test_log2(void) {
+	static const uint8_t shifts[] = {0, 4, 8, 12, 15};
+	unsigned int prec, s, pos;
+	uint32_t mant, v;
+
+	for (prec = 0; prec <= 16; prec++) {
+		for (s = 0; s < sizeof(shifts); s++) {
+			CHECK(tx_isp_log2_int_to_fixed(0, prec, shifts[s]), ref_log2_int_to_fixed(0, prec, shifts[s]),
+			      "log2_int_to_fixed(0, %u, %u)", prec, shifts[s]);
+			for (pos = 0; pos < 32; pos++) {
+				for (mant = 0; mant < (pos < 15 ? 1U << pos : 1U << 15); mant++) {
+					v = log2_input(pos, pos < 15 ? mant << (15 - pos) : mant);
+					CHECK(tx_isp_log2_int_to_fixed(v, prec, shifts[s]),
+					      ref_log2_int_to_fixed(v, prec, shifts[s]),
+					      "log2_int_to_fixed(%#x, %u, %u)", v, prec, shifts[s]);
+				}
+			}
+		}
+	}
+
+	for (prec = 0; prec <= 16; prec += 8) {
+		for (s = 0; s < sizeof(shifts); s += 4) {
+			for (pos = 0; pos < 64; pos++) {
+				for (mant = 0; mant < (pos < 15 ? 1U << pos : 1U << 15); mant++) {
+					uint64_t v64 = log2_input_64(pos, pos < 15 ? mant << (15 - pos) : mant);
+
+					CHECK(tx_isp_log2_int_to_fixed_64(v64, prec, shifts[s]),
+					      ref_log2_int_to_fixed_64(v64, prec, shifts[s]),
+					      "log2_int_to_fixed_64(%#llx, %u, %u)", (unsigned long long) v64, prec, shifts[s]);
+				}
+			}
+		}
+	}
+}
+
+static void test_exp2(void) {
+	unsigned int in, out;
+	uint32_t v, end;
+
+	for (in = 0; in <= 16; in++) {
+		for (out = 0; out <= 30; out++) {
+			/* the integral part shifts the Q30 table entry up to 2^(30 - out) */
+			end = (31 - out) << in;
+			for (v = 0; v < end; v++)
+				CHECK(tx_isp_math_exp2(v, in, out), ref_math_exp2(v, in, out),
+				      "math_exp2(%#x, %u, %u)", v, in, out);
+		}
+	}
+}
+
+#define TIME(name, expr) do {							\
+	double t = now();							\
+	uint32_t acc = 0;							\
+	for (i = 0; i < n; i++)							\
+		acc += (expr);							\
+	sink = acc;								\
+	printf("%-28s %6.2f ns\n", name, (now() - t) * 1e9 / n);		\
+} while (0)
+
+static void bench(void) {
+	const unsigned int n = 1 << 24;
+	uint32_t *in = malloc(n * sizeof(*in));
+	unsigned int i;
+
+	/* the ae gains and exposures spread over the whole range */
+	for (i = 0; i < n; i++)
+		in[i] = (i * 2654435761U) >> (i & 31);
+
+	TIME("leading_one_position", tx_isp_leading_one_position(in[i]));
+	TIME("  ref", ref_leading_one_position(in[i]));
+	TIME("log2_int_to_fixed(16, 0)", tx_isp_log2_int_to_fixed(in[i], 16, 0));
+	TIME("  ref", ref_log2_int_to_fixed(in[i], 16, 0));
+	TIME("log2_int_to_fixed_64(16, 0)", tx_isp_log2_int_to_fixed_64((uint64_t) in[i] << 20, 16, 0));
+	TIME("  ref", ref_log2_int_to_fixed_64((uint64_t) in[i] << 20, 16, 0));
+	TIME("math_exp2(16, 10)", tx_isp_math_exp2(in[i] & 0xfffff, 16, 10));
+	TIME("  ref", ref_math_exp2(in[i] & 0xfffff, 16, 10));
+	free(in);
+}
+
+int main(void) {
+	test_leading_one();
+	test_log2();
+	test_exp2();
+	if (errors) {
+		printf("fixmath: %lu results differ\n", errors);
+		return 1;
+	}
+	printf("fixmath: same as the reference on every input\n");
+	bench();
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Host check of sensor_core_gain_index against the again_lut walk the
+ * drivers had before the sensor core, and the time of both. Built and
+ * run by unit-test.sh, which takes the lut and max_again of a driver into
+ * gain-lut.h and the function of sensor-core.c into gain-core.h.
+ *
+ * Both only change their answer at a gain of the table, so every input
+ * up to 64k past max_again is run, then every 4099th up to the top.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "gain-core.h"
+#include "gain-lut.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define UNDEFINED -2
+
+static unsigned long errors;
+static unsigned long undefined;
+static volatile int sink;
+
+static double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * The walk of sensor_alloc_again as it was, on the gains of the table and
+ * a sentinel, returning the index it took the gain from, -1 where it gave
+ * isp_gain back and UNDEFINED where it read the entry before the table.
+ */
+static int ref_gain_walk(const unsigned int *gain, unsigned int max_gain, unsigned int isp_gain) {
+	const unsigned int *lut = gain;
+
+	while (*lut <= max_gain) {
+		if (isp_gain == 0) {
+			return 0;
+		} else if (isp_gain < *lut) {
+			return lut == gain ? UNDEFINED : lut - 1 - gain;
+		} else {
+			if ((*lut == max_gain) && (isp_gain >= *lut))
+				return lut - gain;
+		}
+		lut++;
+	}
+	return -1;
+}
+
+static void check(const char *name, const void *lut, const unsigned int *gain, unsigned int n,
+		  size_t stride, size_t offset, unsigned int max_gain, unsigned int isp_gain) {
+	int i = sensor_core_gain_index(lut, n, stride, offset, max_gain, isp_gain);
+	int r = ref_gain_walk(gain, max_gain, isp_gain);
+
+	/* the walk read lut[-1], the core gives the first entry */
+	if (r == UNDEFINED) {
+		undefined++;
+		r = 0;
+	}
+	if (i != r && errors++ < 10)
+		printf("differs: %s max %u gain %u: %d, ref %d\n", name, max_gain, isp_gain, i, r);
+}
+
+static void sweep(const char *name, const void *lut, const unsigned int *gain, unsigned int n,
+		  size_t stride, size_t offset, unsigned int max_gain) {
+	uint64_t v;
+
+	for (v = 0; v <= (uint64_t) max_gain + 65536; v++)
+		check(name, lut, gain, n, stride, offset, max_gain, v);
+	for (; v <= 0xffffffffU; v += 4099)
+		check(name, lut, gain, n, stride, offset, max_gain, v);
+	check(name, lut, gain, n, stride, offset, max_gain, 0xffffffffU);
+}
+
+/* the corners the driver tables do not have, a sentinel ends each */
+struct synth {
+	const char *name;
+	unsigned int max_gain;
+	unsigned int gain[8];
+	unsigned int n;
+};
+
+static const struct synth synth[] = {
+	{"first gain above 0", 300, {100, 200, 300, 400, ~0U}, 4},
+	{"max_gain repeated", 20, {0, 10, 20, 20, 20, 30, ~0U}, 6},
+	{"max_gain not in the table", 20, {0, 10, 30, ~0U}, 3},
+	{"max_gain past the table", 25, {0, 10, 20, ~0U}, 3},
+	{"one entry", 0, {0, ~0U}, 1},
+};
+
+static void bench(const unsigned int *gain) {
+	const unsigned int n = 1 << 22;
+	unsigned int *in = malloc(n * sizeof(*in));
+	unsigned int i;
+	double t;
+	int acc;
+
+	for (i = 0; i < n; i++)
+		in[i] = (i * 2654435761U) % (MAX_AGAIN + 65536);
+
+	t = now();
+	for (i = 0, acc = 0; i < n; i++)
+		acc += sensor_core_again_index(sensor_again_lut, MAX_AGAIN, in[i]);
+	sink = acc;
+	printf("%-28s %6.2f ns\n", "sensor_core_gain_index", (now() - t) * 1e9 / n);
+
+	t = now();
+	for (i = 0, acc = 0; i < n; i++)
+		acc += ref_gain_walk(gain, MAX_AGAIN, in[i]);
+	sink = acc;
+	printf("%-28s %6.2f ns\n", "  ref", (now() - t) * 1e9 / n);
+	free(in);
+}
+
+int main(void) {
+	unsigned int n = ARRAY_SIZE(sensor_again_lut);
+	unsigned int *gain = malloc((n + 1) * sizeof(*gain));
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		gain[i] = sensor_again_lut[i].gain;
+	gain[n] = ~0U;
+
+	sweep(LUT_NAME, sensor_again_lut, gain, n, sizeof(sensor_again_lut[0]),
+	      offsetof(struct again_lut, gain), MAX_AGAIN);
+	if (errors) {
+		printf("%s gain: %lu results differ\n", LUT_NAME, errors);
+		return 1;
+	}
+	printf("%s gain: %u entries, lut[0].gain %u, same as the walk on every input,"
+	       " %lu read before the table\n", LUT_NAME, n, gain[0], undefined);
+
+	undefined = 0;
+	for (i = 0; i < ARRAY_SIZE(synth); i++)
+		sweep(synth[i].name, synth[i].gain, synth[i].gain, synth[i].n,
+		      sizeof(unsigned int), 0, synth[i].max_gain);
+	if (errors) {
+		printf("corner cases: %lu results differ\n", errors);
+		return 1;
+	}
+	printf("corner cases: same as the walk, %lu inputs below lut[0].gain get entry 0"
+	       " where the walk read before the table\n", undefined);
+	bench(gain);
+	free(gain);
+
+	return 0;
+}
@@ -0,0 +1,534 @@
+/*
+ * The kernel as far as the sensor drivers and the isp headers see it,
+ * forced into every file the harness builds. The kernel headers they
+ * include are generated empty by sensor-harness.sh, so everything they
+ * would declare is here; the functions are in host.c.
+ *
+ * Only what the drivers use is provided, a driver that fails to build
+ * needs its piece added here and not in the driver.
+ */
+#ifndef HOST_KERNEL_H
+#define HOST_KERNEL_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+/* types */
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef uint8_t __u8;
+typedef uint16_t __u16;
+typedef uint32_t __u32;
+typedef uint64_t __u64;
+typedef int32_t __s32;
+typedef unsigned short umode_t;
+typedef unsigned int gfp_t;
+typedef unsigned long dma_addr_t;
+typedef unsigned long phys_addr_t;
+typedef unsigned long phys_t;
+typedef unsigned long resource_size_t;
+typedef void *fl_owner_t;
+typedef struct { unsigned long seg; } mm_segment_t;
+typedef int irqreturn_t;
+typedef irqreturn_t (*irq_handler_t)(int, void *);
+typedef struct { int locked; } spinlock_t;
+typedef struct { int unused; } wait_queue_head_t;
+typedef s64 ktime_t;
+typedef int atomic_t;
+
+#define __user
+#define __iomem
+#define __init
+#define __exit
+#define __devinit
+#define __devexit
+#define __must_check
+#define __maybe_unused __attribute__((unused))
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#ifndef offsetof
+#define offsetof(type, member) __builtin_offsetof(type, member)
+#endif
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min_t(t, a, b) min((t)(a), (t)(b))
+#define max_t(t, a, b) max((t)(a), (t)(b))
+#define clamp(v, lo, hi) min(max(v, lo), hi)
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define BIT(n) (1UL << (n))
+#define BUG_ON(c) do { if (c) abort(); } while (0)
+#define WARN_ON(c) ({ int __c = !!(c); if (__c) fprintf(stderr, "WARN_ON %s:%d\n", __FILE__, __LINE__); __c; })
+#define do_div(n, base) ({ uint32_t __r = (n) % (base); (n) /= (base); __r; })
+#define div_u64(n, d) ((u64)(n) / (d))
+#define div_s64(n, d) ((s64)(n) / (d))
+
+/* errno, the kernel values */
+#define EPERM		1
+#define ENOENT		2
+#define EIO		5
+#define ENXIO		6
+#define EAGAIN		11
+#define ENOMEM		12
+#define EFAULT		14
+#define EBUSY		16
+#define ENODEV		19
+#define EINVAL		22
+#define ERANGE		34
+#define ENOSYS		38
+#define ETIMEDOUT	110
+#define EREMOTEIO	121
+#define ENOIOCTLCMD	515
+
+#define MAX_ERRNO 4095
+#define IS_ERR_VALUE(x) ((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
+static inline void *ERR_PTR(long error) { return (void *)error; }
+static inline long PTR_ERR(const void *ptr) { return (long)ptr; }
+static inline bool IS_ERR(const void *ptr) { return IS_ERR_VALUE(ptr); }
+static inline bool IS_ERR_OR_NULL(const void *ptr) { return !ptr || IS_ERR_VALUE(ptr); }
+
+/* printing, the trace is on stdout and the driver messages on stderr */
+#define KERN_EMERG	""
+#define KERN_ALERT	""
+#define KERN_CRIT	""
+#define KERN_ERR	""
+#define KERN_WARNING	""
+#define KERN_NOTICE	""
+#define KERN_INFO	""
+#define KERN_DEBUG	""
+#define printk(...) fprintf(stderr, __VA_ARGS__)
+#define pr_emerg(...) printk(__VA_ARGS__)
+#define pr_err(...) printk(__VA_ARGS__)
+#define pr_warning(...) printk(__VA_ARGS__)
+#define pr_warn(...) printk(__VA_ARGS__)
+#define pr_notice(...) printk(__VA_ARGS__)
+#define pr_info(...) printk(__VA_ARGS__)
+#define pr_debug(...) do { if (0) printk(__VA_ARGS__); } while (0)
+#define dev_err(dev, ...) printk(__VA_ARGS__)
+#define dev_info(dev, ...) printk(__VA_ARGS__)
+#define dev_dbg(dev, ...) pr_debug(__VA_ARGS__)
+
+/* modules, module_init names the entry point of the harness */
+struct module;
+#define THIS_MODULE ((struct module *)0)
+#define MODULE_LICENSE(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_VERSION(x)
+#define MODULE_PARM_DESC(name, desc)
+#define MODULE_DEVICE_TABLE(type, name)
+#define EXPORT_SYMBOL(sym)
+#define EXPORT_SYMBOL_GPL(sym)
+#define module_init(fn) int (*harness_module_init)(void) = fn
+#define module_exit(fn) void (*harness_module_exit)(void) = fn
+
+/* module parameters, set by the param command of a scenario */
+void harness_param_add(const char *name, void *addr, size_t size, const char *type,
+		       unsigned int n);
+#define __harness_param(name, addr, type, n)					\
+	static void __attribute__((constructor)) harness_param_##name(void) {	\
+		harness_param_add(#name, addr, sizeof(*(addr)), #type, n);	\
+	}
+#define module_param(name, type, perm) __harness_param(name, &(name), type, 1)
+#define module_param_array(name, type, nump, perm)				\
+	__harness_param(name, &(name)[0], type, ARRAY_SIZE(name))
+
+/* memory and strings */
+#define GFP_KERNEL	0
+#define GFP_ATOMIC	0
+void *kmalloc(size_t size, gfp_t flags);
+void *kzalloc(size_t size, gfp_t flags);
+void kfree(const void *p);
+void *vmalloc(unsigned long size);
+void vfree(const void *p);
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+/* time, a virtual clock the bus and the sleeps advance */
+u64 harness_now_ns(void);
+void harness_delay_us(unsigned long us);
+#define HZ 100
+#define jiffies ((unsigned long)(harness_now_ns() / (1000000000 / HZ)))
+#define msecs_to_jiffies(ms) ((unsigned long)(ms) / (1000 / HZ))
+#define udelay(us) harness_delay_us(us)
+#define ndelay(ns) harness_delay_us(((ns) + 999) / 1000)
+#define mdelay(ms) harness_delay_us((ms) * 1000UL)
+#define msleep(ms) harness_delay_us((ms) * 1000UL)
+#define usleep_range(lo, hi) harness_delay_us(lo)
+#define ktime_get() ((ktime_t)harness_now_ns())
+#define ktime_sub(a, b) ((a) - (b))
+#define ktime_to_us(t) ((s64)(t) / 1000)
+#define ktime_to_ns(t) ((s64)(t))
+#define ktime_us_delta(a, b) ktime_to_us(ktime_sub(a, b))
+enum hrtimer_mode { HRTIMER_MODE_ABS, HRTIMER_MODE_REL };
+
+/* bitops */
+#define BITS_PER_LONG (8 * sizeof(long))
+static inline int test_and_set_bit(int nr, unsigned long *addr) {
+	unsigned long mask = 1UL << (nr % BITS_PER_LONG);
+	unsigned long *p = addr + nr / BITS_PER_LONG;
+	int old = !!(*p & mask);
+
+	*p |= mask;
+	return old;
+}
+static inline void clear_bit(int nr, unsigned long *addr) {
+	addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+static inline void set_bit(int nr, unsigned long *addr) {
+	addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+static inline int test_bit(int nr, const unsigned long *addr) {
+	return !!(addr[nr / BITS_PER_LONG] & (1UL << (nr % BITS_PER_LONG)));
+}
+
+static inline int fls(unsigned int x) {
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+static inline int fls64(u64 x) {
+	return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+/* lists and locks, the harness is single threaded */
+struct list_head { struct list_head *next, *prev; };
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+#define INIT_LIST_HEAD(l) do { (l)->next = (l); (l)->prev = (l); } while (0)
+struct mutex { int locked; };
+struct lock_class_key { int unused; };
+#define DEFINE_MUTEX(m) struct mutex m
+#define mutex_init(m) ((m)->locked = 0)
+#define mutex_lock(m) ((void)(m))
+#define mutex_unlock(m) ((void)(m))
+#define spin_lock_init(l) ((l)->locked = 0)
+#define spin_lock_irqsave(l, f) ((void)(l), (f) = 0)
+#define spin_unlock_irqrestore(l, f) ((void)(l), (void)(f))
+#define CAP_SYS_ADMIN 21
+bool capable(int cap);
+
+/* completions and work, queued work runs when it is waited for */
+struct completion { unsigned int done; };
+#define init_completion(x) ((x)->done = 0)
+#define reinit_completion(x) ((x)->done = 0)
+#define INIT_COMPLETION(x) ((x).done = 0)
+#define completion_done(x) ((x)->done != 0)
+void complete(struct completion *x);
+void complete_all(struct completion *x);
+void wait_for_completion(struct completion *x);
+unsigned long wait_for_completion_timeout(struct completion *x, unsigned long timeout);
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+struct work_struct {
+	work_func_t func;
+	struct work_struct *next;
+	int pending;
+};
+struct workqueue_struct;
+#define INIT_WORK(w, f) do { (w)->func = (f); (w)->next = NULL; (w)->pending = 0; } while (0)
+struct workqueue_struct *alloc_ordered_workqueue(const char *fmt, unsigned int flags, ...);
+#define create_singlethread_workqueue(name) alloc_ordered_workqueue("%s", 0, name)
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work);
+bool schedule_work(struct work_struct *work);
+void flush_workqueue(struct workqueue_struct *wq);
+void destroy_workqueue(struct workqueue_struct *wq);
+
+struct task_struct;
+struct sk_buff;
+struct nlmsghdr;
+struct sock;
+struct socket;
+struct net;
+struct netlink_kernel_cfg;
+struct vm_area_struct;
+struct poll_table_struct;
+
+/* devices */
+struct device {
+	void *driver_data;
+	void *platform_data;
+	u64 *dma_mask;
+	u64 coherent_dma_mask;
+	void (*release)(struct device *dev);
+};
+
+struct resource {
+	resource_size_t start;
+	resource_size_t end;
+	const char *name;
+	unsigned long flags;
+};
+#define IORESOURCE_MEM	0x00000200
+#define IORESOURCE_IRQ	0x00000400
+
+struct platform_device {
+	const char *name;
+	int id;
+	struct device dev;
+	unsigned int num_resources;
+	struct resource *resource;
+};
+
+struct platform_driver {
+	int (*probe)(struct platform_device *);
+	int (*remove)(struct platform_device *);
+	struct {
+		const char *name;
+		struct module *owner;
+	} driver;
+};
+
+struct file;
+struct inode {
+	void *i_private;
+};
+struct file_operations {
+	struct module *owner;
+	loff_t (*llseek)(struct file *, loff_t, int);
+	ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
+	ssize_t (*write)(struct file *, const char __user *, size_t, loff_t *);
+	unsigned int (*poll)(struct file *, struct poll_table_struct *);
+	long (*unlocked_ioctl)(struct file *, unsigned int, unsigned long);
+	int (*mmap)(struct file *, struct vm_area_struct *);
+	int (*open)(struct inode *, struct file *);
+	int (*release)(struct inode *, struct file *);
+};
+struct file {
+	void *private_data;
+	const struct file_operations *f_op;
+};
+
+struct miscdevice {
+	int minor;
+	const char *name;
+	const struct file_operations *fops;
+	struct device *this_device;
+};
+
+/* proc, seq_file and the user copies */
+struct proc_dir_entry;
+struct seq_file {
+	void *private;
+};
+struct proc_dir_entry *proc_mkdir(const char *name, struct proc_dir_entry *parent);
+struct proc_dir_entry *proc_create_data(const char *name, umode_t mode, struct proc_dir_entry *parent,
+					const struct file_operations *fops, void *data);
+#define proc_create(name, mode, parent, fops) proc_create_data(name, mode, parent, fops, NULL)
+void remove_proc_entry(const char *name, struct proc_dir_entry *parent);
+void proc_remove(struct proc_dir_entry *de);
+#define PDE_DATA(inode) ((inode)->i_private)
+int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data);
+int single_release(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char __user *buf, size_t size, loff_t *ppos);
+loff_t seq_lseek(struct file *file, loff_t offset, int whence);
+int seq_printf(struct seq_file *m, const char *fmt, ...);
+#define seq_puts(m, s) seq_printf(m, "%s", s)
+ssize_t simple_read_from_buffer(void __user *to, size_t count, loff_t *ppos,
+				const void *from, size_t available);
+#define copy_to_user(to, from, n) (memcpy(to, from, n), 0)
+#define copy_from_user(to, from, n) (memcpy(to, from, n), 0)
+
+/* clocks */
+struct clk;
+struct clk *clk_get(struct device *dev, const char *id);
+void clk_put(struct clk *clk);
+int clk_enable(struct clk *clk);
+void clk_disable(struct clk *clk);
+int clk_prepare_enable(struct clk *clk);
+void clk_disable_unprepare(struct clk *clk);
+int clk_set_rate(struct clk *clk, unsigned long rate);
+unsigned long clk_get_rate(struct clk *clk);
+long clk_round_rate(struct clk *clk, unsigned long rate);
+int clk_set_parent(struct clk *clk, struct clk *parent);
+struct clk *clk_get_parent(struct clk *clk);
+
+/* gpio */
+enum gpio_port {
+	GPIO_PORT_A, GPIO_PORT_B, GPIO_PORT_C, GPIO_PORT_D,
+	GPIO_PORT_E, GPIO_PORT_F, GPIO_PORT_G,
+};
+enum gpio_function {
+	GPIO_FUNC_0 = 0x00,
+	GPIO_FUNC_1 = 0x01,
+	GPIO_FUNC_2 = 0x02,
+	GPIO_FUNC_3 = 0x03,
+	GPIO_OUTPUT0 = 0x04,
+	GPIO_OUTPUT1 = 0x05,
+	GPIO_INPUT = 0x06,
+};
+#define GPIO_PA(n) (0 * 32 + (n))
+#define GPIO_PB(n) (1 * 32 + (n))
+#define GPIO_PC(n) (2 * 32 + (n))
+#define GPIO_PD(n) (3 * 32 + (n))
+int gpio_request(unsigned gpio, const char *label);
+void gpio_free(unsigned gpio);
+int gpio_direction_output(unsigned gpio, int value);
+int gpio_direction_input(unsigned gpio);
+void gpio_set_value(unsigned gpio, int value);
+int gpio_get_value(unsigned gpio);
+
+/* i2c */
+#define I2C_NAME_SIZE	20
+#define I2C_M_RD	0x0001
+#define I2C_M_TEN	0x0010
+struct i2c_msg {
+	u16 addr;
+	u16 flags;
+	u16 len;
+	u8 *buf;
+};
+struct i2c_adapter {
+	int nr;
+	char name[48];
+};
+struct i2c_client {
+	unsigned short flags;
+	unsigned short addr;
+	char name[I2C_NAME_SIZE];
+	struct i2c_adapter *adapter;
+	struct device dev;
+};
+struct i2c_device_id {
+	char name[I2C_NAME_SIZE];
+	unsigned long driver_data;
+};
+struct i2c_board_info {
+	char type[I2C_NAME_SIZE];
+	unsigned short flags;
+	unsigned short addr;
+	void *platform_data;
+};
+struct i2c_driver {
+	int (*probe)(struct i2c_client *, const struct i2c_device_id *);
+	int (*remove)(struct i2c_client *);
+	struct {
+		const char *name;
+		struct module *owner;
+	} driver;
+	const struct i2c_device_id *id_table;
+};
+int i2c_add_driver(struct i2c_driver *drv);
+void i2c_del_driver(struct i2c_driver *drv);
+int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num);
+#define i2c_get_clientdata(c) private_i2c_get_clientdata(c)
+#define i2c_set_clientdata(c, d) private_i2c_set_clientdata(c, d)
+
+/* spi, named by the board info only */
+#define SPI_NAME_SIZE	32
+
+/* dma */
+enum dma_data_direction {
+	DMA_BIDIRECTIONAL = 0,
+	DMA_TO_DEVICE = 1,
+	DMA_FROM_DEVICE = 2,
+	DMA_NONE = 3,
+};
+
+/* ioctl numbers */
+#define _IOC(dir, type, nr, size) \
+	(((dir) << 30) | ((type) << 8) | (nr) | ((size) << 16))
+#define _IO(type, nr) _IOC(0U, (type), (nr), 0)
+#define _IOW(type, nr, t) _IOC(1U, (type), (nr), sizeof(t))
+#define _IOR(type, nr, t) _IOC(2U, (type), (nr), sizeof(t))
+#define _IOWR(type, nr, t) _IOC(3U, (type), (nr), sizeof(t))
+
+/* v4l2, the formats and structs the isp headers name */
+#define BASE_VIDIOC_PRIVATE 192
+#define v4l2_fourcc(a, b, c, d) \
+	((u32)(a) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
+enum v4l2_colorspace {
+	V4L2_COLORSPACE_SMPTE170M = 1,
+	V4L2_COLORSPACE_SMPTE240M = 2,
+	V4L2_COLORSPACE_REC709 = 3,
+	V4L2_COLORSPACE_BT878 = 4,
+	V4L2_COLORSPACE_470_SYSTEM_M = 5,
+	V4L2_COLORSPACE_470_SYSTEM_BG = 6,
+	V4L2_COLORSPACE_JPEG = 7,
+	V4L2_COLORSPACE_SRGB = 8,
+};
+enum v4l2_field {
+	V4L2_FIELD_ANY = 0,
+	V4L2_FIELD_NONE = 1,
+};
+#ifndef HARNESS_ISP_MBUS	/* the 4.4 t31 headers declare it */
+enum v4l2_mbus_pixelcode {
+	V4L2_MBUS_FMT_FIXED = 0x0001,
+	V4L2_MBUS_FMT_RGB565_2X8_LE = 0x1008,
+	V4L2_MBUS_FMT_Y8_1X8 = 0x2001,
+	V4L2_MBUS_FMT_UYVY8_2X8 = 0x2006,
+	V4L2_MBUS_FMT_VYUY8_2X8 = 0x2007,
+	V4L2_MBUS_FMT_YUYV8_2X8 = 0x2008,
+	V4L2_MBUS_FMT_YVYU8_2X8 = 0x2009,
+	V4L2_MBUS_FMT_YUYV8_1X16 = 0x2011,
+	V4L2_MBUS_FMT_SBGGR8_1X8 = 0x3001,
+	V4L2_MBUS_FMT_SGBRG8_1X8 = 0x3013,
+	V4L2_MBUS_FMT_SGRBG8_1X8 = 0x3002,
+	V4L2_MBUS_FMT_SRGGB8_1X8 = 0x3014,
+	V4L2_MBUS_FMT_SBGGR10_1X10 = 0x3007,
+	V4L2_MBUS_FMT_SGBRG10_1X10 = 0x300e,
+	V4L2_MBUS_FMT_SGRBG10_1X10 = 0x300a,
+	V4L2_MBUS_FMT_SRGGB10_1X10 = 0x300f,
+	V4L2_MBUS_FMT_SBGGR12_1X12 = 0x3008,
+	V4L2_MBUS_FMT_SGBRG12_1X12 = 0x3010,
+	V4L2_MBUS_FMT_SGRBG12_1X12 = 0x3011,
+	V4L2_MBUS_FMT_SRGGB12_1X12 = 0x3012,
+};
+#endif
+struct v4l2_mbus_framefmt {
+	u32 width;
+	u32 height;
+	u32 code;
+	u32 field;
+	u32 colorspace;
+	u32 reserved[7];
+};
+struct v4l2_control {
+	u32 id;
+	s32 value;
+};
+struct v4l2_pix_format {
+	u32 width;
+	u32 height;
+	u32 pixelformat;
+	u32 field;
+	u32 bytesperline;
+	u32 sizeimage;
+	u32 colorspace;
+	u32 priv;
+};
+struct v4l2_format {
+	u32 type;
+	union {
+		struct v4l2_pix_format pix;
+		u8 raw_data[200];
+	} fmt;
+};
+
+/* the mmio of the inline helpers, the harness maps the registers they touch */
+#define __raw_readl(a) (*(volatile u32 *)(a))
+#define __raw_writel(v, a) (*(volatile u32 *)(a) = (v))
+#define __raw_readw(a) (*(volatile u16 *)(a))
+#define __raw_writew(v, a) (*(volatile u16 *)(a) = (v))
+#define __raw_readb(a) (*(volatile u8 *)(a))
+#define __raw_writeb(v, a) (*(volatile u8 *)(a) = (v))
+#define readl(a) __raw_readl(a)
+#define writel(v, a) __raw_writel(v, a)
+#define PAGE_OFFSET 0x80000000UL
+#define PHYS_OFFSET 0UL
+
+#endif /* HOST_KERNEL_H */
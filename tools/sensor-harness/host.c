@@ -0,0 +1,992 @@
+/*
+ * Host side of the sensor harness: the private_* wrappers and kernel
+ * calls a sensor driver makes, a fake sensor on a mocked I2C bus and a
+ * scenario runner. Every bus transaction, gpio change and sleep goes
+ * to the trace on stdout with a virtual timestamp, so two runs of the
+ * same scenario give the same trace.
+ *
+ * The bus time is modelled: 9 bits per byte, the address byte included,
+ * a bit for every start and stop, at the bus clock of the scenario, and
+ * an optional fixed cost per i2c_transfer call.
+ */
+#include <signal.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <tx-isp-common.h>
+#include "soc.h"
+
+/* trees older than the shared fixed point math get the code it replaced */
+#ifdef HARNESS_FIXMATH
+#include <tx-isp-fixmath.h>
+#else
+#include "fixmath-ref.h"
+#define tx_isp_math_exp2 ref_math_exp2
+#define tx_isp_log2_int_to_fixed ref_log2_int_to_fixed
+#endif
+
+/* the shift of the isp gains, t30 and older have no name for it */
+#ifndef LOG2_GAIN_SHIFT
+#define LOG2_GAIN_SHIFT 16
+#endif
+
+/* the init and s_stream ops of t40 and later take a struct tx_isp_initarg */
+#ifdef HARNESS_INITARG
+#define ENABLE_ARG(v) (&(struct tx_isp_initarg){ .enable = (v) })
+#else
+#define ENABLE_ARG(v) (v)
+#endif
+
+/* virtual clock */
+static u64 now_ns;
+
+u64 harness_now_ns(void) {
+	return now_ns;
+}
+
+/* trace and per step counts */
+struct harness_stats {
+	unsigned int xfers;
+	unsigned int msgs;
+	unsigned int bytes;
+	unsigned int writes;		/* registers written */
+	unsigned int reads;		/* registers read */
+	u64 bus_ns;
+	u64 sleep_ns;
+};
+
+static struct harness_stats step, total;
+static int verbose = 1;
+
+static void trace(const char *fmt, ...) {
+	va_list ap;
+
+	if (!verbose)
+		return;
+	printf("%10llu ", (unsigned long long)(now_ns / 1000));
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+}
+
+void harness_delay_us(unsigned long us) {
+	now_ns += (u64)us * 1000;
+	step.sleep_ns += (u64)us * 1000;
+	trace("sleep %lu us", us);
+}
+
+/* the fake sensor, a register file with optional pages */
+#define FAKE_KEYS (1 << 24)
+
+static u8 fake_val[FAKE_KEYS];
+static u8 fake_set[FAKE_KEYS];
+static u64 fake_state;			/* xor of the hashes of all set registers */
+static int fake_abytes = 2;		/* register address bytes */
+static int fake_page_reg = -1;
+static unsigned int fake_page;
+static unsigned int fake_ptr;		/* the address of the next access */
+static u8 fake_unset;			/* read from a register never written, marked ? */
+static unsigned int bus_khz = 400;
+static unsigned int bus_xfer_us;
+static unsigned int bus_nak;		/* the next transfers that fail */
+
+static u64 fake_hash(unsigned int key, u8 val) {
+	u64 h = 1469598103934665603ULL;
+
+	h = (h ^ key) * 1099511628211ULL;
+	h = (h ^ val) * 1099511628211ULL;
+	return h ^ (h >> 29);
+}
+
+static unsigned int fake_key(unsigned int reg) {
+	if ((int)reg == fake_page_reg)
+		return reg;
+	return (fake_page & 0xff) << 16 | (reg & 0xffff);
+}
+
+static void fake_store(unsigned int key, u8 val) {
+	if (fake_set[key])
+		fake_state ^= fake_hash(key, fake_val[key]);
+	fake_val[key] = val;
+	fake_set[key] = 1;
+	fake_state ^= fake_hash(key, val);
+}
+
+static void fake_write(unsigned int reg, u8 val) {
+	if ((int)reg == fake_page_reg)
+		fake_page = val;
+	fake_store(fake_key(reg), val);
+}
+
+static void bus_account(struct i2c_msg *msgs, int num) {
+	u64 bits = 1;			/* stop */
+	int i;
+
+	for (i = 0; i < num; i++)
+		bits += 1 + 9 * (1 + msgs[i].len);
+	step.xfers++;
+	step.msgs += num;
+	step.bus_ns += bits * 1000000 / bus_khz + (u64)bus_xfer_us * 1000;
+	now_ns += bits * 1000000 / bus_khz + (u64)bus_xfer_us * 1000;
+}
+
+int private_i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num) {
+	char line[512];
+	int i, j, n;
+
+	if (bus_nak) {
+		bus_nak--;
+		bus_account(msgs, num);
+		trace("i2c %02x nak", msgs[0].addr);
+		return -EREMOTEIO;
+	}
+	for (i = 0; i < num; i++) {
+		struct i2c_msg *msg = &msgs[i];
+
+		step.bytes += msg->len;
+		if (msg->flags & I2C_M_RD) {
+			n = snprintf(line, sizeof(line), "i2c %02x r 0x%0*x =", msg->addr,
+				     fake_abytes * 2, fake_ptr);
+			for (j = 0; j < msg->len; j++, fake_ptr++) {
+				unsigned int key = fake_key(fake_ptr);
+
+				msg->buf[j] = fake_set[key] ? fake_val[key] : fake_unset;
+				if (n < (int)sizeof(line) - 4)
+					n += snprintf(line + n, sizeof(line) - n, fake_set[key] ? " %02x" : " %02x?",
+						      msg->buf[j]);
+			}
+			step.reads += msg->len;
+			trace("%s", line);
+			continue;
+		}
+
+		if (msg->len < fake_abytes) {
+			trace("i2c %02x w short message of %u bytes", msg->addr, msg->len);
+			continue;
+		}
+		fake_ptr = 0;
+		for (j = 0; j < fake_abytes; j++)
+			fake_ptr = fake_ptr << 8 | msg->buf[j];
+		if (msg->len == fake_abytes)
+			continue;	/* sets the address of a read */
+		n = snprintf(line, sizeof(line), "i2c %02x w 0x%0*x =", msg->addr,
+			     fake_abytes * 2, fake_ptr);
+		for (j = fake_abytes; j < msg->len; j++, fake_ptr++) {
+			fake_write(fake_ptr, msg->buf[j]);
+			if (n < (int)sizeof(line) - 4)
+				n += snprintf(line + n, sizeof(line) - n, " %02x", msg->buf[j]);
+		}
+		step.writes += msg->len - fake_abytes;
+		trace("%s", line);
+	}
+	bus_account(msgs, num);
+
+	return num;
+}
+
+/* the module parameters of the driver */
+struct harness_param {
+	const char *name;
+	void *addr;
+	size_t size;
+	const char *type;
+	unsigned int n;
+};
+
+static struct harness_param params[32];
+static unsigned int nr_params;
+
+void harness_param_add(const char *name, void *addr, size_t size, const char *type,
+		       unsigned int n) {
+	if (nr_params == ARRAY_SIZE(params))
+		return;
+	params[nr_params++] = (struct harness_param) {name, addr, size, type, n};
+}
+
+static int param_set(const char *name, char *values) {
+	struct harness_param *p = NULL;
+	unsigned int i;
+	char *v;
+
+	for (i = 0; i < nr_params; i++)
+		if (!strcmp(params[i].name, name))
+			p = &params[i];
+	if (!p)
+		return -1;
+
+	for (i = 0, v = strtok(values, ","); v && i < p->n; i++, v = strtok(NULL, ",")) {
+		char *addr = (char *)p->addr + i * p->size;
+
+		if (!strcmp(p->type, "charp")) {
+			*(char **)addr = strdup(v);
+		} else if (p->size == 1) {
+			*(u8 *)addr = strtoul(v, NULL, 0);
+		} else if (p->size == 2) {
+			*(u16 *)addr = strtoul(v, NULL, 0);
+		} else {
+			*(u32 *)addr = strtoul(v, NULL, 0);
+		}
+	}
+
+	return 0;
+}
+
+/* the subdev of the probed sensor and the isp side of it */
+static struct i2c_driver *driver;
+static struct i2c_adapter adapter = {0, "harness"};
+static struct i2c_client client;
+static struct tx_isp_subdev *subdev;
+
+static int isp_notify(struct tx_isp_module *module, unsigned int notification, void *data) {
+	struct tx_isp_video_in *video = data;
+
+	if (notification == TX_ISP_EVENT_SYNC_SENSOR_ATTR && video && video->attr) {
+		trace("notify sync_sensor_attr %ux%u fps %u/%u vts %u max_it %u",
+		      video->mbus.width, video->mbus.height, video->fps >> 16, video->fps & 0xffff,
+		      video->attr->total_height, video->attr->max_integration_time);
+	} else {
+		trace("notify 0x%x", notification);
+	}
+
+	return 0;
+}
+
+int tx_isp_subdev_init(struct platform_device *pdev, struct tx_isp_subdev *sd,
+		       struct tx_isp_subdev_ops *ops) {
+	sd->ops = ops;
+	sd->module.notify = isp_notify;
+	subdev = sd;
+
+	return 0;
+}
+
+void tx_isp_subdev_deinit(struct tx_isp_subdev *sd) {
+	subdev = NULL;
+}
+
+int isp_printf(unsigned int level, unsigned char *fmt, ...) {
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, (const char *)fmt, ap);
+	va_end(ap);
+
+	return 0;
+}
+
+int private_driver_get_interface(void) {
+	return 0;
+}
+
+int private_i2c_add_driver(struct i2c_driver *drv) {
+	driver = drv;
+	return 0;
+}
+
+void private_i2c_del_driver(struct i2c_driver *drv) {
+	if (driver && subdev && driver->remove)
+		driver->remove(&client);
+	driver = NULL;
+}
+
+int i2c_add_driver(struct i2c_driver *drv) {
+	return private_i2c_add_driver(drv);
+}
+
+void i2c_del_driver(struct i2c_driver *drv) {
+	private_i2c_del_driver(drv);
+}
+
+/* the 4.4 t31 drivers of the baseline call the kernel directly */
+int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num) {
+	return private_i2c_transfer(adap, msgs, num);
+}
+
+void private_i2c_set_clientdata(struct i2c_client *dev, void *data) {
+	dev->dev.driver_data = data;
+}
+
+void *private_i2c_get_clientdata(const struct i2c_client *dev) {
+	return dev->dev.driver_data;
+}
+
+/* gpio */
+int private_gpio_request(unsigned gpio, const char *label) {
+	trace("gpio %u request %s", gpio, label);
+	return 0;
+}
+
+void private_gpio_free(unsigned gpio) {
+	trace("gpio %u free", gpio);
+}
+
+int private_gpio_direction_output(unsigned gpio, int value) {
+	trace("gpio %u = %d", gpio, value);
+	return 0;
+}
+
+int private_gpio_direction_input(unsigned gpio) {
+	trace("gpio %u input", gpio);
+	return 0;
+}
+
+int private_jzgpio_set_func(enum gpio_port port, enum gpio_function func, unsigned long pins) {
+	trace("gpio port %d func %d pins 0x%08lx", port, func, pins);
+	return 0;
+}
+
+int gpio_request(unsigned gpio, const char *label) {
+	return private_gpio_request(gpio, label);
+}
+
+void gpio_free(unsigned gpio) {
+	private_gpio_free(gpio);
+}
+
+int gpio_direction_output(unsigned gpio, int value) {
+	return private_gpio_direction_output(gpio, value);
+}
+
+int gpio_direction_input(unsigned gpio) {
+	return private_gpio_direction_input(gpio);
+}
+
+void gpio_set_value(unsigned gpio, int value) {
+	private_gpio_direction_output(gpio, value);
+}
+
+int gpio_get_value(unsigned gpio) {
+	return 0;
+}
+
+/* clocks */
+struct clk {
+	char name[32];
+	unsigned long rate;
+	int enabled;
+};
+
+static struct clk clks[8];
+
+struct clk *clk_get(struct device *dev, const char *id) {
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(clks) && clks[i].name[0]; i++)
+		if (!strcmp(clks[i].name, id))
+			return &clks[i];
+	if (i == ARRAY_SIZE(clks))
+		return ERR_PTR(-ENOMEM);
+	snprintf(clks[i].name, sizeof(clks[i].name), "%s", id);
+
+	return &clks[i];
+}
+
+void clk_put(struct clk *clk) {
+}
+
+int clk_enable(struct clk *clk) {
+	clk->enabled = 1;
+	trace("clk %s on", clk->name);
+	return 0;
+}
+
+void clk_disable(struct clk *clk) {
+	clk->enabled = 0;
+	trace("clk %s off", clk->name);
+}
+
+int clk_prepare_enable(struct clk *clk) {
+	return clk_enable(clk);
+}
+
+void clk_disable_unprepare(struct clk *clk) {
+	clk_disable(clk);
+}
+
+int clk_set_rate(struct clk *clk, unsigned long rate) {
+	clk->rate = rate;
+	trace("clk %s rate %lu", clk->name, rate);
+	return 0;
+}
+
+unsigned long clk_get_rate(struct clk *clk) {
+	return clk->rate;
+}
+
+long clk_round_rate(struct clk *clk, unsigned long rate) {
+	return rate;
+}
+
+int clk_set_parent(struct clk *clk, struct clk *parent) {
+	return 0;
+}
+
+struct clk *clk_get_parent(struct clk *clk) {
+	return clk;
+}
+
+struct clk *private_clk_get(struct device *dev, const char *id) {
+	return clk_get(dev, id);
+}
+
+void private_clk_put(struct clk *clk) {
+	clk_put(clk);
+}
+
+int private_clk_enable(struct clk *clk) {
+	return clk_enable(clk);
+}
+
+void private_clk_disable(struct clk *clk) {
+	clk_disable(clk);
+}
+
+int private_clk_prepare_enable(struct clk *clk) {
+	return clk_enable(clk);
+}
+
+void private_clk_disable_unprepare(struct clk *clk) {
+	clk_disable(clk);
+}
+
+struct clk *private_devm_clk_get(struct device *dev, const char *id) {
+	return clk_get(dev, id);
+}
+
+void private_devm_clk_put(struct device *dev, struct clk *clk) {
+	clk_put(clk);
+}
+
+int private_clk_is_enabled(struct clk *clk) {
+	return clk->enabled;
+}
+
+int private_clk_set_rate(struct clk *clk, unsigned long rate) {
+	return clk_set_rate(clk, rate);
+}
+
+unsigned long private_clk_get_rate(struct clk *clk) {
+	return clk->rate;
+}
+
+/* system */
+void private_msleep(unsigned int msecs) {
+	harness_delay_us(msecs * 1000UL);
+}
+
+bool private_capable(int cap) {
+	return true;
+}
+
+bool capable(int cap) {
+	return private_capable(cap);
+}
+
+unsigned long long private_sched_clock(void) {
+	return now_ns;
+}
+
+uint32_t private_math_exp2(uint32_t val, const unsigned char shift_in, const unsigned char shift_out) {
+	return tx_isp_math_exp2(val, shift_in, shift_out);
+}
+
+uint32_t private_log2_int_to_fixed(const uint32_t val, const uint8_t out_precision, const uint8_t shift_out) {
+	return tx_isp_log2_int_to_fixed(val, out_precision, shift_out);
+}
+
+uint32_t private_log2_fixed_to_fixed(const uint32_t val, const int in_fix_point, const uint8_t out_fix_point) {
+	return private_log2_int_to_fixed(val, out_fix_point, 0) - (in_fix_point << out_fix_point);
+}
+
+/* memory */
+void *kmalloc(size_t size, gfp_t flags) {
+	return malloc(size);
+}
+
+void *kzalloc(size_t size, gfp_t flags) {
+	return calloc(1, size);
+}
+
+void kfree(const void *p) {
+	free((void *)p);
+}
+
+void *vmalloc(unsigned long size) {
+	return malloc(size);
+}
+
+void vfree(const void *p) {
+	free((void *)p);
+}
+
+/* libc has its own from 2.38 on */
+__attribute__((weak)) size_t strlcpy(char *dst, const char *src, size_t size) {
+	size_t len = strlen(src);
+
+	if (size) {
+		size_t n = len < size - 1 ? len : size - 1;
+
+		memcpy(dst, src, n);
+		dst[n] = 0;
+	}
+
+	return len;
+}
+
+/* work runs when it is waited for, the order the ordered queues give */
+struct workqueue_struct {
+	struct work_struct *head;
+};
+
+static void work_run(struct workqueue_struct *wq) {
+	struct work_struct *work;
+
+	while ((work = wq->head)) {
+		wq->head = work->next;
+		work->pending = 0;
+		work->func(work);
+	}
+}
+
+static struct workqueue_struct *wqs[8];
+static struct workqueue_struct system_wq;
+
+static void work_run_all(void) {
+	unsigned int i;
+
+	work_run(&system_wq);
+	for (i = 0; i < ARRAY_SIZE(wqs); i++)
+		if (wqs[i])
+			work_run(wqs[i]);
+}
+
+struct workqueue_struct *alloc_ordered_workqueue(const char *fmt, unsigned int flags, ...) {
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(wqs); i++)
+		if (!wqs[i])
+			return wqs[i] = calloc(1, sizeof(*wqs[i]));
+
+	return NULL;
+}
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work) {
+	struct work_struct **p;
+
+	if (work->pending)
+		return false;
+	work->pending = 1;
+	work->next = NULL;
+	for (p = &wq->head; *p; p = &(*p)->next)
+		;
+	*p = work;
+
+	return true;
+}
+
+bool schedule_work(struct work_struct *work) {
+	return queue_work(&system_wq, work);
+}
+
+void flush_workqueue(struct workqueue_struct *wq) {
+	work_run(wq);
+}
+
+void destroy_workqueue(struct workqueue_struct *wq) {
+	unsigned int i;
+
+	work_run(wq);
+	for (i = 0; i < ARRAY_SIZE(wqs); i++)
+		if (wqs[i] == wq)
+			wqs[i] = NULL;
+	free(wq);
+}
+
+void complete(struct completion *x) {
+	x->done++;
+}
+
+void complete_all(struct completion *x) {
+	x->done = ~0U >> 1;
+}
+
+void wait_for_completion(struct completion *x) {
+	if (!x->done)
+		work_run_all();
+	if (!x->done)
+		trace("wait_for_completion would block");
+	else if (x->done != ~0U >> 1)
+		x->done--;
+}
+
+unsigned long wait_for_completion_timeout(struct completion *x, unsigned long timeout) {
+	wait_for_completion(x);
+	return x->done ? timeout : 0;
+}
+
+/* proc, the entries can be printed by the proc command */
+struct proc_dir_entry {
+	char name[64];
+	const struct file_operations *fops;
+	void *data;
+};
+
+static struct proc_dir_entry procs[32];
+
+struct proc_dir_entry *proc_mkdir(const char *name, struct proc_dir_entry *parent) {
+	return &procs[0];
+}
+
+struct proc_dir_entry *proc_create_data(const char *name, umode_t mode, struct proc_dir_entry *parent,
+					const struct file_operations *fops, void *data) {
+	unsigned int i;
+
+	for (i = 1; i < ARRAY_SIZE(procs); i++) {
+		if (!procs[i].fops) {
+			snprintf(procs[i].name, sizeof(procs[i].name), "%s", name);
+			procs[i].fops = fops;
+			procs[i].data = data;
+			return &procs[i];
+		}
+	}
+
+	return NULL;
+}
+
+void remove_proc_entry(const char *name, struct proc_dir_entry *parent) {
+	unsigned int i;
+
+	for (i = 1; i < ARRAY_SIZE(procs); i++)
+		if (procs[i].fops && !strcmp(procs[i].name, name))
+			procs[i].fops = NULL;
+}
+
+void proc_remove(struct proc_dir_entry *de) {
+	if (de)
+		de->fops = NULL;
+}
+
+struct seq_single {
+	struct seq_file m;
+	int (*show)(struct seq_file *, void *);
+};
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data) {
+	struct seq_single *s = calloc(1, sizeof(*s));
+
+	s->m.private = data;
+	s->show = show;
+	file->private_data = s;
+
+	return 0;
+}
+
+int single_release(struct inode *inode, struct file *file) {
+	free(file->private_data);
+	return 0;
+}
+
+ssize_t seq_read(struct file *file, char __user *buf, size_t size, loff_t *ppos) {
+	struct seq_single *s = file->private_data;
+
+	if (*ppos)
+		return 0;
+	s->show(&s->m, NULL);
+	*ppos = 1;
+
+	return 0;
+}
+
+loff_t seq_lseek(struct file *file, loff_t offset, int whence) {
+	return 0;
+}
+
+int seq_printf(struct seq_file *m, const char *fmt, ...) {
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = vprintf(fmt, ap);
+	va_end(ap);
+
+	return ret;
+}
+
+ssize_t simple_read_from_buffer(void __user *to, size_t count, loff_t *ppos,
+				const void *from, size_t available) {
+	if (*ppos >= (loff_t)available)
+		return 0;
+	printf("%.*s", (int)(available - *ppos), (const char *)from + *ppos);
+	*ppos = available;
+
+	return 0;
+}
+
+static int proc_show(const char *name) {
+	struct inode inode;
+	struct file file;
+	char buf[256];
+	loff_t pos = 0;
+	unsigned int i;
+
+	for (i = 1; i < ARRAY_SIZE(procs); i++) {
+		const struct file_operations *fops = procs[i].fops;
+
+		if (!fops || strcmp(procs[i].name, name))
+			continue;
+		memset(&file, 0, sizeof(file));
+		inode.i_private = procs[i].data;
+		if (fops->open && fops->open(&inode, &file))
+			return -1;
+		if (fops->read)
+			fops->read(&file, buf, sizeof(buf), &pos);
+		if (fops->release)
+			fops->release(&inode, &file);
+		return 0;
+	}
+
+	return -1;
+}
+
+/*
+ * The scenario, one command per line:
+ *
+ *	abytes <n>		register address bytes of the sensor, 1 or 2
+ *	page <reg>		the page select register of a paged sensor
+ *	reg <reg> <val> [page]	preset a register, the chip id
+ *	unset <val>		the value of the registers never written, 0
+ *	bus <khz> [us]		bus clock and fixed cost of an i2c_transfer
+ *	nak <n>			the next n i2c_transfer calls fail
+ *	param <name> <v>[,<v>]	set a module parameter, before the probe
+ *	probe [addr]		load the module and probe it at addr
+ *	ident			g_chip_ident, power up and detect
+ *	init			core init
+ *	stream <0|1>		s_stream
+ *	ioctl <event> [value]	sensor ioctl, TX_ISP_EVENT_SENSOR_<event>
+ *	ae <it> <gain>		an AE update, the gain is an isp gain, log2 in .16
+ *	fps <num>[/<den>]	ioctl FPS
+ *	proc <name>		print a proc entry of the driver
+ *	remove			unload the module
+ *	quiet | verbose		leave the transactions out of the trace or not
+ *
+ * Every command ends with a step line, its bus cost and a hash of the
+ * register state of the fake sensor, which is what runs are compared by.
+ */
+static const struct {
+	const char *name;
+	unsigned int event;
+} events[] = {
+#define X(e) {#e, TX_ISP_EVENT_SENSOR_##e},
+	HARNESS_EVENTS(X)
+#undef X
+};
+
+static int event_find(const char *name) {
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(events); i++)
+		if (!strcasecmp(events[i].name, name))
+			return events[i].event;
+
+	return -1;
+}
+
+static int run_ioctl(const char *name, int value) {
+	int event = event_find(name);
+#ifdef HARNESS_SENSOR_VALUE
+	struct tx_isp_sensor_value arg = { .value = value };
+#else
+	int arg = value;
+#endif
+
+	if (event < 0) {
+		fprintf(stderr, "no ioctl %s on this soc\n", name);
+		return -EINVAL;
+	}
+
+	return tx_isp_subdev_call(subdev, sensor, ioctl, event, &arg);
+}
+
+/*
+ * One frame of the AE of the isp: the gain is converted by the driver's
+ * alloc_again and handed down with the integration time, in one EXPO
+ * where the soc has it.
+ */
+static int run_ae(unsigned int it, unsigned int isp_gain) {
+	struct tx_isp_sensor_attribute *attr;
+	unsigned int again = 0;
+	int ret;
+
+	if (!subdev)
+		return -ENODEV;
+	attr = sd_to_sensor_device(subdev)->video.attr;
+	if (attr && attr->sensor_ctrl.alloc_again)
+		attr->sensor_ctrl.alloc_again(isp_gain, LOG2_GAIN_SHIFT, &again);
+
+	if (event_find("EXPO") >= 0)
+		return run_ioctl("EXPO", again << 16 | (it & 0xffff));
+
+	ret = run_ioctl("INT_TIME", it);
+	if (!ret)
+		ret = run_ioctl("AGAIN", again);
+
+	return ret;
+}
+
+/* module_init of the driver, the t41zrt drivers export init_sensor instead */
+extern int (*harness_module_init)(void) __attribute__((weak));
+extern void (*harness_module_exit)(void) __attribute__((weak));
+int init_sensor(void) __attribute__((weak));
+void exit_sensor(void) __attribute__((weak));
+
+static int run(int argc, char **argv) {
+	const char *cmd = argv[0];
+	int ret = 0;
+
+	if (!strcmp(cmd, "abytes") && argc > 1) {
+		fake_abytes = strtoul(argv[1], NULL, 0);
+	} else if (!strcmp(cmd, "page") && argc > 1) {
+		fake_page_reg = strtoul(argv[1], NULL, 0);
+	} else if (!strcmp(cmd, "reg") && argc > 2) {
+		unsigned int page = argc > 3 ? strtoul(argv[3], NULL, 0) : 0;
+
+		fake_store((page & 0xff) << 16 | strtoul(argv[1], NULL, 0), strtoul(argv[2], NULL, 0));
+	} else if (!strcmp(cmd, "unset") && argc > 1) {
+		fake_unset = strtoul(argv[1], NULL, 0);
+	} else if (!strcmp(cmd, "bus") && argc > 1) {
+		bus_khz = strtoul(argv[1], NULL, 0);
+		bus_xfer_us = argc > 2 ? strtoul(argv[2], NULL, 0) : 0;
+	} else if (!strcmp(cmd, "nak") && argc > 1) {
+		bus_nak = strtoul(argv[1], NULL, 0);
+	} else if (!strcmp(cmd, "param") && argc > 2) {
+		ret = param_set(argv[1], argv[2]);
+	} else if (!strcmp(cmd, "probe")) {
+		ret = &harness_module_init ? harness_module_init() : init_sensor();
+		if (!ret && driver) {
+			snprintf(client.name, sizeof(client.name), "%s", driver->driver.name);
+			client.addr = argc > 1 ? strtoul(argv[1], NULL, 0) : 0x37;
+			client.adapter = &adapter;
+			ret = driver->probe(&client, driver->id_table);
+		}
+	} else if (!strcmp(cmd, "ident")) {
+		struct tx_isp_chip_ident chip;
+
+		memset(&chip, 0, sizeof(chip));
+		ret = tx_isp_subdev_call(subdev, core, g_chip_ident, &chip);
+		trace("ident %s 0x%x", chip.name, chip.ident);
+	} else if (!strcmp(cmd, "init")) {
+		ret = tx_isp_subdev_call(subdev, core, init, ENABLE_ARG(1));
+	} else if (!strcmp(cmd, "stream") && argc > 1) {
+		ret = tx_isp_subdev_call(subdev, video, s_stream, ENABLE_ARG(strtol(argv[1], NULL, 0)));
+	} else if (!strcmp(cmd, "ioctl") && argc > 1) {
+		ret = run_ioctl(argv[1], argc > 2 ? strtol(argv[2], NULL, 0) : 0);
+	} else if (!strcmp(cmd, "ae") && argc > 2) {
+		ret = run_ae(strtoul(argv[1], NULL, 0), strtoul(argv[2], NULL, 0));
+	} else if (!strcmp(cmd, "fps") && argc > 1) {
+		char *den = strchr(argv[1], '/');
+		int fps = strtoul(argv[1], NULL, 0) << 16 | (den ? strtoul(den + 1, NULL, 0) : 1);
+
+		ret = run_ioctl("FPS", fps);
+	} else if (!strcmp(cmd, "proc") && argc > 1) {
+		ret = proc_show(argv[1]);
+	} else if (!strcmp(cmd, "remove")) {
+		if (&harness_module_exit)
+			harness_module_exit();
+		else
+			exit_sensor();
+	} else if (!strcmp(cmd, "quiet")) {
+		verbose = 0;
+	} else if (!strcmp(cmd, "verbose")) {
+		verbose = 1;
+	} else {
+		fprintf(stderr, "bad command %s\n", cmd);
+		return -EINVAL;
+	}
+
+	return ret;
+}
+
+/* the setup commands make no step */
+static int setup_command(const char *cmd) {
+	static const char *const setup[] = {"abytes", "page", "reg", "unset", "bus", "nak", "param", "quiet", "verbose"};
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(setup); i++)
+		if (!strcmp(cmd, setup[i]))
+			return 1;
+
+	return 0;
+}
+
+static void step_end(unsigned int nr, const char *line, int ret) {
+	printf("step %u ret %d xfers %u msgs %u bytes %u w %u r %u bus %llu us sleep %llu us state %016llx: %s\n",
+	       nr, ret, step.xfers, step.msgs, step.bytes, step.writes, step.reads,
+	       (unsigned long long)step.bus_ns / 1000, (unsigned long long)step.sleep_ns / 1000,
+	       (unsigned long long)fake_state, line);
+
+	total.xfers += step.xfers;
+	total.msgs += step.msgs;
+	total.bytes += step.bytes;
+	total.writes += step.writes;
+	total.reads += step.reads;
+	total.bus_ns += step.bus_ns;
+	total.sleep_ns += step.sleep_ns;
+	memset(&step, 0, sizeof(step));
+}
+
+/* a driver that divides by a register the fake sensor has no value for */
+static unsigned int step_nr;
+
+static void crashed(int sig) {
+	printf("step %u crashed with signal %d, the registers it reads may need reg or unset\n",
+	       step_nr + 1, sig);
+	fflush(stdout);
+	_exit(3);
+}
+
+int main(int argc, char **argv) {
+	FILE *f = stdin;
+	char line[256], cmd[256];
+	char *args[8];
+	int n, ret, failed = 0;
+
+	if (argc > 1 && !(f = fopen(argv[1], "r"))) {
+		perror(argv[1]);
+		return 2;
+	}
+
+	/* the dvp pin setup of sensor-common.h writes to a soc register */
+	mmap((void *)0xb0010000, 4096, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	signal(SIGFPE, crashed);
+	signal(SIGSEGV, crashed);
+
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "#\n")] = 0;
+		snprintf(cmd, sizeof(cmd), "%s", line);
+		for (n = 0; n < (int)ARRAY_SIZE(args) && (args[n] = strtok(n ? NULL : line, " \t")); n++)
+			;
+		if (!n)
+			continue;
+
+		if (setup_command(args[0])) {
+			if (run(n, args))
+				failed = 1;
+			continue;
+		}
+
+		ret = run(n, args);
+		work_run_all();
+		step_end(++step_nr, cmd, ret);
+		if (ret)
+			failed = 1;
+	}
+
+	printf("total xfers %u msgs %u bytes %u w %u r %u bus %llu us sleep %llu us\n",
+	       total.xfers, total.msgs, total.bytes, total.writes, total.reads,
+	       (unsigned long long)total.bus_ns / 1000, (unsigned long long)total.sleep_ns / 1000);
+
+	return failed;
+}
@@ -0,0 +1,247 @@
+#!/bin/sh
+#
+# Run a sensor driver on the host against a fake sensor and print the
+# trace of its I2C traffic, gpio changes and sleeps on a virtual clock.
+#
+# usage: sensor-harness.sh [-k kernel] [-b rev] [-a rev | -g trace] [-q] soc/driver [scenario]
+#	-k kernel	the kernel tree, 3.10 by default
+#	-b rev		run the driver as of git revision rev instead of the work tree
+#	-a rev		compare with the driver as of git revision rev
+#	-g trace	compare with a trace saved from an earlier run
+#	-q		print the step lines only
+#
+# The driver is built with its soc's isp headers and the common sensor
+# files, as Kbuild links it; host-kernel.h and host.c stand in for the
+# kernel and the isp module. The scenario commands are listed in host.c.
+# Without a scenario default.scn is run, after the address width, page
+# register and chip id the fake sensor needs, which are taken from the
+# driver, and the reset values of reset.tab.
+#
+# A comparison runs the same scenario on both and checks the register
+# state of the fake sensor after every step, the exit status is 1 when
+# one differs. The transactions and the modelled bus time of both are
+# printed per step, which is the benchmark of a change to the I2C path.
+
+HDIR="$(cd "$(dirname "$0")" && pwd)"
+TOP="$(cd "$HDIR/../.." && pwd)"
+CC="${CC:-cc}"
+KERNEL=3.10
+BASE=
+REV=
+GOLDEN=
+QUIET=
+
+while getopts k:b:a:g:q opt; do
+	case $opt in
+	k) KERNEL="$OPTARG" ;;
+	b) BASE="$OPTARG" ;;
+	a) REV="$OPTARG" ;;
+	g) GOLDEN="$OPTARG" ;;
+	q) QUIET=1 ;;
+	*) exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+[ $# -ge 1 ] || { echo "usage: $0 [-k kernel] [-b rev] [-a rev | -g trace] [-q] soc/driver [scenario]" >&2; exit 2; }
+SOC="${1%%/*}"
+DRV="${1#*/}"
+DRV="${DRV%.c}"
+SCN="$2"
+[ -f "$TOP/$KERNEL/sensor-src/$SOC/$DRV.c" ] || { echo "$0: no $KERNEL/sensor-src/$SOC/$DRV.c" >&2; exit 2; }
+[ -z "$SCN" ] || [ -f "$SCN" ] || { echo "$0: $SCN missing" >&2; exit 2; }
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+# build <top> <out>, the harness of the driver in the tree at top
+build() {
+	top="$1"
+	out="$2"
+	srcs="$top/$KERNEL/sensor-src/$SOC/$DRV.c $top/$KERNEL/sensor-src/common/sensor-info.c"
+	# the sensor core is linked into the drivers which are built on it
+	grep -q '<sensor-core.h>' "$top/$KERNEL/sensor-src/$SOC/$DRV.c" && \
+		srcs="$srcs $top/$KERNEL/sensor-src/common/sensor-core.c"
+	incs="$top/$KERNEL/isp/$SOC/include $top/include $top/$KERNEL/sensor-src/include"
+	mkdir -p "$out/inc"
+
+	# the kernel headers are empty, host-kernel.h declares what they would
+	for d in $incs; do
+		find "$d" -name '*.h' -exec cat {} +
+	done | cat - $srcs | sed -n 's/^#include <\(.*\)>.*/\1/p' | sort -u | while read -r h; do
+		for d in $incs; do
+			[ -f "$d/$h" ] && continue 2
+		done
+		case $h in
+		*/*) ;;
+		*) echo "#include <$h>" | $CC -E -x c - > /dev/null 2>&1 && continue ;;
+		esac
+		mkdir -p "$out/inc/$(dirname "$h")"
+		: > "$out/inc/$h"
+	done
+
+	# the sensor events of the soc, by name for the ioctl command, and
+	# whether its ops take a struct tx_isp_initarg and the ioctls a
+	# struct tx_isp_sensor_value
+	{
+	sed -n 's/^[ \t]*TX_ISP_EVENT_SENSOR_\([A-Z0-9_]*\).*/\1/p' \
+		"$top/$KERNEL/isp/$SOC/include/tx-isp-common.h" | sort -u | \
+	awk '
+	BEGIN { print "#define HARNESS_EVENTS(X) \\" }
+	{ if (NR > 1) print line " \\"; line = "\tX(" $0 ")" }
+	END { print line }'
+	grep -q 'struct tx_isp_initarg' "$top/$KERNEL/isp/$SOC/include/tx-isp-device.h" && \
+		echo "#define HARNESS_INITARG 1"
+	grep -q '^struct tx_isp_sensor_value' "$top/$KERNEL/isp/$SOC/include/tx-isp-common.h" && \
+		echo "#define HARNESS_SENSOR_VALUE 1"
+	[ -f "$top/include/tx-isp-fixmath.h" ] && \
+		echo "#define HARNESS_FIXMATH 1"
+	} > "$out/soc.h"
+
+	# the flags of the Kbuild and the config symbols of the vendor kernel
+	flags="-std=gnu99 -g -DRELEASE -DUSER_BIT_32 -DKERNEL_BIT_32"
+	flags="$flags -DCONFIG_SOC_$(echo "$SOC" | tr a-z A-Z)=1"
+	case $KERNEL in
+	3.10) flags="$flags -DCONFIG_KERNEL_3_10=1" ;;
+	4.4) flags="$flags -DCONFIG_KERNEL_4_4_94=1" ;;
+	esac
+	grep -q '^enum v4l2_mbus_pixelcode' "$top/$KERNEL/isp/$SOC/include/tx-isp-common.h" && \
+		flags="$flags -DHARNESS_ISP_MBUS=1"
+	flags="$flags -include $HDIR/host-kernel.h -I$out"
+	for d in $incs; do
+		flags="$flags -I$d"
+	done
+	flags="$flags -I$out/inc"
+
+	for src in $srcs; do
+		obj="$out/$(basename "$src" .c).o"
+		$CC $flags -w -c "$src" -o "$obj" || return 1
+	done
+	$CC $flags -I"$HDIR" -Wall -c "$HDIR/host.c" -o "$out/host.o" || return 1
+	$CC -o "$out/harness" "$out"/*.o
+}
+
+# the setup of the fake sensor for the default scenario
+setup() {
+	src="$1"
+	if grep -q '\.reg_bytes *= *1' "$src"; then
+		echo "abytes 1"
+	elif grep -q '\.reg_bytes *= *2' "$src" || grep -q 'reg *>> *8' "$src"; then
+		echo "abytes 2"
+	else
+		echo "abytes 1"
+	fi
+	sed -n 's/.*\.page_reg *= *\(0x[0-9a-fA-F]*\).*/page \1/p' "$src"
+	awk -v drv="$DRV" '$1 == drv { print "reg " $2 " " $3 }' "$HDIR/reset.tab"
+
+	# the id registers, of the core desc or read by sensor_detect
+	awk '
+	/^#define SENSOR_CHIP_ID_[A-Z]+[ \t]/ {
+		v = $3
+		gsub(/[()]/, "", v)
+		id[$2] = v
+	}
+	/\.id_reg *=/ {
+		s = $0
+		gsub(/.*\{|\}.*|[ \t]/, "", s)
+		nreg = split(s, reg, ",")
+	}
+	/\.id_val *=/ {
+		s = $0
+		gsub(/.*\{|\}.*|[ \t]/, "", s)
+		split(s, val, ",")
+		for (i = 1; i <= nreg; i++)
+			print "reg " reg[i] " " (val[i] in id ? id[val[i]] : val[i])
+		core = 1
+	}
+	/^static int sensor_detect/ { detect = !core }
+	detect && /sensor_read\(sd, *0x/ {
+		s = $0
+		sub(/.*sensor_read\(sd, */, "", s)
+		sub(/,.*/, "", s)
+		pending = s
+	}
+	detect && /!= *\(?SENSOR_CHIP_ID_[A-Z]+/ && pending != "" {
+		match($0, /SENSOR_CHIP_ID_[A-Z]+/)
+		name = substr($0, RSTART, RLENGTH)
+		print "reg " pending " " id[name]
+		pending = ""
+	}
+	detect && /^}/ { detect = 0 }
+	' "$src"
+}
+
+# run <harness> <trace>
+run() {
+	if [ -n "$SCN" ]; then
+		"$1" "$SCN" > "$2"
+	else
+		{ setup "$TOP/$KERNEL/sensor-src/$SOC/$DRV.c"; cat "$HDIR/default.scn"; } | "$1" > "$2"
+	fi
+}
+
+# compare <old trace> <new trace>
+compare() {
+	awk '
+	$1 == "step" {
+		s = $0
+		sub(/^[^:]*: /, "", s)
+		cmd[$2] = s
+		if (FILENAME == ARGV[1]) {
+			n = $2
+			ox[n] = $6; ow[n] = $12; ob[n] = $16; os[n] = $22
+		} else {
+			m = $2
+			nx[m] = $6; nw[m] = $12; nb[m] = $16; ns[m] = $22
+		}
+	}
+	END {
+		printf("%4s %-24s %13s %13s %17s  %s\n", "step", "", "xfers", "regs written", "bus us", "state")
+		for (i = 1; i <= (n > m ? n : m); i++) {
+			same = (i in os) && (i in ns) && os[i] == ns[i]
+			if (!same)
+				bad = 1
+			printf("%4d %-24s %6s %6s %6s %6s %8s %8s  %s\n", i, substr(cmd[i], 1, 24),
+			       ox[i], nx[i], ow[i], nw[i], ob[i], nb[i], same ? "same" : "DIFFERS")
+			tox += ox[i]; tnx += nx[i]; tow += ow[i]; tnw += nw[i]; tob += ob[i]; tnb += nb[i]
+		}
+		printf("%4s %-24s %6d %6d %6d %6d %8d %8d\n", "", "total", tox, tnx, tow, tnw, tob, tnb)
+		exit bad
+	}' "$1" "$2"
+}
+
+# extract <rev> <dir>, the files of the build as of a revision
+extract() {
+	mkdir -p "$2"
+	git -C "$TOP" archive "$1" "$KERNEL/sensor-src" "$KERNEL/isp/$SOC/include" include | \
+		tar -x -C "$2"
+}
+
+if [ -n "$BASE" ]; then
+	extract "$BASE" "$WORK/new" || exit 2
+	build "$WORK/new" "$WORK/new/build" || exit 2
+	run "$WORK/new/build/harness" "$WORK/new.trace"
+else
+	build "$TOP" "$WORK/new" || exit 2
+	run "$WORK/new/harness" "$WORK/new.trace"
+fi
+STATUS=$?
+
+if [ -n "$REV" ]; then
+	extract "$REV" "$WORK/old" || exit 2
+	build "$WORK/old" "$WORK/old/build" || exit 2
+	run "$WORK/old/build/harness" "$WORK/old.trace"
+	GOLDEN="$WORK/old.trace"
+fi
+
+if [ -n "$GOLDEN" ]; then
+	compare "$GOLDEN" "$WORK/new.trace"
+	exit $?
+fi
+
+if [ -n "$QUIET" ]; then
+	grep -e '^step' -e '^total' "$WORK/new.trace"
+else
+	cat "$WORK/new.trace"
+fi
+exit $STATUS
@@ -0,0 +1,59 @@
+#!/bin/sh
+#
+# Host checks of the helpers shared by the isp wrappers and the sensor
+# core against the code they replaced, and the time of both.
+#
+# usage: unit-test.sh [-k kernel]
+#	-k kernel	the kernel tree of sensor-core.c, 3.10 by default
+#
+# fixmath-test.c checks include/tx-isp-fixmath.h against fixmath-ref.h.
+# gain-test.c checks sensor_core_gain_index against the again_lut walk
+# of the drivers, on the lut of every driver in GAIN_DRIVERS and on the
+# corner cases it lists. The exit status is 1 when a result differs.
+
+HDIR="$(cd "$(dirname "$0")" && pwd)"
+TOP="$(cd "$HDIR/../.." && pwd)"
+CC="${CC:-cc}"
+KERNEL=3.10
+GAIN_DRIVERS="t31/gc2053 t31/sc2335 t41/sc2336"
+
+while getopts k: opt; do
+	case $opt in
+	k) KERNEL="$OPTARG" ;;
+	*) exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+CFLAGS="-std=gnu99 -O2 -Wall"
+bad=0
+
+# the kernel headers of tx-isp-fixmath.h, host-kernel.h has what they declare
+mkdir -p "$WORK/inc/linux"
+: > "$WORK/inc/linux/types.h"
+: > "$WORK/inc/linux/bitops.h"
+$CC $CFLAGS -include "$HDIR/host-kernel.h" -I"$WORK/inc" -I"$TOP/include" -I"$HDIR" \
+	"$HDIR/fixmath-test.c" -o "$WORK/fixmath-test" || exit 2
+"$WORK/fixmath-test" || bad=1
+
+core="$TOP/$KERNEL/sensor-src/common/sensor-core.c"
+{
+	sed -n '/^#define sensor_core_again_index/,/isp_gain)$/p' "$TOP/$KERNEL/sensor-src/include/sensor-core.h"
+	sed -n '/^#define SENSOR_CORE_GAIN(/p' "$core"
+	sed -n '/^int sensor_core_gain_index(/,/^}/p' "$core"
+} > "$WORK/gain-core.h"
+for drv in $GAIN_DRIVERS; do
+	src="$TOP/$KERNEL/sensor-src/$drv.c"
+	{
+		echo "#define LUT_NAME \"$drv\""
+		sed -n 's/^\t\.max_again = \([0-9]*\),.*/#define MAX_AGAIN \1/p' "$src"
+		sed -n '/^struct again_lut {/,/^};/p' "$src"
+		sed -n '/^struct again_lut sensor_again_lut\[\] = {/,/^};/p' "$src"
+	} > "$WORK/gain-lut.h"
+	$CC $CFLAGS -I"$WORK" "$HDIR/gain-test.c" -o "$WORK/gain-test" || exit 2
+	"$WORK/gain-test" || bad=1
+done
+
+exit $bad